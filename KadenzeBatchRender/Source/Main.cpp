@@ -0,0 +1,633 @@
+/*
+  ==============================================================================
+
+    Offline batch renderer for the Kadenze processors.
+
+    Runs a set of audio files through one of the processors, headless and
+    flagged non-realtime, and writes the results as WAV files, laid out
+    under --output as they are under the input directories. The processor
+    is set up from a state file saved by a host or by --save-state, then a
+    preset, then single parameters, in that order, so each can override the
+    one before.
+
+    Input is read through memory-mapped readers in large blocks wherever the
+    format allows it, and every file is a job on a work-stealing pool with
+    one thread per core. The plugin and the delay treat every channel on its
+    own, so their multichannel files are split into stereo pairs that run as
+    separate jobs and are interleaved again once the last pair is done; the
+    chorus/flanger spreads its lfo across the channels, so its files stay
+    whole. Jobs run longest first, and each output gets the tail the
+    processor reports, up to --max-tail seconds. Outputs start where their
+    input does: a processor's latency (the chorus/flanger's oversampling)
+    is rendered on past the end and dropped from the start.
+
+    Throughput is reported per file and for the whole run, as multiples of
+    realtime in total and per core.
+
+    usage: KadenzeBatchRender --processor <plugin|delay|chorusflanger>
+                              [--state <file>] [--preset <index>] [--set <id>=<value>]...
+                              [--save-state <file>]
+                              [--threads <n>] [--block <samples>] [--max-tail <s>] [--bits <16|24|32>]
+                              [--output <dir>] <file or directory>...
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+#include "WorkStealingPool.h"
+#include "../../KadenzePlugin/Source/PluginProcessor.h"
+#include "../../KadenzeDelay/Source/PluginProcessor.h"
+#include "../../KadenzeChorusFlanger/Source/PluginProcessor.h"
+
+//==============================================================================
+struct ProcessorType
+{
+    juce::String name;
+    std::function<juce::AudioProcessor*()> create;
+
+    // every channel is processed on its own, so a file can be split into channel groups
+    bool independentChannels;
+};
+
+struct RenderSettings
+{
+    const ProcessorType* processorType;
+
+    juce::MemoryBlock state;
+    int preset;
+    std::vector<std::pair<juce::String, float>> values;
+
+    int blockSize;
+    double maxTailSeconds;
+    int bitsPerSample;
+    juce::File outputDirectory;
+};
+
+struct InputFile
+{
+    juce::File file;
+    double sampleRate;
+    int numChannels;
+    juce::int64 lengthInSamples;
+    int bitsPerSample;
+};
+
+// one input file's way through the pool; its channel groups share it
+struct FileRender
+{
+    InputFile input;
+    juce::File output;
+    int outputBitsPerSample;
+
+    std::vector<juce::File> groupFiles;
+    std::atomic<int> numGroupsRemaining;
+
+    std::atomic<juce::int64> renderTicks;
+    juce::int64 numSamplesWritten;
+
+    juce::CriticalSection errorLock;
+    juce::String error;
+};
+
+// read from the input, and written to the output, this many samples at a time
+static const int kReadBlockSize = 1 << 16;
+
+// channels per job for processors whose channels are independent
+static const int kChannelGroupSize = 2;
+
+static const char* const kUsage =
+    "usage: KadenzeBatchRender --processor <plugin|delay|chorusflanger>\n"
+    "                          [--state <file>] [--preset <index>] [--set <id>=<value>]...\n"
+    "                          [--save-state <file>]\n"
+    "                          [--threads <n>] [--block <samples>] [--max-tail <s>] [--bits <16|24|32>]\n"
+    "                          [--output <dir>] <file or directory>...";
+
+//==============================================================================
+static std::vector<ProcessorType> createProcessorTypes()
+{
+    return { { "plugin", [] { return new KadenzePluginAudioProcessor(); }, true },
+             { "delay", [] { return new KadenzeDelayAudioProcessor(); }, true },
+             { "chorusflanger", [] { return new KadenzeChorusFlangerAudioProcessor(); }, false } };
+}
+
+static juce::RangedAudioParameter* findParameter(juce::AudioProcessor& processor, const juce::String& parameterID)
+{
+    for (auto* param : processor.getParameters()) {
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param)) {
+            if (ranged->paramID == parameterID) {
+                return ranged;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+// the state file, then the preset, then the single values; main() has checked they all apply
+static void applySettings(juce::AudioProcessor& processor, const RenderSettings& settings)
+{
+    if (settings.state.getSize() > 0) {
+        processor.setStateInformation(settings.state.getData(), (int)settings.state.getSize());
+    }
+
+    if (settings.preset >= 0) {
+        processor.setCurrentProgram(settings.preset);
+    }
+
+    for (auto& value : settings.values)
+    {
+        auto* ranged = findParameter(processor, value.first);
+        ranged->setValueNotifyingHost(ranged->convertTo0to1(value.second));
+    }
+}
+
+//==============================================================================
+// mapped where the format allows it, so reading a block is a copy out of the page cache; the
+// rest are streamed
+static std::unique_ptr<juce::AudioFormatReader> createReader(juce::AudioFormatManager& formats, const juce::File& file)
+{
+    if (auto* format = formats.findFormatForFileExtension(file.getFileExtension()))
+    {
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader(format->createMemoryMappedReader(file));
+
+        if (mappedReader != nullptr && mappedReader->mapEntireFile()) {
+            return std::move(mappedReader);
+        }
+    }
+
+    return std::unique_ptr<juce::AudioFormatReader>(formats.createReaderFor(file));
+}
+
+static std::unique_ptr<juce::AudioFormatWriter> createWriter(const juce::File& file, double sampleRate, int numChannels, int bitsPerSample)
+{
+    // a FileOutputStream appends to what is already there
+    file.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> stream(file.createOutputStream());
+
+    if (stream == nullptr) {
+        return nullptr;
+    }
+
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(stream.get(), sampleRate, (unsigned int)numChannels,
+                                                                              bitsPerSample, {}, 0));
+
+    // the writer owns the stream once it exists
+    if (writer != nullptr) {
+        stream.release();
+    }
+
+    return writer;
+}
+
+// runs channels [firstChannel, firstChannel + numChannels) of the input through a fresh processor
+// into output, tail included; returns an error, or an empty string
+static juce::String renderChannels(const RenderSettings& settings, juce::AudioFormatManager& formats, const InputFile& input,
+                                   int firstChannel, int numChannels, const juce::File& output, int bitsPerSample,
+                                   juce::int64& numSamplesWritten)
+{
+    auto reader = createReader(formats, input.file);
+
+    if (reader == nullptr) {
+        return "can't read the file";
+    }
+
+    std::unique_ptr<juce::AudioProcessor> processor(settings.processorType->create());
+    processor->setNonRealtime(true);
+
+    juce::AudioProcessor::BusesLayout layout;
+    layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+    layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+
+    if (! processor->setBusesLayout(layout)) {
+        return juce::String(numChannels) + " channels aren't supported by " + settings.processorType->name;
+    }
+
+    applySettings(*processor, settings);
+    processor->setRateAndBufferSizeDetails(input.sampleRate, settings.blockSize);
+    processor->prepareToPlay(input.sampleRate, settings.blockSize);
+
+    auto writer = createWriter(output, input.sampleRate, numChannels, bitsPerSample);
+
+    if (writer == nullptr) {
+        processor->releaseResources();
+        return "can't write " + output.getFullPathName();
+    }
+
+    juce::AudioBuffer<float> buffer(numChannels, kReadBlockSize);
+    juce::MidiBuffer midiMessages;
+
+    // the reader fills only this group's channels and skips the rest
+    std::vector<float*> readerChannels((size_t)input.numChannels, nullptr);
+
+    for (int channel = 0; channel < numChannels; channel++) {
+        readerChannels[(size_t)(firstChannel + channel)] = buffer.getWritePointer(channel);
+    }
+
+    const double tailSeconds = juce::jlimit(0.0, settings.maxTailSeconds, processor->getTailLengthSeconds());
+    const int latency = processor->getLatencySamples();
+    const juce::int64 totalNumSamples = input.lengthInSamples + (juce::int64)std::ceil(tailSeconds * input.sampleRate) + latency;
+
+    juce::String error;
+
+    for (juce::int64 position = 0; position < totalNumSamples && error.isEmpty(); position += kReadBlockSize)
+    {
+        const int numSamples = (int)juce::jmin((juce::int64)kReadBlockSize, totalNumSamples - position);
+        const int numInputSamples = (int)juce::jlimit((juce::int64)0, (juce::int64)numSamples, input.lengthInSamples - position);
+
+        buffer.clear();
+
+        if (numInputSamples > 0 && ! reader->read(readerChannels.data(), input.numChannels, position, numInputSamples)) {
+            error = "read failed";
+            break;
+        }
+
+        for (int offset = 0; offset < numSamples; offset += settings.blockSize)
+        {
+            juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), numChannels, offset,
+                                           juce::jmin(settings.blockSize, numSamples - offset));
+            processor->processBlock(block, midiMessages);
+        }
+
+        // the first latency samples are what the processor put out before the input reached it
+        const int numSkippedSamples = (int)juce::jlimit((juce::int64)0, (juce::int64)numSamples, latency - position);
+
+        if (numSkippedSamples < numSamples && ! writer->writeFromAudioSampleBuffer(buffer, numSkippedSamples, numSamples - numSkippedSamples)) {
+            error = "write failed";
+        }
+    }
+
+    processor->releaseResources();
+    numSamplesWritten = totalNumSamples - latency;
+
+    return error;
+}
+
+// interleaves the channel groups' files into the file's output, in channel order, and deletes them
+static juce::String mergeChannelGroups(juce::AudioFormatManager& formats, FileRender& render)
+{
+    std::vector<std::unique_ptr<juce::AudioFormatReader>> readers;
+
+    for (auto& groupFile : render.groupFiles)
+    {
+        readers.push_back(createReader(formats, groupFile));
+
+        if (readers.back() == nullptr) {
+            return "can't read back " + groupFile.getFullPathName();
+        }
+    }
+
+    auto writer = createWriter(render.output, render.input.sampleRate, render.input.numChannels, render.outputBitsPerSample);
+
+    if (writer == nullptr) {
+        return "can't write " + render.output.getFullPathName();
+    }
+
+    juce::AudioBuffer<float> buffer(render.input.numChannels, kReadBlockSize);
+    juce::String error;
+
+    for (juce::int64 position = 0; position < render.numSamplesWritten && error.isEmpty(); position += kReadBlockSize)
+    {
+        const int numSamples = (int)juce::jmin((juce::int64)kReadBlockSize, render.numSamplesWritten - position);
+        int channel = 0;
+
+        for (auto& reader : readers)
+        {
+            if (! reader->read(buffer.getArrayOfWritePointers() + channel, (int)reader->numChannels, position, numSamples)) {
+                error = "read back failed";
+            }
+
+            channel += (int)reader->numChannels;
+        }
+
+        if (error.isEmpty() && ! writer->writeFromAudioSampleBuffer(buffer, 0, numSamples)) {
+            error = "write failed";
+        }
+    }
+
+    readers.clear();
+
+    for (auto& groupFile : render.groupFiles) {
+        groupFile.deleteFile();
+    }
+
+    return error;
+}
+
+//==============================================================================
+static void printFileResult(const FileRender& render)
+{
+    static juce::CriticalSection printLock;
+    const juce::ScopedLock lock(printLock);
+
+    if (render.error.isNotEmpty()) {
+        std::cout << render.input.file.getFileName() << ": " << render.error << std::endl;
+        return;
+    }
+
+    const double audioSeconds = render.input.lengthInSamples / render.input.sampleRate;
+    const double renderSeconds = juce::Time::highResolutionTicksToSeconds(render.renderTicks.load());
+
+    // every thread that worked on the file counts, so this is per core
+    std::cout << juce::String(render.input.file.getFileName()).paddedRight(' ', 32)
+              << juce::String(render.input.numChannels).paddedLeft(' ', 4) << " ch"
+              << juce::String(audioSeconds, 1).paddedLeft(' ', 10) << " s"
+              << juce::String(renderSeconds, 2).paddedLeft(' ', 10) << " s"
+              << juce::String(audioSeconds / renderSeconds, 1).paddedLeft(' ', 10) << " x realtime per core" << std::endl;
+}
+
+static void addFileJobs(WorkStealingPool& pool, const RenderSettings& settings, juce::AudioFormatManager& formats, FileRender& render)
+{
+    const int numChannels = render.input.numChannels;
+    const bool split = settings.processorType->independentChannels && numChannels > kChannelGroupSize;
+    const int groupSize = split ? kChannelGroupSize : numChannels;
+    const int numGroups = (numChannels + groupSize - 1) / groupSize;
+
+    const int bitsPerSample = settings.bitsPerSample > 0 ? settings.bitsPerSample : render.input.bitsPerSample;
+    render.outputBitsPerSample = juce::jlimit(16, 32, bitsPerSample / 8 * 8);
+    render.numGroupsRemaining = numGroups;
+    render.renderTicks = 0;
+
+    for (int group = 0; group < numGroups; group++)
+    {
+        if (split) {
+            render.groupFiles.push_back(render.output.getSiblingFile(render.output.getFileNameWithoutExtension()
+                                                                     + ".group" + juce::String(group) + ".tmp.wav"));
+        }
+
+        pool.addJob([&settings, &formats, &render, split, group, groupSize]
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+
+            const int firstChannel = group * groupSize;
+            const int numGroupChannels = juce::jmin(groupSize, render.input.numChannels - firstChannel);
+
+            // groups are written as floats, so only the merge quantises
+            juce::int64 numSamplesWritten = 0;
+            auto error = renderChannels(settings, formats, render.input, firstChannel, numGroupChannels,
+                                        split ? render.groupFiles[(size_t)group] : render.output,
+                                        split ? 32 : render.outputBitsPerSample, numSamplesWritten);
+
+            if (error.isNotEmpty()) {
+                const juce::ScopedLock lock(render.errorLock);
+                render.error = error;
+            }
+
+            // every group renders the same tail, so any of them has the length
+            const bool lastGroup = --render.numGroupsRemaining == 0;
+
+            if (lastGroup) {
+                render.numSamplesWritten = numSamplesWritten;
+
+                if (split && render.error.isEmpty()) {
+                    render.error = mergeChannelGroups(formats, render);
+                }
+            }
+
+            render.renderTicks += juce::Time::getHighResolutionTicks() - start;
+
+            if (lastGroup) {
+                printFileResult(render);
+            }
+        });
+    }
+}
+
+//==============================================================================
+struct FoundFile
+{
+    juce::File file;
+
+    // where its output goes, relative to --output and without the extension
+    juce::String outputPath;
+};
+
+// the files to render, with directories searched for anything the formats can read; a file found
+// in a directory keeps its path below that directory, so same-named files in different
+// subdirectories don't meet in one output
+static std::vector<FoundFile> findInputFiles(const juce::StringArray& paths, juce::AudioFormatManager& formats)
+{
+    std::vector<FoundFile> files;
+
+    for (auto& path : paths)
+    {
+        const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(path);
+
+        if (! file.isDirectory()) {
+            files.push_back({ file, file.getFileNameWithoutExtension() });
+            continue;
+        }
+
+        for (auto& child : file.findChildFiles(juce::File::findFiles, true, formats.getWildcardForAllFormats())) {
+            const auto relativePath = child.getRelativePathFrom(file);
+            files.push_back({ child, relativePath.upToLastOccurrenceOf(child.getFileExtension(), false, false) });
+        }
+    }
+
+    return files;
+}
+
+int main (int argc, char* argv[])
+{
+    // the chorus/flanger's latency timer expects a message manager, as in a host, whichever worker
+    // thread builds it
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const auto processorTypes = createProcessorTypes();
+
+    RenderSettings settings;
+    settings.processorType = nullptr;
+    settings.preset = -1;
+    settings.blockSize = 4096;
+    settings.maxTailSeconds = 30.0;
+    settings.bitsPerSample = 0;
+    settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile("rendered");
+
+    juce::File saveStateFile;
+    int numThreads = juce::SystemStats::getNumCpus();
+    juce::StringArray inputPaths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const juce::String arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--processor" && hasValue) {
+            const juce::String name(argv[++i]);
+
+            for (auto& processorType : processorTypes) {
+                if (processorType.name == name) {
+                    settings.processorType = &processorType;
+                }
+            }
+        } else if (arg == "--state" && hasValue) {
+            const auto stateFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+
+            if (! stateFile.loadFileAsData(settings.state)) {
+                std::cerr << "can't read " << stateFile.getFullPathName() << std::endl;
+                return 1;
+            }
+        } else if (arg == "--preset" && hasValue) {
+            settings.preset = juce::String(argv[++i]).getIntValue();
+        } else if (arg == "--set" && hasValue && juce::String(argv[i + 1]).containsChar('=')) {
+            const juce::String value(argv[++i]);
+            settings.values.push_back({ value.upToFirstOccurrenceOf("=", false, false).trim(),
+                                        value.fromFirstOccurrenceOf("=", false, false).getFloatValue() });
+        } else if (arg == "--save-state" && hasValue) {
+            saveStateFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            numThreads = juce::jmax(1, juce::String(argv[++i]).getIntValue());
+        } else if (arg == "--block" && hasValue) {
+            settings.blockSize = juce::jlimit(16, kReadBlockSize, juce::String(argv[++i]).getIntValue());
+        } else if (arg == "--max-tail" && hasValue) {
+            settings.maxTailSeconds = juce::jmax(0.0, juce::String(argv[++i]).getDoubleValue());
+        } else if (arg == "--bits" && hasValue) {
+            settings.bitsPerSample = juce::String(argv[++i]).getIntValue();
+        } else if (arg == "--output" && hasValue) {
+            settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        } else if (! arg.startsWith("--")) {
+            inputPaths.add(arg);
+        } else {
+            std::cerr << kUsage << std::endl;
+            return 1;
+        }
+    }
+
+    if (settings.processorType == nullptr || (inputPaths.isEmpty() && saveStateFile == juce::File())) {
+        std::cerr << kUsage << std::endl;
+        return 1;
+    }
+
+    // check the settings once on an instance of our own, rather than once per job
+    {
+        std::unique_ptr<juce::AudioProcessor> processor(settings.processorType->create());
+
+        if (settings.preset >= processor->getNumPrograms()) {
+            std::cerr << settings.processorType->name << " has " << processor->getNumPrograms() << " presets" << std::endl;
+            return 1;
+        }
+
+        for (auto& value : settings.values) {
+            if (findParameter(*processor, value.first) == nullptr) {
+                std::cerr << settings.processorType->name << " has no parameter " << value.first << std::endl;
+                return 1;
+            }
+        }
+
+        if (saveStateFile != juce::File())
+        {
+            applySettings(*processor, settings);
+
+            juce::MemoryBlock state;
+            processor->getStateInformation(state);
+
+            if (! saveStateFile.replaceWithData(state.getData(), state.getSize())) {
+                std::cerr << "can't write " << saveStateFile.getFullPathName() << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    if (inputPaths.isEmpty()) {
+        return 0;
+    }
+
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    if (! settings.outputDirectory.createDirectory()) {
+        std::cerr << "can't create " << settings.outputDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    // the list of renders doesn't move once jobs point into it, and every output belongs to one input
+    std::vector<std::unique_ptr<FileRender>> renders;
+    std::map<juce::String, juce::File> inputsByOutput;
+
+    for (auto& foundFile : findInputFiles(inputPaths, formats))
+    {
+        const auto& file = foundFile.file;
+        auto reader = createReader(formats, file);
+
+        if (reader == nullptr) {
+            std::cerr << "skipping " << file.getFullPathName() << ": not an audio file we can read" << std::endl;
+            continue;
+        }
+
+        const auto output = settings.outputDirectory.getChildFile(foundFile.outputPath + ".wav");
+
+        if (output == file) {
+            std::cerr << "skipping " << file.getFullPathName() << ": it would be overwritten by its own output" << std::endl;
+            continue;
+        }
+
+        // two inputs of the same name (a.wav and a.aif, or one file named twice) would overwrite each
+        // other's output, or interleave into it, so nothing starts until they are told apart
+        const auto existing = inputsByOutput.find(output.getFullPathName());
+
+        if (existing != inputsByOutput.end()) {
+            std::cerr << existing->second.getFullPathName() << " and " << file.getFullPathName()
+                      << " would both be rendered to " << output.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        inputsByOutput[output.getFullPathName()] = file;
+
+        renders.emplace_back(new FileRender());
+        renders.back()->input = { file, reader->sampleRate, (int)reader->numChannels, reader->lengthInSamples, (int)reader->bitsPerSample };
+        renders.back()->output = output;
+    }
+
+    if (renders.empty()) {
+        std::cerr << "nothing to render" << std::endl;
+        return 1;
+    }
+
+    for (auto& render : renders) {
+        if (! render->output.getParentDirectory().createDirectory()) {
+            std::cerr << "can't create " << render->output.getParentDirectory().getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+
+    // longest first, by the samples there are to process, so no long file starts last
+    std::stable_sort(renders.begin(), renders.end(), [] (const std::unique_ptr<FileRender>& a, const std::unique_ptr<FileRender>& b)
+    {
+        return a->input.lengthInSamples * a->input.numChannels > b->input.lengthInSamples * b->input.numChannels;
+    });
+
+    WorkStealingPool pool(numThreads);
+
+    for (auto& render : renders) {
+        addFileJobs(pool, settings, formats, *render);
+    }
+
+    const auto start = juce::Time::getHighResolutionTicks();
+    pool.run();
+    const double wallSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+    double audioSeconds = 0;
+    int numFailed = 0;
+
+    for (auto& render : renders)
+    {
+        if (render->error.isNotEmpty()) {
+            numFailed++;
+        } else {
+            audioSeconds += render->input.lengthInSamples / render->input.sampleRate;
+        }
+    }
+
+    const double realtimeFactor = audioSeconds / wallSeconds;
+
+    std::cout << std::endl
+              << "rendered " << (renders.size() - (size_t)numFailed) << " files, " << juce::String(audioSeconds, 1) << " s of audio in "
+              << juce::String(wallSeconds, 2) << " s on " << pool.getNumThreads() << " threads: "
+              << juce::String(realtimeFactor, 1) << " x realtime, "
+              << juce::String(realtimeFactor / pool.getNumThreads(), 1) << " x realtime per core" << std::endl
+              << "workers busy " << juce::String(100.0 * pool.getBusySeconds() / (wallSeconds * pool.getNumThreads()), 1)
+              << "% of the run, " << pool.getNumStolenJobs() << " jobs stolen" << std::endl;
+
+    return numFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    WorkStealingPool.cpp
+
+  ==============================================================================
+*/
+
+#include "WorkStealingPool.h"
+
+WorkStealingPool::WorkStealingPool(int numThreads)
+{
+    for (int i = 0; i < juce::jmax(1, numThreads); i++) {
+        mWorkers.emplace_back(new Worker());
+    }
+
+    mNextWorker = 0;
+    mNumQueuedJobs = 0;
+}
+
+void WorkStealingPool::addJob(Job job)
+{
+    Worker& worker = *mWorkers[(size_t)mNextWorker];
+    mNextWorker = (mNextWorker + 1) % getNumThreads();
+
+    worker.jobs.push_back(std::move(job));
+    mNumQueuedJobs++;
+}
+
+void WorkStealingPool::run()
+{
+    for (auto& worker : mWorkers) {
+        worker->busySeconds = 0;
+        worker->numStolenJobs = 0;
+    }
+
+    std::vector<std::thread> threads;
+
+    for (int i = 1; i < getNumThreads(); i++) {
+        threads.emplace_back([this, i] { work(i); });
+    }
+
+    work(0);
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+double WorkStealingPool::getBusySeconds() const
+{
+    double busySeconds = 0;
+
+    for (auto& worker : mWorkers) {
+        busySeconds += worker->busySeconds;
+    }
+
+    return busySeconds;
+}
+
+int WorkStealingPool::getNumStolenJobs() const
+{
+    int numStolenJobs = 0;
+
+    for (auto& worker : mWorkers) {
+        numStolenJobs += worker->numStolenJobs;
+    }
+
+    return numStolenJobs;
+}
+
+void WorkStealingPool::work(int workerIndex)
+{
+    Worker& worker = *mWorkers[(size_t)workerIndex];
+    Job job;
+
+    // no job is added during a run, so once none is left to take this worker is done
+    while (takeJob(workerIndex, job))
+    {
+        const auto start = juce::Time::getHighResolutionTicks();
+        job();
+        worker.busySeconds += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        job = nullptr;
+    }
+}
+
+bool WorkStealingPool::takeJob(int workerIndex, Job& job)
+{
+    if (mNumQueuedJobs.load() == 0) {
+        return false;
+    }
+
+    {
+        Worker& worker = *mWorkers[(size_t)workerIndex];
+        const juce::ScopedLock lock(worker.lock);
+
+        if (! worker.jobs.empty()) {
+            job = std::move(worker.jobs.front());
+            worker.jobs.pop_front();
+
+            mNumQueuedJobs--;
+            return true;
+        }
+    }
+
+    // the neighbours first, so the thieves spread over the victims
+    for (int i = 1; i < getNumThreads(); i++)
+    {
+        Worker& victim = *mWorkers[(size_t)((workerIndex + i) % getNumThreads())];
+        const juce::ScopedLock lock(victim.lock);
+
+        if (! victim.jobs.empty()) {
+            job = std::move(victim.jobs.back());
+            victim.jobs.pop_back();
+
+            mNumQueuedJobs--;
+            mWorkers[(size_t)workerIndex]->numStolenJobs++;
+            return true;
+        }
+    }
+
+    return false;
+}
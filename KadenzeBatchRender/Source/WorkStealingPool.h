@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    WorkStealingPool.h
+
+    A fixed set of worker threads, each with its own queue of jobs. A
+    worker takes jobs from the front of its own queue, and once that is
+    empty steals from the back of the others', so a worker that finishes
+    its share early keeps helping instead of waiting on the slowest one.
+
+    Jobs are dealt round-robin in the order they are added, so add the
+    longest first: every queue then runs longest first, and thieves take
+    the shortest jobs left, which balance the end of a run best.
+
+    The queues are guarded by one lock each; jobs are whole files or
+    channel groups, so a queue is touched a few times a second at most.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <deque>
+
+//==============================================================================
+/**
+*/
+class WorkStealingPool
+{
+public:
+    typedef std::function<void()> Job;
+
+    explicit WorkStealingPool(int numThreads);
+
+    int getNumThreads() const { return (int)mWorkers.size(); }
+
+    // only before run()
+    void addJob(Job job);
+
+    // runs every job, returning once all are done; the calling thread works as one of the workers
+    void run();
+
+    // time spent in jobs, summed over the workers, and how many jobs were stolen, for the last run()
+    double getBusySeconds() const;
+    int getNumStolenJobs() const;
+
+private:
+
+    struct Worker
+    {
+        juce::CriticalSection lock;
+        std::deque<Job> jobs;
+
+        double busySeconds = 0;
+        int numStolenJobs = 0;
+    };
+
+    void work(int workerIndex);
+    bool takeJob(int workerIndex, Job& job);
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+    int mNextWorker;
+
+    // added and not yet taken, a worker that finds none left stops
+    std::atomic<int> mNumQueuedJobs;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WorkStealingPool)
+};
@@ -0,0 +1,887 @@
+/*
+  ==============================================================================
+
+    Headless processBlock benchmark for the Kadenze processors.
+
+    Builds every processor without an editor and drives processBlock over a
+    grid of sample rates, block sizes and parameter settings. The tables, in
+    the order they are printed:
+
+      - cost per sample, realtime factor and worst block, for every case
+      - the chorus/flanger at each modulation quality
+      - each read interpolation, for the processors that offer a choice
+      - the ensemble at a range of voice counts, against stacked instances
+      - the flanger at each oversampling factor, against a faster session
+      - the offline render profile against the realtime one
+      - the memory one prepared instance owns, at each sample rate
+      - the shared delay memory pool through a sample-rate change
+      - preparing a session's worth of instances and their first block
+      - an instance on an idle bus, against the tail it reports
+      - saving and restoring a session's worth of instance states
+
+    usage: KadenzeBenchmark [--seconds <audio seconds per case>]
+                            [--processor <plugin|delay|delay-split|chorusflanger|chorusflanger-rot>]
+                            [--csv]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+#include "../../KadenzePlugin/Source/PluginProcessor.h"
+#include "../../KadenzeDelay/Source/PluginProcessor.h"
+#include "../../KadenzeChorusFlanger/Source/PluginProcessor.h"
+#include "../../Shared/DelayMemoryPool.h"
+
+//==============================================================================
+// A named set of parameter values, keyed by parameter ID and given in the
+// parameter's own (not normalised) units.
+struct ParameterSetting
+{
+    juce::String name;
+    std::vector<std::pair<juce::String, float>> values;
+};
+
+struct ProcessorUnderTest
+{
+    juce::String name;
+    std::function<juce::AudioProcessor*()> create;
+    std::vector<ParameterSetting> settings;
+
+    // bytes owned by a prepared instance
+    std::function<size_t(juce::AudioProcessor&)> memoryFootprint;
+};
+
+struct BenchmarkResult
+{
+    double nanosecondsPerSample;
+    double realtimeFactor;
+    double worstBlockMicroseconds;
+    double worstBlockDeadlineRatio;
+};
+
+static const double kSampleRates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+static const int kBlockSizes[] = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+
+static const int kNumChannels = 2;
+static const int kMinMeasuredBlocks = 64;
+static const int kSourceLength = 1 << 17;
+
+//==============================================================================
+static std::vector<ProcessorUnderTest> createProcessorsUnderTest()
+{
+    std::vector<ProcessorUnderTest> processors;
+
+    processors.push_back({ "plugin",
+                           [] { return new KadenzePluginAudioProcessor(); },
+                           { { "default", {} },
+                             { "unity", { { "gain", 1.0f } } },
+                             { "short", { { "delaytime", 0.01f } } } },
+                           [] (juce::AudioProcessor& p) { return dynamic_cast<KadenzePluginAudioProcessor&>(p).getMemoryFootprint(); } });
+
+    const std::vector<ParameterSetting> delaySettings
+    {
+        { "default", {} },
+        { "short", { { "delaytime", 0.05f }, { "feedback", 0.9f }, { "drywet", 0.5f } } },
+        { "long", { { "delaytime", 2.0f }, { "feedback", 0.7f }, { "drywet", 1.0f } } }
+    };
+
+    auto delayFootprint = [] (juce::AudioProcessor& p) { return dynamic_cast<KadenzeDelayAudioProcessor&>(p).getMemoryFootprint(); };
+
+    processors.push_back({ "delay",
+                           [] { return new KadenzeDelayAudioProcessor(); },
+                           delaySettings,
+                           delayFootprint });
+
+    // the same settings with one delay line per channel instead of interleaved frames
+    processors.push_back({ "delay-split",
+                           [] {
+                               auto* processor = new KadenzeDelayAudioProcessor();
+                               processor->setDelayLineLayout(KadenzeDelayAudioProcessor::DelayLineLayout::split);
+                               return processor;
+                           },
+                           delaySettings,
+                           delayFootprint });
+
+    const std::vector<ParameterSetting> chorusFlangerSettings
+    {
+        { "chorus", { { "type", 0.0f }, { "rate", 1.0f }, { "depth", 0.5f } } },
+        { "flanger", { { "type", 1.0f }, { "rate", 0.3f }, { "depth", 1.0f }, { "feedback", 0.9f } } },
+        { "fast", { { "type", 0.0f }, { "rate", 20.0f }, { "depth", 1.0f }, { "phaseOffset", 0.25f } } }
+    };
+
+    auto chorusFlangerFootprint = [] (juce::AudioProcessor& p) { return dynamic_cast<KadenzeChorusFlangerAudioProcessor&>(p).getMemoryFootprint(); };
+
+    processors.push_back({ "chorusflanger",
+                           [] { return new KadenzeChorusFlangerAudioProcessor(); },
+                           chorusFlangerSettings,
+                           chorusFlangerFootprint });
+
+    // the same settings with the rotation oscillator instead of the wavetable
+    processors.push_back({ "chorusflanger-rot",
+                           [] {
+                               auto* processor = new KadenzeChorusFlangerAudioProcessor();
+                               processor->setLFOBackend(LFO::Backend::quadrature);
+                               return processor;
+                           },
+                           chorusFlangerSettings,
+                           chorusFlangerFootprint });
+
+    return processors;
+}
+
+static void applySetting(juce::AudioProcessor& processor, const ParameterSetting& setting)
+{
+    for (auto& value : setting.values) {
+        bool found = false;
+
+        for (auto* param : processor.getParameters()) {
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param)) {
+                if (ranged->paramID == value.first) {
+                    ranged->setValueNotifyingHost(ranged->convertTo0to1(value.second));
+                    found = true;
+                }
+            }
+        }
+
+        // a setting refers to a parameter that no longer exists
+        jassert(found);
+    }
+}
+
+//==============================================================================
+static BenchmarkResult runBenchmark(const ProcessorUnderTest& processorUnderTest,
+                                    const ParameterSetting& setting,
+                                    double sampleRate,
+                                    int blockSize,
+                                    double secondsOfAudio,
+                                    const juce::AudioBuffer<float>& source,
+                                    bool nonRealtime = false)
+{
+    std::unique_ptr<juce::AudioProcessor> processor(processorUnderTest.create());
+    applySetting(*processor, setting);
+
+    // before preparing, as a host bouncing offline does
+    processor->setNonRealtime(nonRealtime);
+
+    processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor->prepareToPlay(sampleRate, blockSize);
+
+    juce::AudioBuffer<float> buffer(kNumChannels, blockSize);
+    juce::MidiBuffer midiMessages;
+
+    const int numMeasuredBlocks = juce::jmax(kMinMeasuredBlocks, (int)(secondsOfAudio * sampleRate / blockSize));
+    const int numWarmUpBlocks = juce::jmax(8, numMeasuredBlocks / 20);
+
+    juce::int64 totalTicks = 0;
+    juce::int64 worstTicks = 0;
+    int sourcePosition = 0;
+
+    for (int block = -numWarmUpBlocks; block < numMeasuredBlocks; block++)
+    {
+        // refill the block from the noise source (outside the timed region)
+        if (sourcePosition + blockSize > source.getNumSamples()) {
+            sourcePosition = 0;
+        }
+
+        for (int channel = 0; channel < kNumChannels; channel++) {
+            buffer.copyFrom(channel, 0, source, channel, sourcePosition, blockSize);
+        }
+
+        sourcePosition += blockSize;
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        processor->processBlock(buffer, midiMessages);
+        const auto elapsed = juce::Time::getHighResolutionTicks() - start;
+
+        if (block >= 0) {
+            totalTicks += elapsed;
+            worstTicks = juce::jmax(worstTicks, elapsed);
+        }
+    }
+
+    processor->releaseResources();
+
+    const double totalSeconds = juce::Time::highResolutionTicksToSeconds(totalTicks);
+    const double worstSeconds = juce::Time::highResolutionTicksToSeconds(worstTicks);
+    const double audioSeconds = (double) numMeasuredBlocks * blockSize / sampleRate;
+    const double blockDeadline = blockSize / sampleRate;
+
+    BenchmarkResult result;
+    result.nanosecondsPerSample = totalSeconds * 1.0e9 / ((double) numMeasuredBlocks * blockSize);
+    result.realtimeFactor = totalSeconds > 0 ? audioSeconds / totalSeconds : 0;
+    result.worstBlockMicroseconds = worstSeconds * 1.0e6;
+    result.worstBlockDeadlineRatio = worstSeconds / blockDeadline;
+    return result;
+}
+
+//==============================================================================
+static void printHeader(bool csv)
+{
+    if (csv) {
+        std::cout << "processor,setting,samplerate,blocksize,ns_per_sample,realtime_factor,worst_block_us,worst_block_deadline_ratio" << std::endl;
+        return;
+    }
+
+    std::cout << juce::String("processor").paddedRight(' ', 19)
+              << juce::String("setting").paddedRight(' ', 10)
+              << juce::String("rate").paddedLeft(' ', 8)
+              << juce::String("block").paddedLeft(' ', 7)
+              << juce::String("ns/sample").paddedLeft(' ', 12)
+              << juce::String("x realtime").paddedLeft(' ', 12)
+              << juce::String("worst us").paddedLeft(' ', 11)
+              << juce::String("worst %").paddedLeft(' ', 10) << std::endl;
+}
+
+static void printResult(bool csv, const juce::String& processorName, const juce::String& settingName,
+                        double sampleRate, int blockSize, const BenchmarkResult& result)
+{
+    if (csv) {
+        std::cout << processorName << "," << settingName << "," << (int) sampleRate << "," << blockSize << ","
+                  << result.nanosecondsPerSample << "," << result.realtimeFactor << ","
+                  << result.worstBlockMicroseconds << "," << result.worstBlockDeadlineRatio << std::endl;
+        return;
+    }
+
+    std::cout << processorName.paddedRight(' ', 19)
+              << settingName.paddedRight(' ', 10)
+              << juce::String((int) sampleRate).paddedLeft(' ', 8)
+              << juce::String(blockSize).paddedLeft(' ', 7)
+              << juce::String(result.nanosecondsPerSample, 2).paddedLeft(' ', 12)
+              << juce::String(result.realtimeFactor, 1).paddedLeft(' ', 12)
+              << juce::String(result.worstBlockMicroseconds, 1).paddedLeft(' ', 11)
+              << juce::String(result.worstBlockDeadlineRatio * 100.0, 2).paddedLeft(' ', 10) << std::endl;
+}
+
+// runs the chorus/flanger's fastest, widest setting at every modulation quality and
+// reports the cost of one instance against the audio-rate modulation
+static void printModulationQualitySavings(const ProcessorUnderTest& processorUnderTest,
+                                          double secondsOfAudio,
+                                          const juce::AudioBuffer<float>& source)
+{
+    const int blockSize = 512;
+
+    std::unique_ptr<juce::AudioProcessor> processor(processorUnderTest.create());
+    juce::AudioParameterChoice* qualityParameter = nullptr;
+
+    for (auto* param : processor->getParameters()) {
+        if (auto* choice = dynamic_cast<juce::AudioParameterChoice*>(param)) {
+            if (choice->paramID == "modquality") {
+                qualityParameter = choice;
+            }
+        }
+    }
+
+    if (qualityParameter == nullptr) {
+        return;
+    }
+
+    std::cout << std::endl << processorUnderTest.name << " modulation quality, block " << blockSize << std::endl;
+
+    std::cout << juce::String("quality").paddedRight(' ', 19)
+              << juce::String("rate").paddedLeft(' ', 8)
+              << juce::String("ns/sample").paddedLeft(' ', 12)
+              << juce::String("% of core").paddedLeft(' ', 12)
+              << juce::String("saving %").paddedLeft(' ', 11) << std::endl;
+
+    for (auto sampleRate : kSampleRates)
+    {
+        double audioRateNanoseconds = 0;
+
+        for (int quality = 0; quality < qualityParameter->choices.size(); quality++)
+        {
+            ParameterSetting setting { "fast", { { "type", 0.0f }, { "rate", 20.0f }, { "depth", 1.0f },
+                                                 { "phaseOffset", 0.25f }, { "modquality", (float) quality } } };
+
+            auto result = runBenchmark(processorUnderTest, setting, sampleRate, blockSize, secondsOfAudio, source);
+
+            if (quality == 0) {
+                audioRateNanoseconds = result.nanosecondsPerSample;
+            }
+
+            // the share of one core a single instance needs to keep up in realtime
+            const double percentOfCore = result.nanosecondsPerSample * sampleRate * 1.0e-7;
+            const double saving = audioRateNanoseconds > 0 ? (1.0 - result.nanosecondsPerSample / audioRateNanoseconds) * 100.0 : 0;
+
+            std::cout << qualityParameter->choices[quality].paddedRight(' ', 19)
+                      << juce::String((int) sampleRate).paddedLeft(' ', 8)
+                      << juce::String(result.nanosecondsPerSample, 2).paddedLeft(' ', 12)
+                      << juce::String(percentOfCore, 3).paddedLeft(' ', 12)
+                      << juce::String(saving, 1).paddedLeft(' ', 11) << std::endl;
+        }
+    }
+}
+
+// runs the processor's first setting with every read interpolation and reports the cost of each
+// against linear
+static void printInterpolationCost(const ProcessorUnderTest& processorUnderTest,
+                                   double secondsOfAudio,
+                                   const juce::AudioBuffer<float>& source)
+{
+    const int blockSize = 512;
+    const double sampleRate = 48000.0;
+
+    std::unique_ptr<juce::AudioProcessor> processor(processorUnderTest.create());
+    juce::AudioParameterChoice* interpolationParameter = nullptr;
+
+    for (auto* param : processor->getParameters()) {
+        if (auto* choice = dynamic_cast<juce::AudioParameterChoice*>(param)) {
+            if (choice->paramID == "interpolation") {
+                interpolationParameter = choice;
+            }
+        }
+    }
+
+    if (interpolationParameter == nullptr || processorUnderTest.settings.empty()) {
+        return;
+    }
+
+    const ParameterSetting& baseSetting = processorUnderTest.settings.front();
+
+    std::cout << std::endl << processorUnderTest.name << " interpolation, " << baseSetting.name
+              << ", rate " << (int) sampleRate << ", block " << blockSize << std::endl;
+
+    std::cout << juce::String("interpolation").paddedRight(' ', 19)
+              << juce::String("ns/sample").paddedLeft(' ', 12)
+              << juce::String("x linear").paddedLeft(' ', 10) << std::endl;
+
+    double linearNanoseconds = 0;
+
+    for (int interpolation = 0; interpolation < interpolationParameter->choices.size(); interpolation++)
+    {
+        ParameterSetting setting = baseSetting;
+        setting.values.push_back({ "interpolation", (float) interpolation });
+
+        auto result = runBenchmark(processorUnderTest, setting, sampleRate, blockSize, secondsOfAudio, source);
+
+        if (interpolation == 0) {
+            linearNanoseconds = result.nanosecondsPerSample;
+        }
+
+        std::cout << interpolationParameter->choices[interpolation].paddedRight(' ', 19)
+                  << juce::String(result.nanosecondsPerSample, 2).paddedLeft(' ', 12)
+                  << juce::String(linearNanoseconds > 0 ? result.nanosecondsPerSample / linearNanoseconds : 0, 2).paddedLeft(' ', 10) << std::endl;
+    }
+}
+
+// runs the processor's first setting with more and more ensemble voices, and reports the cost
+// against one voice and against stacking as many single-voice instances
+static void printEnsembleCost(const ProcessorUnderTest& processorUnderTest,
+                              double secondsOfAudio,
+                              const juce::AudioBuffer<float>& source)
+{
+    const int blockSize = 512;
+    const double sampleRate = 48000.0;
+    const int voiceCounts[] = { 1, 2, 4, 8, 16 };
+
+    std::unique_ptr<juce::AudioProcessor> processor(processorUnderTest.create());
+    bool hasVoices = false;
+
+    for (auto* param : processor->getParameters()) {
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param)) {
+            hasVoices = hasVoices || ranged->paramID == "voices";
+        }
+    }
+
+    if (! hasVoices || processorUnderTest.settings.empty()) {
+        return;
+    }
+
+    const ParameterSetting& baseSetting = processorUnderTest.settings.front();
+
+    std::cout << std::endl << processorUnderTest.name << " ensemble, " << baseSetting.name
+              << ", rate " << (int) sampleRate << ", block " << blockSize << std::endl;
+
+    std::cout << juce::String("voices").paddedRight(' ', 8)
+              << juce::String("ns/sample").paddedLeft(' ', 12)
+              << juce::String("ns/voice").paddedLeft(' ', 10)
+              << juce::String("x 1 voice").paddedLeft(' ', 11)
+              << juce::String("x stacked").paddedLeft(' ', 11) << std::endl;
+
+    double oneVoiceNanoseconds = 0;
+
+    for (auto numVoices : voiceCounts)
+    {
+        ParameterSetting setting = baseSetting;
+        setting.values.push_back({ "voices", (float) numVoices });
+
+        auto result = runBenchmark(processorUnderTest, setting, sampleRate, blockSize, secondsOfAudio, source);
+
+        if (numVoices == 1) {
+            oneVoiceNanoseconds = result.nanosecondsPerSample;
+        }
+
+        // stacked, every voice is a whole instance with its own write, feedback and mix
+        const double stackedNanoseconds = oneVoiceNanoseconds * numVoices;
+
+        std::cout << juce::String(numVoices).paddedRight(' ', 8)
+                  << juce::String(result.nanosecondsPerSample, 2).paddedLeft(' ', 12)
+                  << juce::String(result.nanosecondsPerSample / numVoices, 2).paddedLeft(' ', 10)
+                  << juce::String(oneVoiceNanoseconds > 0 ? result.nanosecondsPerSample / oneVoiceNanoseconds : 0, 2).paddedLeft(' ', 11)
+                  << juce::String(stackedNanoseconds > 0 ? result.nanosecondsPerSample / stackedNanoseconds : 0, 2).paddedLeft(' ', 11) << std::endl;
+    }
+}
+
+// runs the processor's flanger setting at every oversampling factor, and reports the cost against
+// not oversampling and against running the session at the oversampled rate instead (where every
+// processor in it costs that much more per host sample, not just this one)
+static void printOversamplingCost(const ProcessorUnderTest& processorUnderTest,
+                                  double secondsOfAudio,
+                                  const juce::AudioBuffer<float>& source)
+{
+    const int blockSize = 512;
+    const double sampleRate = 44100.0;
+
+    std::unique_ptr<juce::AudioProcessor> processor(processorUnderTest.create());
+    juce::AudioParameterChoice* oversamplingParameter = nullptr;
+
+    for (auto* param : processor->getParameters()) {
+        if (auto* choice = dynamic_cast<juce::AudioParameterChoice*>(param)) {
+            if (choice->paramID == "oversampling") {
+                oversamplingParameter = choice;
+            }
+        }
+    }
+
+    if (oversamplingParameter == nullptr || processorUnderTest.settings.empty()) {
+        return;
+    }
+
+    const ParameterSetting* baseSetting = &processorUnderTest.settings.front();
+
+    for (auto& setting : processorUnderTest.settings) {
+        if (setting.name == "flanger") {
+            baseSetting = &setting;
+        }
+    }
+
+    std::cout << std::endl << processorUnderTest.name << " oversampling, " << baseSetting->name
+              << ", rate " << (int) sampleRate << ", block " << blockSize << std::endl;
+
+    std::cout << juce::String("oversampling").paddedRight(' ', 14)
+              << juce::String("latency").paddedLeft(' ', 9)
+              << juce::String("ns/sample").paddedLeft(' ', 12)
+              << juce::String("x off").paddedLeft(' ', 8)
+              << juce::String("x session").paddedLeft(' ', 11) << std::endl;
+
+    double offNanoseconds = 0;
+
+    for (int numStages = 0; numStages < oversamplingParameter->choices.size(); numStages++)
+    {
+        const int factor = 1 << numStages;
+
+        ParameterSetting setting = *baseSetting;
+        setting.values.push_back({ "oversampling", (float) numStages });
+
+        auto result = runBenchmark(processorUnderTest, setting, sampleRate, blockSize, secondsOfAudio, source);
+
+        if (numStages == 0) {
+            offNanoseconds = result.nanosecondsPerSample;
+        }
+
+        // the same audio through a session at factor times the rate, per host-rate sample
+        auto session = runBenchmark(processorUnderTest, *baseSetting, sampleRate * factor, blockSize * factor, secondsOfAudio, source);
+        const double sessionNanoseconds = session.nanosecondsPerSample * factor;
+
+        std::cout << oversamplingParameter->choices[numStages].paddedRight(' ', 14)
+                  << juce::String(Oversampler::getLatencyInSamples(numStages)).paddedLeft(' ', 9)
+                  << juce::String(result.nanosecondsPerSample, 2).paddedLeft(' ', 12)
+                  << juce::String(offNanoseconds > 0 ? result.nanosecondsPerSample / offNanoseconds : 0, 2).paddedLeft(' ', 8)
+                  << juce::String(sessionNanoseconds > 0 ? result.nanosecondsPerSample / sessionNanoseconds : 0, 2).paddedLeft(' ', 11) << std::endl;
+    }
+}
+
+// runs the processor's first setting as realtime playback and as an offline render, for a few of
+// the block sizes hosts bounce with
+static void printOfflineProfileCost(const ProcessorUnderTest& processorUnderTest,
+                                    double secondsOfAudio,
+                                    const juce::AudioBuffer<float>& source)
+{
+    const double sampleRate = 48000.0;
+    const int blockSizes[] = { 512, 4096, 16384 };
+
+    if (processorUnderTest.settings.empty()) {
+        return;
+    }
+
+    const ParameterSetting& setting = processorUnderTest.settings.front();
+
+    std::cout << std::endl << processorUnderTest.name << " offline profile, " << setting.name
+              << ", rate " << (int) sampleRate << std::endl;
+
+    std::cout << juce::String("block").paddedRight(' ', 8)
+              << juce::String("realtime ns/smp").paddedLeft(' ', 17)
+              << juce::String("offline ns/smp").paddedLeft(' ', 16)
+              << juce::String("x cost").paddedLeft(' ', 8)
+              << juce::String("offline x rt").paddedLeft(' ', 14) << std::endl;
+
+    for (auto blockSize : blockSizes)
+    {
+        auto realtime = runBenchmark(processorUnderTest, setting, sampleRate, blockSize, secondsOfAudio, source);
+        auto offline = runBenchmark(processorUnderTest, setting, sampleRate, blockSize, secondsOfAudio, source, true);
+
+        std::cout << juce::String(blockSize).paddedRight(' ', 8)
+                  << juce::String(realtime.nanosecondsPerSample, 2).paddedLeft(' ', 17)
+                  << juce::String(offline.nanosecondsPerSample, 2).paddedLeft(' ', 16)
+                  << juce::String(offline.nanosecondsPerSample / realtime.nanosecondsPerSample, 2).paddedLeft(' ', 8)
+                  << juce::String(offline.realtimeFactor, 0).paddedLeft(' ', 14) << std::endl;
+    }
+}
+
+// prepares one instance per sample rate and reports the memory it owns
+static void printMemoryFootprint(const ProcessorUnderTest& processorUnderTest)
+{
+    const int blockSize = 512;
+
+    std::cout << std::endl << processorUnderTest.name << " memory per instance, block " << blockSize << std::endl;
+
+    std::cout << juce::String("rate").paddedLeft(' ', 8)
+              << juce::String("bytes").paddedLeft(' ', 12)
+              << juce::String("kB").paddedLeft(' ', 10) << std::endl;
+
+    for (auto sampleRate : kSampleRates)
+    {
+        std::unique_ptr<juce::AudioProcessor> processor(processorUnderTest.create());
+        processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor->prepareToPlay(sampleRate, blockSize);
+
+        const size_t bytes = processorUnderTest.memoryFootprint(*processor);
+
+        std::cout << juce::String((int) sampleRate).paddedLeft(' ', 8)
+                  << juce::String((juce::int64) bytes).paddedLeft(' ', 12)
+                  << juce::String(bytes / 1024.0, 1).paddedLeft(' ', 10) << std::endl;
+
+        processor->releaseResources();
+    }
+}
+
+// runs every setting on silence (an idle effect-return bus) and on the noise, and reports the
+// tail length each setting gives the host
+static void printIdleCost(const ProcessorUnderTest& processorUnderTest,
+                          double secondsOfAudio,
+                          const juce::AudioBuffer<float>& source)
+{
+    const int blockSize = 512;
+    const double sampleRate = 48000.0;
+
+    juce::AudioBuffer<float> silence(kNumChannels, blockSize);
+    silence.clear();
+
+    std::cout << std::endl << processorUnderTest.name << " idle, " << (int) sampleRate << " Hz, block " << blockSize << std::endl;
+
+    std::cout << juce::String("setting").paddedRight(' ', 19)
+              << juce::String("tail s").paddedLeft(' ', 10)
+              << juce::String("noise ns").paddedLeft(' ', 11)
+              << juce::String("silence ns").paddedLeft(' ', 12)
+              << juce::String("saving %").paddedLeft(' ', 11) << std::endl;
+
+    for (auto& setting : processorUnderTest.settings)
+    {
+        std::unique_ptr<juce::AudioProcessor> processor(processorUnderTest.create());
+        applySetting(*processor, setting);
+
+        const auto busy = runBenchmark(processorUnderTest, setting, sampleRate, blockSize, secondsOfAudio, source);
+        const auto idle = runBenchmark(processorUnderTest, setting, sampleRate, blockSize, secondsOfAudio, silence);
+        const double saving = busy.nanosecondsPerSample > 0 ? (1.0 - idle.nanosecondsPerSample / busy.nanosecondsPerSample) * 100.0 : 0;
+
+        std::cout << setting.name.paddedRight(' ', 19)
+                  << juce::String(processor->getTailLengthSeconds(), 2).paddedLeft(' ', 10)
+                  << juce::String(busy.nanosecondsPerSample, 2).paddedLeft(' ', 11)
+                  << juce::String(idle.nanosecondsPerSample, 2).paddedLeft(' ', 12)
+                  << juce::String(saving, 1).paddedLeft(' ', 11) << std::endl;
+    }
+}
+
+// prepares a session's worth of fresh instances, as a session load does, and times prepareToPlay
+// and the first block (where lazily cleared delay lines zero what their reads reach)
+static void printStartupCost(const ProcessorUnderTest& processorUnderTest,
+                             const juce::AudioBuffer<float>& source)
+{
+    const int numInstances = 64;
+    const int blockSize = 512;
+
+    std::cout << std::endl << processorUnderTest.name << " startup, " << numInstances << " instances, block " << blockSize << std::endl;
+
+    std::cout << juce::String("rate").paddedLeft(' ', 8)
+              << juce::String("prepare ms").paddedLeft(' ', 12)
+              << juce::String("us/instance").paddedLeft(' ', 13)
+              << juce::String("first block us").paddedLeft(' ', 16) << std::endl;
+
+    juce::AudioBuffer<float> buffer(kNumChannels, blockSize);
+    juce::MidiBuffer midiMessages;
+
+    for (auto sampleRate : kSampleRates)
+    {
+        std::vector<std::unique_ptr<juce::AudioProcessor>> processors;
+
+        for (int i = 0; i < numInstances; i++) {
+            processors.emplace_back(processorUnderTest.create());
+            processors.back()->setRateAndBufferSizeDetails(sampleRate, blockSize);
+        }
+
+        const auto prepareStart = juce::Time::getHighResolutionTicks();
+
+        for (auto& processor : processors) {
+            processor->prepareToPlay(sampleRate, blockSize);
+        }
+
+        const double prepareSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - prepareStart);
+
+        juce::int64 firstBlockTicks = 0;
+
+        for (auto& processor : processors)
+        {
+            for (int channel = 0; channel < kNumChannels; channel++) {
+                buffer.copyFrom(channel, 0, source, channel, 0, blockSize);
+            }
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            processor->processBlock(buffer, midiMessages);
+            firstBlockTicks += juce::Time::getHighResolutionTicks() - start;
+        }
+
+        const double firstBlockSeconds = juce::Time::highResolutionTicksToSeconds(firstBlockTicks);
+
+        std::cout << juce::String((int) sampleRate).paddedLeft(' ', 8)
+                  << juce::String(prepareSeconds * 1.0e3, 2).paddedLeft(' ', 12)
+                  << juce::String(prepareSeconds * 1.0e6 / numInstances, 1).paddedLeft(' ', 13)
+                  << juce::String(firstBlockSeconds * 1.0e6 / numInstances, 1).paddedLeft(' ', 16) << std::endl;
+
+        for (auto& processor : processors) {
+            processor->releaseResources();
+        }
+    }
+}
+
+// prepares a session's worth of instances, moves them all to another sample rate and releases
+// them, reporting what the shared delay memory pool holds at each step
+static void printDelayMemoryPoolUsage(const ProcessorUnderTest& processorUnderTest)
+{
+    const int numInstances = 8;
+    const int blockSize = 512;
+
+    juce::SharedResourcePointer<DelayMemoryPool> pool;
+    std::vector<std::unique_ptr<juce::AudioProcessor>> processors;
+
+    for (int i = 0; i < numInstances; i++) {
+        processors.emplace_back(processorUnderTest.create());
+    }
+
+    std::cout << std::endl << processorUnderTest.name << " delay memory pool, " << numInstances << " instances" << std::endl;
+
+    std::cout << juce::String("step").paddedRight(' ', 19)
+              << juce::String("in use kB").paddedLeft(' ', 12)
+              << juce::String("spare kB").paddedLeft(' ', 12) << std::endl;
+
+    auto printStep = [&pool] (const juce::String& step) {
+        std::cout << step.paddedRight(' ', 19)
+                  << juce::String(pool->getBytesInUse() / 1024.0, 1).paddedLeft(' ', 12)
+                  << juce::String(pool->getBytesSpare() / 1024.0, 1).paddedLeft(' ', 12) << std::endl;
+    };
+
+    for (auto sampleRate : { 44100.0, 96000.0, 44100.0 })
+    {
+        for (auto& processor : processors) {
+            processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+            processor->prepareToPlay(sampleRate, blockSize);
+        }
+
+        printStep("prepared at " + juce::String((int) sampleRate));
+    }
+
+    for (auto& processor : processors) {
+        processor->releaseResources();
+    }
+
+    printStep("released");
+}
+
+// saves and restores a session's worth of instances, as a host does, with the binary state and
+// with an XML state of the same parameters for comparison
+static void printStateCost(const ProcessorUnderTest& processorUnderTest)
+{
+    const int numInstances = 256;
+    const int numRounds = 16;
+
+    std::vector<std::unique_ptr<juce::AudioProcessor>> processors;
+
+    for (int i = 0; i < numInstances; i++) {
+        processors.emplace_back(processorUnderTest.create());
+    }
+
+    // every setting in turn, so the restores change something
+    std::vector<juce::MemoryBlock> binaryStates, xmlStates;
+
+    for (auto& setting : processorUnderTest.settings)
+    {
+        auto& processor = *processors.front();
+        applySetting(processor, setting);
+
+        binaryStates.emplace_back();
+        processor.getStateInformation(binaryStates.back());
+
+        juce::XmlElement xml("STATE");
+
+        for (auto* param : processor.getParameters()) {
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param)) {
+                xml.setAttribute(ranged->paramID, ranged->convertFrom0to1(ranged->getValue()));
+            }
+        }
+
+        xmlStates.emplace_back();
+        juce::AudioProcessor::copyXmlToBinary(xml, xmlStates.back());
+    }
+
+    std::cout << std::endl << processorUnderTest.name << " state, " << numInstances << " instances" << std::endl;
+
+    std::cout << juce::String("format").paddedRight(' ', 19)
+              << juce::String("bytes").paddedLeft(' ', 8)
+              << juce::String("save us").paddedLeft(' ', 10)
+              << juce::String("load us").paddedLeft(' ', 10) << std::endl;
+
+    auto printFormat = [] (const juce::String& format, size_t bytes, juce::int64 saveTicks, juce::int64 loadTicks) {
+        const double perInstance = 1.0e6 / (numInstances * numRounds);
+
+        std::cout << format.paddedRight(' ', 19)
+                  << juce::String((int) bytes).paddedLeft(' ', 8)
+                  << juce::String(juce::Time::highResolutionTicksToSeconds(saveTicks) * perInstance, 3).paddedLeft(' ', 10)
+                  << juce::String(juce::Time::highResolutionTicksToSeconds(loadTicks) * perInstance, 3).paddedLeft(' ', 10) << std::endl;
+    };
+
+    juce::int64 saveTicks = 0, loadTicks = 0;
+    juce::MemoryBlock state;
+
+    for (int round = 0; round < numRounds; round++)
+    {
+        auto& saved = binaryStates[(size_t) round % binaryStates.size()];
+
+        auto start = juce::Time::getHighResolutionTicks();
+
+        for (auto& processor : processors) {
+            processor->setStateInformation(saved.getData(), (int) saved.getSize());
+        }
+
+        loadTicks += juce::Time::getHighResolutionTicks() - start;
+        start = juce::Time::getHighResolutionTicks();
+
+        for (auto& processor : processors) {
+            processor->getStateInformation(state);
+        }
+
+        saveTicks += juce::Time::getHighResolutionTicks() - start;
+    }
+
+    printFormat("binary", binaryStates.front().getSize(), saveTicks, loadTicks);
+
+    saveTicks = 0;
+    loadTicks = 0;
+
+    for (int round = 0; round < numRounds; round++)
+    {
+        auto& saved = xmlStates[(size_t) round % xmlStates.size()];
+
+        auto start = juce::Time::getHighResolutionTicks();
+
+        for (auto& processor : processors)
+        {
+            std::unique_ptr<juce::XmlElement> xml(juce::AudioProcessor::getXmlFromBinary(saved.getData(), (int) saved.getSize()));
+
+            for (auto* param : processor->getParameters()) {
+                if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param)) {
+                    ranged->setValueNotifyingHost(ranged->convertTo0to1((float) xml->getDoubleAttribute(ranged->paramID)));
+                }
+            }
+        }
+
+        loadTicks += juce::Time::getHighResolutionTicks() - start;
+        start = juce::Time::getHighResolutionTicks();
+
+        for (auto& processor : processors)
+        {
+            juce::XmlElement xml("STATE");
+
+            for (auto* param : processor->getParameters()) {
+                if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param)) {
+                    xml.setAttribute(ranged->paramID, ranged->convertFrom0to1(ranged->getValue()));
+                }
+            }
+
+            juce::AudioProcessor::copyXmlToBinary(xml, state);
+        }
+
+        saveTicks += juce::Time::getHighResolutionTicks() - start;
+    }
+
+    printFormat("xml", xmlStates.front().getSize(), saveTicks, loadTicks);
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the chorus/flanger's latency timer expects a message manager, as in a host
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    double secondsOfAudio = 1.0;
+    juce::String processorFilter;
+    bool csv = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const juce::String arg(argv[i]);
+
+        if (arg == "--seconds" && i + 1 < argc) {
+            secondsOfAudio = juce::String(argv[++i]).getDoubleValue();
+        } else if (arg == "--processor" && i + 1 < argc) {
+            processorFilter = argv[++i];
+        } else if (arg == "--csv") {
+            csv = true;
+        } else {
+            std::cerr << "usage: KadenzeBenchmark [--seconds <s>] [--processor <plugin|delay|delay-split|chorusflanger|chorusflanger-rot>] [--csv]" << std::endl;
+            return 1;
+        }
+    }
+
+    // the same white noise source is used for every case, so results are comparable
+    juce::AudioBuffer<float> source(kNumChannels, kSourceLength);
+    juce::Random random(0x4b41444e);
+
+    for (int channel = 0; channel < kNumChannels; channel++) {
+        for (int sample = 0; sample < kSourceLength; sample++) {
+            source.setSample(channel, sample, (random.nextFloat() * 2.0f - 1.0f) * 0.25f);
+        }
+    }
+
+    printHeader(csv);
+
+    for (auto& processorUnderTest : createProcessorsUnderTest())
+    {
+        if (processorFilter.isNotEmpty() && processorFilter != processorUnderTest.name) {
+            continue;
+        }
+
+        for (auto& setting : processorUnderTest.settings) {
+            for (auto sampleRate : kSampleRates) {
+                for (auto blockSize : kBlockSizes) {
+                    auto result = runBenchmark(processorUnderTest, setting, sampleRate, blockSize, secondsOfAudio, source);
+                    printResult(csv, processorUnderTest.name, setting.name, sampleRate, blockSize, result);
+                }
+            }
+        }
+
+        // the savings and memory tables are for people, keep the csv a single table
+        if (! csv) {
+            printModulationQualitySavings(processorUnderTest, secondsOfAudio, source);
+            printInterpolationCost(processorUnderTest, secondsOfAudio, source);
+            printEnsembleCost(processorUnderTest, secondsOfAudio, source);
+            printOversamplingCost(processorUnderTest, secondsOfAudio, source);
+            printOfflineProfileCost(processorUnderTest, secondsOfAudio, source);
+            printMemoryFootprint(processorUnderTest);
+            printDelayMemoryPoolUsage(processorUnderTest);
+            printStartupCost(processorUnderTest, source);
+            printIdleCost(processorUnderTest, secondsOfAudio, source);
+            printStateCost(processorUnderTest);
+        }
+    }
+
+    return 0;
+}
@@ -11,11 +11,11 @@
 
 //==============================================================================
 KadenzeChorusFlangerAudioProcessorEditor::KadenzeChorusFlangerAudioProcessorEditor (KadenzeChorusFlangerAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p), mMeterView (p.getMeterFeed(), "lfo", -1.0f, 1.0f)
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    setSize (400, 400);
     
     auto& params = processor.getParameters();
     
@@ -47,6 +47,68 @@ KadenzeChorusFlangerAudioProcessorEditor::KadenzeChorusFlangerAudioProcessorEdit
     };
     
     mType.setSelectedItemIndex(*typeParameter);
+    
+    juce::AudioParameterChoice* modulationQualityParameter = (juce::AudioParameterChoice*) params.getUnchecked(6);
+    mModulationQuality.setBounds(200, 100, 100, 30);
+    mModulationQuality.addItemList(modulationQualityParameter->choices, 1);
+    addAndMakeVisible(mModulationQuality);
+    
+    mModulationQuality.onChange = [this, modulationQualityParameter] {
+        modulationQualityParameter->beginChangeGesture();
+        *modulationQualityParameter = mModulationQuality.getSelectedItemIndex();
+        modulationQualityParameter->endChangeGesture();
+    };
+    
+    mModulationQuality.setSelectedItemIndex(*modulationQualityParameter);
+    
+    juce::AudioParameterChoice* interpolationParameter = (juce::AudioParameterChoice*) params.getUnchecked(7);
+    mInterpolation.setBounds(300, 100, 100, 30);
+    mInterpolation.addItemList(interpolationParameter->choices, 1);
+    addAndMakeVisible(mInterpolation);
+    
+    mInterpolation.onChange = [this, interpolationParameter] {
+        interpolationParameter->beginChangeGesture();
+        *interpolationParameter = mInterpolation.getSelectedItemIndex();
+        interpolationParameter->endChangeGesture();
+    };
+    
+    mInterpolation.setSelectedItemIndex(*interpolationParameter);
+    
+    juce::AudioParameterInt* voicesParameter = (juce::AudioParameterInt*) params.getUnchecked(8);
+    mVoices.setBounds(100, 200, 100, 30);
+    
+    for (int voices = voicesParameter->getRange().getStart(); voices <= voicesParameter->getRange().getEnd(); voices++) {
+        mVoices.addItem(voices == 1 ? "1 Voice" : juce::String(voices) + " Voices", voices);
+    }
+    
+    addAndMakeVisible(mVoices);
+    
+    mVoices.onChange = [this, voicesParameter] {
+        voicesParameter->beginChangeGesture();
+        *voicesParameter = mVoices.getSelectedId();
+        voicesParameter->endChangeGesture();
+    };
+    
+    mVoices.setSelectedId(*voicesParameter);
+    
+    juce::AudioParameterFloat* spreadParameter = (juce::AudioParameterFloat*) params.getUnchecked(9);
+    setSlider(this, &mSpreadSlider, spreadParameter, "spread", 0, 200);
+    
+    juce::AudioParameterChoice* oversamplingParameter = (juce::AudioParameterChoice*) params.getUnchecked(10);
+    mOversampling.setBounds(200, 200, 100, 30);
+    mOversampling.addItemList(oversamplingParameter->choices, 1);
+    addAndMakeVisible(mOversampling);
+    
+    mOversampling.onChange = [this, oversamplingParameter] {
+        oversamplingParameter->beginChangeGesture();
+        *oversamplingParameter = mOversampling.getSelectedItemIndex();
+        oversamplingParameter->endChangeGesture();
+    };
+    
+    mOversampling.setSelectedItemIndex(*oversamplingParameter);
+    
+    mMeterView.setBounds(0, 300, 400, 100);
+    addAndMakeVisible(mMeterView);
 }
 
 KadenzeChorusFlangerAudioProcessorEditor::~KadenzeChorusFlangerAudioProcessorEditor()
@@ -61,7 +123,7 @@ void KadenzeChorusFlangerAudioProcessorEditor::paint (juce::Graphics& g)
 
     g.setColour (juce::Colours::white);
     g.setFont (15.0f);
-    g.drawFittedText ("Chorus Flanger", getLocalBounds(), juce::Justification::centred, 1);
+    g.drawFittedText ("Chorus Flanger", getLocalBounds().withHeight(300), juce::Justification::centred, 1);
 }
 
 void KadenzeChorusFlangerAudioProcessorEditor::resized()
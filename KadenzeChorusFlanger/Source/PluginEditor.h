@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "../../Shared/MeterView.h"
 
 //==============================================================================
 /**
@@ -34,8 +35,15 @@ private:
     juce::Slider mRateSlider;
     juce::Slider mPhaseOffsetSlider;
     juce::Slider mFeedbackSlider;
+    juce::Slider mSpreadSlider;
     
     juce::ComboBox mType;
+    juce::ComboBox mModulationQuality;
+    juce::ComboBox mInterpolation;
+    juce::ComboBox mVoices;
+    juce::ComboBox mOversampling;
+    
+    MeterView mMeterView;
     
     void setSlider(juce::Component* component, juce::Slider* slider, juce::AudioParameterFloat* param, std::string silderTitle, int boundX, int boundY);
 
@@ -9,6 +9,101 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+// how many samples apart the modulation is evaluated, for each "modquality" choice
+static const int kModulationIntervals[] = { 1, 8, 16, 32 };
+
+// the widest layout isBusesLayoutSupported accepts (9.1.6 is 16 channels)
+static const int kMaxNumChannels = 16;
+
+// how long the old and new effect type are crossfaded for when the type changes
+static const float kTypeCrossfadeTime = 0.01f;
+
+// room past the longest modulated delay for the interpolators' extra taps (and the lfo
+// overshooting [-1, 1] by a rounding error)
+static const int kDelayMarginSamples = 4;
+
+// the most read heads the ensemble shares one channel's line between, a whole number of lane groups
+static const int kMaxNumVoices = 16;
+static const int kMaxNumVoiceGroups = kMaxNumVoices / VoiceLanes::kNumLanes;
+
+// every voice's lfo phase offset in cycles, in steps of the golden ratio: the voices fill the cycle
+// about evenly whatever their number, and keep their phase as others join or leave
+static const float kVoicePhases[kMaxNumVoices] =
+{
+    0.000000f, 0.618034f, 0.236068f, 0.854102f, 0.472136f, 0.090170f, 0.708204f, 0.326238f,
+    0.944272f, 0.562306f, 0.180340f, 0.798374f, 0.416408f, 0.034442f, 0.652476f, 0.270510f
+};
+
+namespace
+{
+    // the delay times the lfo sweeps between, per effect type
+    struct ChorusRange
+    {
+        static constexpr float minDelayTime = 0.005f;
+        static constexpr float maxDelayTime = 0.03f;
+    };
+
+    struct FlangerRange
+    {
+        static constexpr float minDelayTime = 0.001f;
+        static constexpr float maxDelayTime = 0.005f;
+    };
+}
+
+//==============================================================================
+// The oversampling changes on the audio thread, which can't post a message or start a timer, so
+// the message thread polls for the latency it publishes. One timer serves every instance, however
+// many there are.
+class KadenzeChorusFlangerAudioProcessor::LatencyReporter : private juce::Timer
+{
+public:
+    // how often the message thread looks for a new latency to report to the host
+    static constexpr int kPollRateHz = 10;
+
+    ~LatencyReporter() override
+    {
+        stopTimer();
+    }
+
+    // any thread, from the processor's constructor and destructor
+    void add(KadenzeChorusFlangerAudioProcessor* processor)
+    {
+        const juce::ScopedLock lock(mLock);
+
+        mProcessors.add(processor);
+
+        // restarting a running timer would put its next callback off again
+        if (! isTimerRunning()) {
+            startTimerHz(kPollRateHz);
+        }
+    }
+
+    void remove(KadenzeChorusFlangerAudioProcessor* processor)
+    {
+        const juce::ScopedLock lock(mLock);
+
+        mProcessors.removeFirstMatchingValue(processor);
+
+        if (mProcessors.isEmpty()) {
+            stopTimer();
+        }
+    }
+
+private:
+
+    void timerCallback() override
+    {
+        const juce::ScopedLock lock(mLock);
+
+        for (auto* processor : mProcessors) {
+            processor->reportLatency();
+        }
+    }
+
+    juce::CriticalSection mLock;
+    juce::Array<KadenzeChorusFlangerAudioProcessor*> mProcessors;
+};
+
 //==============================================================================
 KadenzeChorusFlangerAudioProcessor::KadenzeChorusFlangerAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -61,30 +156,77 @@ KadenzeChorusFlangerAudioProcessor::KadenzeChorusFlangerAudioProcessor()
                                                                     1,
                                                                     0));
     
+    // every 8 samples keeps the interpolation error under 0.05 samples of delay even at the
+    // fastest rate and widest chorus, while skipping most of the lfo work
+    addParameter(mModulationQualityParameter = new juce::AudioParameterChoice("modquality",
+                                                                    "Modulation Quality",
+                                                                    { "Audio Rate", "Every 8 Samples", "Every 16 Samples", "Every 32 Samples" },
+                                                                    1));
+    
+    // how the modulated reads are interpolated, from cheapest to smoothest; Hermite costs little
+    // over linear and keeps the swept delay from dulling the wet signal
+    addParameter(mInterpolationParameter = new juce::AudioParameterChoice("interpolation",
+                                                                    "Interpolation",
+                                                                    { "Linear", "Hermite", "Lagrange 4", "Lagrange 6", "Allpass" },
+                                                                    1));
+    
+    // how many read heads share each channel's line: one is the plain chorus or flanger, more make
+    // an ensemble, every voice on its own lfo phase and pan, for one write and one mix per channel
+    addParameter(mVoicesParameter = new juce::AudioParameterInt("voices",
+                                                                    "Voices",
+                                                                    1,
+                                                                    kMaxNumVoices,
+                                                                    1));
+    
+    // how far apart the ensemble's voices are panned, from all in the centre to edge to edge
+    addParameter(mSpreadParameter = new juce::AudioParameterFloat("spread",
+                                                                    "Spread",
+                                                                    0.0f,
+                                                                    1.0f,
+                                                                    1.0f));
+    
+    // runs the line and lfo at 2 or 4 times the host rate, so the flanger's short, fast sweeps with
+    // high feedback don't alias at 44.1 kHz; the filters around them add latency
+    addParameter(mOversamplingParameter = new juce::AudioParameterChoice("oversampling",
+                                                                    "Oversampling",
+                                                                    { "Off", "2x", "4x" },
+                                                                    0));
+    
+    // sessions saved before the binary state were XML tagged FlangerChorus, so keep the tag
+    mParameterState.initialise("FlangerChorus", getParameters());
+    
+    mPrograms.open("KadenzeChorusFlanger", mParameterState, mPresetFader,
+    {
+        { "Default", {} },
+        { "Subtle Chorus", { { "type", 0.0f }, { "rate", 0.5f }, { "depth", 0.3f }, { "feedback", 0.0f }, { "drywet", 0.4f } } },
+        { "Wide Chorus", { { "type", 0.0f }, { "rate", 1.2f }, { "depth", 0.7f }, { "phaseOffset", 0.25f }, { "feedback", 0.2f } } },
+        { "Jet Flanger", { { "type", 1.0f }, { "rate", 0.15f }, { "depth", 1.0f }, { "feedback", 0.85f } } },
+        { "Vibrato", { { "type", 0.0f }, { "rate", 5.5f }, { "depth", 0.4f }, { "feedback", 0.0f }, { "drywet", 1.0f } } }
+    });
+    
     // Initialize our data to default values
     
-    mCircularBufferLeft = nullptr;
-    mCircularBufferRight = nullptr;
-    mCircularBufferWriteHead = 0;
-    mCircularBufferLength = 0;
+    mMaxBlockSize = 0;
+    
+    mNumOversamplingStages = 0;
+    mInternalSampleRate = 0;
+    mLatencyInSamples = 0;
     
-    mFeedbackLeft = 0;
-    mFeedbackRight = 0;
+    mCurrentType = 0;
+    mPreviousType = 0;
+    mCrossfadeGain = 1;
+    mCrossfadeStep = 1;
     
-    mLFOPhase = 0;
+    mNumVoices = 1;
+    mTargetNumVoices = 0;
+    mTargetSpread = 0;
+    
+    mLatencyReporter->add(this);
 }
 
 KadenzeChorusFlangerAudioProcessor::~KadenzeChorusFlangerAudioProcessor()
 {
-    if (mCircularBufferLeft != nullptr) {
-        delete [] mCircularBufferLeft;
-        mCircularBufferLeft = nullptr;
-    }
-    
-    if (mCircularBufferRight != nullptr) {
-        delete [] mCircularBufferRight;
-        mCircularBufferRight = nullptr;
-    }
+    mLatencyReporter->remove(this);
 }
 
 //==============================================================================
@@ -122,31 +264,58 @@ bool KadenzeChorusFlangerAudioProcessor::isMidiEffect() const
 
 double KadenzeChorusFlangerAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // the current type's longest delay, repeated by the feedback until it falls below the silence threshold
+    const float maxDelayTime = *mTypeParameter == 0 ? ChorusRange::maxDelayTime : FlangerRange::maxDelayTime;
+    
+    return SilenceDetector::getTailLengthSeconds(maxDelayTime, *mFeedbackParameter);
 }
 
 int KadenzeChorusFlangerAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return mPrograms.getNumPrograms();
 }
 
 int KadenzeChorusFlangerAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return mPrograms.getCurrentProgram();
 }
 
 void KadenzeChorusFlangerAudioProcessor::setCurrentProgram (int index)
 {
+    mPrograms.setCurrentProgram(index);
 }
 
 const juce::String KadenzeChorusFlangerAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return mPrograms.getProgramName(index);
 }
 
 void KadenzeChorusFlangerAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    mPrograms.changeProgramName(index, newName);
+}
+
+void KadenzeChorusFlangerAudioProcessor::setNumOversamplingStages(int numStages)
+{
+    mNumOversamplingStages = numStages;
+    mInternalSampleRate = getSampleRate() * (1 << numStages);
+    
+    mLFO.prepare(mInternalSampleRate);
+    mCrossfadeStep = 1.0f / (float)(mInternalSampleRate * kTypeCrossfadeTime);
+    
+    // the next chunk clears the lines and the filters as on a return from silence
+    mSilenceDetector.reset();
+    
+    mLatencyInSamples = Oversampler::getLatencyInSamples(numStages);
+}
+
+void KadenzeChorusFlangerAudioProcessor::reportLatency()
+{
+    const int latencyInSamples = mLatencyInSamples.load();
+    
+    if (latencyInSamples != getLatencySamples()) {
+        setLatencySamples(latencyInSamples);
+    }
 }
 
 //==============================================================================
@@ -154,36 +323,118 @@ void KadenzeChorusFlangerAudioProcessor::prepareToPlay (double sampleRate, int s
 {
     // initialize our data for the current sample rate, and reset things such as phase and writeheads
     
-    // initialize the phase
-    mLFOPhase = 0;
+    const int numChannels = juce::jmax(1, getTotalNumOutputChannels());
+    
+    // size the delay lines for the longest delay the modulation can reach at this sample rate (a few
+    // kB rather than seconds of audio), oversampled as far as it goes so the factor can change without
+    // reallocating; the new line is built and cleared here, and only swapped in under the callback
+    // lock below
+    static_assert(ChorusRange::maxDelayTime >= FlangerRange::maxDelayTime, "the chorus reaches the longest delay");
+    const int maxDelayInSamples = (int)std::ceil(sampleRate * Oversampler::kMaxFactor * ChorusRange::maxDelayTime) + kDelayMarginSamples;
+    
+    MultiChannelDelayLine delayLine;
+    delayLine.prepare(numChannels, maxDelayInSamples);
+    
+    // the host hears of the latency the oversampling adds straight away
+    const int numOversamplingStages = mOversamplingParameter->getIndex();
+    setLatencySamples(Oversampler::getLatencyInSamples(numOversamplingStages));
+    
+    // hosts don't process while preparing, the lock makes sure no block ever sees half the new state;
+    // the old line goes back to the pool once the lock is released
+    const juce::ScopedLock lock(getCallbackLock());
+    
+    mDelayLine.swapWith(delayLine);
+    mSilenceDetector.reset();
+    KADENZE_TRACE_PREPARE(mBlockTrace, "KadenzeChorusFlanger", sampleRate);
+    mMeterFeed.prepare(sampleRate);
+    mRenderProfile.prepare(isNonRealtime());
+    
+    // offline renders run in longer chunks than the host announced; a chunk covers at least one host
+    // sample at the highest oversampling factor
+    const int blockSize = juce::jmax(Oversampler::kMaxFactor, RenderProfile::getBlockSize(isNonRealtime(), samplesPerBlock));
     
-    // calculate the circular buffer length
-    mCircularBufferLength = sampleRate * MAX_DELAY_TIME;
+    // the lfo and crossfade run at the oversampled rate
+    setNumOversamplingStages(numOversamplingStages);
+    mOversampler.prepare(numChannels, blockSize);
     
-    // initialize the left buffer
-    if (mCircularBufferLeft == nullptr) {
-        mCircularBufferLeft = new float[(int)mCircularBufferLength];
+    // the fade runs at the host's rate, what it fades at the internal rate
+    mPresetFader.prepare(sampleRate, numChannels, blockSize);
+    
+    // initialize the lfo's phase
+    mLFO.reset();
+    
+    mOffsetScale.allocate(numChannels, true);
+    
+    for (int channel = 1; channel < numChannels; channel++) {
+        mOffsetScale[channel] = (float)channel / (numChannels - 1);
     }
     
-    // clear any junk data in new buffer
-    juce::zeromem(mCircularBufferLeft, mCircularBufferLength * sizeof(float));
+    mLFOBuffer.setSize(numChannels, blockSize);
+    mModulationBuffer.setSize(numChannels, blockSize);
+    
+    // the lfo starts at phase zero, which is where the control-rate path interpolates from
+    mLastModulation.allocate(numChannels, false);
     
-    // initialize the right buffer
-    if (mCircularBufferRight == nullptr) {
-        mCircularBufferRight = new float[(int)mCircularBufferLength];
+    for (int channel = 0; channel < numChannels; channel++) {
+        mLastModulation[channel] = *mDepthParameter * std::sin(juce::MathConstants<float>::twoPi * *mPhaseOffsetParameter * mOffsetScale[channel]);
     }
     
-    // clear any junk
-    juce::zeromem(mCircularBufferRight, mCircularBufferLength * sizeof(float));
+    mFeedback.allocate(numChannels, true);
+    mChannelPointers.allocate(numChannels, true);
+    mModulationPointers.allocate(numChannels, true);
+    
+    mDelayTimes.allocate(blockSize, true);
+    mDelayedSamples.allocate(blockSize, true);
+    mFadingDelayedSamples.allocate(blockSize, true);
+    mInterpolatorState.allocate(2 * numChannels, true);
+    
+    // the ensemble starts out as the single read head, every other voice silent until it is asked for
+    const int numVoiceValues = numChannels * kMaxNumVoices;
+    
+    mNumVoices = 1;
+    mTargetNumVoices = 0;
+    
+    mLFOPhases.allocate(blockSize, true);
+    mVoiceModulation.allocate(numVoiceValues, true);
+    mVoiceInterpolatorState.allocate(2 * numVoiceValues, true);
+    mVoiceGains.allocate(numVoiceValues, true);
+    mVoiceTargetGains.allocate(numVoiceValues, true);
+    mVoiceGainSteps.allocate(numVoiceValues, true);
+    mVoiceFeedbackGains.allocate(numVoiceValues, true);
+    mVoiceTargetFeedbackGains.allocate(numVoiceValues, true);
+    mVoiceFeedbackGainSteps.allocate(numVoiceValues, true);
     
-    // init the right head to 0
-    mCircularBufferWriteHead = 0;
+    // start on the current type, no crossfade pending
+    mCurrentType = *mTypeParameter;
+    mPreviousType = mCurrentType;
+    mCrossfadeGain = 1;
+    
+    // allocate the per-block parameter ramps and start them at the current values
+    mMaxBlockSize = blockSize;
+    
+    mDryWetRamp.prepare(mMaxBlockSize);
+    mDryWetRamp.reset(*mDryWetParameter);
+    
+    mDepthRamp.prepare(mMaxBlockSize);
+    mDepthRamp.reset(*mDepthParameter);
+    
+    mRateRamp.prepare(mMaxBlockSize);
+    mRateRamp.reset(*mRateParameter);
+    
+    mPhaseOffsetRamp.prepare(mMaxBlockSize);
+    mPhaseOffsetRamp.reset(*mPhaseOffsetParameter);
+    
+    mFeedbackRamp.prepare(mMaxBlockSize);
+    mFeedbackRamp.reset(*mFeedbackParameter);
 }
 
 void KadenzeChorusFlangerAudioProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    // hand the delay memory back to the shared pool until the next prepareToPlay
+    MultiChannelDelayLine delayLine;
+    
+    const juce::ScopedLock lock(getCallbackLock());
+    mDelayLine.swapWith(delayLine);
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -193,12 +444,13 @@ bool KadenzeChorusFlangerAudioProcessor::isBusesLayoutSupported (const BusesLayo
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
+    // Every channel gets its own delay row and lfo offset, so any discrete
+    // or surround layout up to kMaxNumChannels works (mono, stereo, 5.1, 7.1.4, ...).
     // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // load plugins that support stereo bus layouts, so stereo stays the default.
+    const int numChannels = layouts.getMainOutputChannelSet().size();
+    
+    if (numChannels < 1 || numChannels > kMaxNumChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -214,6 +466,7 @@ bool KadenzeChorusFlangerAudioProcessor::isBusesLayoutSupported (const BusesLayo
 
 void KadenzeChorusFlangerAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    KADENZE_TRACE_BLOCK(mBlockTrace, buffer.getNumSamples());
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -234,113 +487,770 @@ void KadenzeChorusFlangerAudioProcessor::processBlock (juce::AudioBuffer<float>&
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
     
-    // obtain the left and right audio data pointers
-    float* leftChannel = buffer.getWritePointer(0);
-    float* rightChannel = buffer.getWritePointer(1);
+    // a host that calls before prepareToPlay gets its audio back untouched, there are no chunks to
+    // work in yet
+    if (mMaxBlockSize == 0) {
+        return;
+    }
+    
+    mMeterFeed.measureInput(buffer.getArrayOfReadPointers(), buffer.getNumChannels(), buffer.getNumSamples());
+    
+    // a change of oversampling restarts the lines at the new rate, behind a fade of the whole output
+    const int numOversamplingStages = mOversamplingParameter->getIndex();
+    
+    if (numOversamplingStages != mNumOversamplingStages) {
+        mPresetFader.requestRestart();
+    }
+    
+    // and a change of the host's mode mid-stream swaps the interpolator and modulation rate behind a
+    // fade of the wet path
+    mRenderProfile.update(isNonRealtime(), mSilenceDetector.isSilent(), mPresetFader);
+    
+    mPresetFader.startBlock();
+    
+    // snapshot every parameter once per block, the sample loop only reads the ramps below; while a
+    // preset switch is pending the wet path stays where it is, and only the mix follows
+    const float dryWetTarget = *mDryWetParameter;
+    float depthTarget = *mDepthParameter;
+    float rateTarget = *mRateParameter;
+    float phaseOffsetTarget = *mPhaseOffsetParameter;
+    float feedbackTarget = *mFeedbackParameter;
+    int type = *mTypeParameter;
     
-    // iterate through all the samples in the buffer
-    for (int sample = 0; sample < buffer.getNumSamples(); sample++)
+    if (mPresetFader.isHolding()) {
+        depthTarget = mDepthRamp.getCurrentValue();
+        rateTarget = mRateRamp.getCurrentValue();
+        phaseOffsetTarget = mPhaseOffsetRamp.getCurrentValue();
+        feedbackTarget = mFeedbackRamp.getCurrentValue();
+        type = mCurrentType;
+    }
+    
+    const int numVoices = *mVoicesParameter;
+    const float spread = *mSpreadParameter;
+    int modulationInterval = mRenderProfile.getModulationInterval(kModulationIntervals[mModulationQualityParameter->getIndex()]);
+    InterpolationType interpolation = mRenderProfile.getInterpolation((InterpolationType) mInterpolationParameter->getIndex());
+    
+    // the host hands over the channels prepareToPlay was told about
+    const int numChannels = mDelayLine.getNumChannels();
+    jassert(buffer.getNumChannels() >= numChannels);
+    
+    // a type change fades from the old type to the new one, going back mid-fade reverses it; the
+    // current read becomes the fading one and takes its interpolator state along
+    if (type != mCurrentType) {
+        mPreviousType = mCurrentType;
+        mCurrentType = type;
+        mCrossfadeGain = mCrossfadeGain < 1 ? 1 - mCrossfadeGain : 0;
+        
+        for (int channel = 0; channel < numChannels; channel++) {
+            std::swap(mInterpolatorState[2 * channel], mInterpolatorState[2 * channel + 1]);
+            
+            float* voiceState = mVoiceInterpolatorState + 2 * channel * kMaxNumVoices;
+            std::swap_ranges(voiceState, voiceState + kMaxNumVoices, voiceState + kMaxNumVoices);
+        }
+    }
+    
+    float* const* channels = buffer.getArrayOfWritePointers();
+    
+    // hosts may send bigger blocks than announced in prepareToPlay, so work in ramp-sized chunks;
+    // everything from the ramps on runs at the internal rate, so an oversampled chunk covers fewer
+    // of the host's samples (as many as either rate fits, while the oversampling is about to change)
+    const int chunkSize = mMaxBlockSize >> juce::jmax(mNumOversamplingStages, numOversamplingStages);
+    int numHostSamples = 0;
+    
+    for (int offset = 0; offset < buffer.getNumSamples(); offset += numHostSamples)
     {
-        // write into our circular buffer
-        mCircularBufferLeft[mCircularBufferWriteHead] = leftChannel[sample] + mFeedbackLeft;
-        mCircularBufferRight[mCircularBufferWriteHead] = rightChannel[sample] + mFeedbackRight;
+        // chunks end where a preset switch's fade starts or ends
+        numHostSamples = mPresetFader.getChunkLength(juce::jmin(chunkSize, buffer.getNumSamples() - offset));
         
-        // generate the left lfo output
-        float lfoOutLeft = sin(2 * M_PI * mLFOPhase);
+        // the wet signal has faded out, the modulation, feedback and type jump to the new preset's,
+        // and the profile to the host's mode (the line keeps what it holds, so the old sweep's tail
+        // carries on); after a restart's fade the whole output is silent, and the lines start again
+        // at the new rate
+        if (mPresetFader.switchesNow()) {
+            depthTarget = *mDepthParameter;
+            rateTarget = *mRateParameter;
+            phaseOffsetTarget = *mPhaseOffsetParameter;
+            feedbackTarget = *mFeedbackParameter;
+            
+            mDepthRamp.reset(depthTarget);
+            mRateRamp.reset(rateTarget);
+            mPhaseOffsetRamp.reset(phaseOffsetTarget);
+            mFeedbackRamp.reset(feedbackTarget);
+            
+            mCurrentType = *mTypeParameter;
+            mPreviousType = mCurrentType;
+            mCrossfadeGain = 1;
+            
+            mRenderProfile.switchNow();
+            modulationInterval = mRenderProfile.getModulationInterval(kModulationIntervals[mModulationQualityParameter->getIndex()]);
+            interpolation = mRenderProfile.getInterpolation((InterpolationType) mInterpolationParameter->getIndex());
+            
+            if (mPresetFader.restartsNow() && numOversamplingStages != mNumOversamplingStages) {
+                setNumOversamplingStages(numOversamplingStages);
+            }
+        }
         
-        // calculate the right channnel lfo phase
-        float lfoPhaseRight = mLFOPhase + *mPhaseOffsetParameter;
+        const float sampleRate = mInternalSampleRate;
+        const int factor = 1 << mNumOversamplingStages;
+        const int numSamples = numHostSamples * factor;
         
-        if (lfoPhaseRight > 1) {
-            lfoPhaseRight -= 1;
-        }
+        const float* dryWet = mDryWetRamp.process(dryWetTarget, numSamples);
+        const float* depth = mDepthRamp.process(depthTarget, numSamples);
+        const float* rate = mRateRamp.process(rateTarget, numSamples);
+        const float* phaseOffset = mPhaseOffsetRamp.process(phaseOffsetTarget, numSamples);
+        const float* feedback = mPresetFader.processFeedback(mFeedbackRamp.process(feedbackTarget, numSamples), numSamples);
         
-        // generate the right channel lfo output
-        float lfoOutRight = sin(2 * M_PI * lfoPhaseRight);
+        // with the input silent and nothing audible left to read, only the dry part of the mix remains;
+        // the lfo keeps its place, so the modulation carries on in time once the input comes back
+        // (oversampled, the dry part skips the filters: it is below the threshold, so their latency
+        // can't be heard)
+        const float inputPeak = SilenceDetector::getPeak(channels, numChannels, offset, numHostSamples);
+        const float maxFeedback = juce::jmax(feedback[0], feedback[numSamples - 1]);
+        const bool wasSilent = mSilenceDetector.isSilent();
+        const int reachInSamples = (int)std::ceil(sampleRate * ChorusRange::maxDelayTime) + kDelayMarginSamples;
         
-        // moving our lfo phase forward
-        mLFOPhase += *mRateParameter / getSampleRate();
+        if (mSilenceDetector.process(inputPeak, maxFeedback, reachInSamples, numSamples)) {
+            for (int channel = 0; channel < numChannels; channel++)
+            {
+                float* audio = channels[channel] + offset;
+                
+                for (int sample = 0; sample < numHostSamples; sample++) {
+                    audio[sample] *= 1 - dryWet[sample * factor + factor - 1];
+                }
+            }
+            
+            mPresetFader.processDry(channels, offset, numChannels, numHostSamples);
+            mLFO.advance(rate, numSamples);
+            continue;
+        }
         
-        if (mLFOPhase > 1) {
-            mLFOPhase -= 1;
+        // back from idle, start again from an empty line (what it held was below the threshold)
+        if (wasSilent) {
+            mDelayLine.clearLazily();
+            
+            juce::FloatVectorOperations::clear(mFeedback, numChannels);
+            juce::FloatVectorOperations::clear(mInterpolatorState, 2 * numChannels);
+            juce::FloatVectorOperations::clear(mVoiceInterpolatorState, 2 * numChannels * kMaxNumVoices);
+            mOversampler.reset();
         }
         
-        // control the lfo depth
-        lfoOutLeft *= *mDepthParameter;
-        lfoOutRight *= *mDepthParameter;
+        // the line is cleared lazily, zero whatever the chunk's reads would find unwritten (nothing
+        // at all once it has been written the whole way round)
+        mDelayLine.ensureReadable(sampleRate * FlangerRange::minDelayTime, sampleRate * ChorusRange::maxDelayTime, numSamples);
+        
+        // the rest of the chunk runs at the internal rate, on the upsampled audio when oversampling
+        float* const* chunkChannels = channels;
+        int chunkOffset = offset;
         
-        float lfoOutMappedLeft = 0;
-        float lfoOutMappedRight = 0;
+        if (mNumOversamplingStages > 0) {
+            chunkChannels = mOversampler.upsample(channels, offset, numChannels, numHostSamples, mNumOversamplingStages);
+            chunkOffset = 0;
+        }
         
-        // map out lfo output to our desired delay times
+        // around a preset switch the wet signal fades, and the dry part of the mix passes straight through
+        mPresetFader.processInput(chunkChannels, chunkOffset, numChannels, numSamples);
         
-        /** chrous */
-        if (*mTypeParameter == 0) {
-            // jmap: Remaps a normalised value (between 0 and 1) to a target range.
-            lfoOutMappedLeft = juce::jmap(lfoOutLeft, -1.f, 1.f, 0.005f, 0.03f);
-            lfoOutMappedRight = juce::jmap(lfoOutRight, -1.f, 1.f, 0.005f, 0.03f);
-        /** flanger */
+        // more than one voice, or a chunk still fading down to one, runs the ensemble instead
+        if (numVoices > 1 || mNumVoices > 1) {
+            processEnsemble(chunkChannels, chunkOffset, rate, phaseOffset, depth, feedback, dryWet, numChannels, numSamples,
+                            numVoices, spread, modulationInterval, interpolation);
         } else {
-            lfoOutMappedLeft = juce::jmap(lfoOutLeft, -1.f, 1.f, 0.001f, 0.005f);
-            lfoOutMappedRight = juce::jmap(lfoOutRight, -1.f, 1.f, 0.001f, 0.005f);
+            processReadHead(chunkChannels, chunkOffset, rate, phaseOffset, depth, feedback, dryWet, numChannels, numSamples,
+                            modulationInterval, interpolation);
         }
         
-        // calculate the delay lengths in samples
-        float delayTimeInSamplesLeft = getSampleRate() * lfoOutMappedLeft;
-        float delayTimeInSamplesRight = getSampleRate() * lfoOutMappedRight;
+        mPresetFader.processDryWet(chunkChannels, chunkOffset, numChannels, numSamples, dryWet);
         
-        // calculate the left read head position
-        float delayReadHeadLeft = mCircularBufferWriteHead - delayTimeInSamplesLeft;
+        if (mNumOversamplingStages > 0) {
+            mOversampler.downsample(channels, offset, numChannels, numHostSamples, mNumOversamplingStages);
+        }
+    }
+    
+    // the scope follows the first channel's lfo, only worked out while an editor is watching
+    const float lfo = mMeterFeed.isActive() ? depthTarget * std::sin(juce::MathConstants<float>::twoPi * mLFO.getPhase()) : 0.0f;
+    mMeterFeed.measureOutput(buffer.getArrayOfReadPointers(), buffer.getNumChannels(), buffer.getNumSamples(), lfo);
+}
+
+//==============================================================================
+void KadenzeChorusFlangerAudioProcessor::processReadHead(float* const* channels, int offset, const float* rate, const float* phaseOffset, const float* depth,
+                                                         const float* feedback, const float* dryWet, int numChannels, int numSamples,
+                                                         int modulationInterval, InterpolationType interpolation)
+{
+    float* const* modulation = mModulationBuffer.getArrayOfWritePointers();
+    
+    // turn the lfo into the chunk's modulation for every channel, lfo * depth in [-1, 1]
+    if (modulationInterval == 1) {
+        mLFO.process(rate, phaseOffset, mOffsetScale, modulation, numChannels, numSamples);
         
-        if (delayReadHeadLeft < 0) {
-            delayReadHeadLeft += mCircularBufferLength;
+        for (int channel = 0; channel < numChannels; channel++) {
+            juce::FloatVectorOperations::multiply(modulation[channel], depth, numSamples);
+            mLastModulation[channel] = modulation[channel][numSamples - 1];
         }
+    } else {
+        // evaluate the modulation at the end of every interval and ramp linearly towards it,
+        // starting from where the previous interval ended
+        float* const* lfo = mLFOBuffer.getArrayOfWritePointers();
+        
+        const int numSegments = mLFO.processDecimated(rate, phaseOffset, mOffsetScale, lfo, numChannels, numSamples, modulationInterval);
         
-        // calculate the right read head position
-        float delayReadHeadRight = mCircularBufferWriteHead - delayTimeInSamplesRight;
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            float* channelModulation = modulation[channel];
+            float lastModulation = mLastModulation[channel];
+            
+            for (int segment = 0; segment < numSegments; segment++)
+            {
+                const int segmentStart = segment * modulationInterval;
+                const int segmentLength = juce::jmin(modulationInterval, numSamples - segmentStart);
+                const int segmentEnd = segmentStart + segmentLength - 1;
+                
+                const float target = lfo[channel][segment] * depth[segmentEnd];
+                const float step = (target - lastModulation) / segmentLength;
+                
+                for (int i = 0; i < segmentLength; i++) {
+                    channelModulation[segmentStart + i] = lastModulation + step * (i + 1);
+                }
+                
+                // land exactly on the control point
+                channelModulation[segmentEnd] = target;
+                lastModulation = target;
+            }
+            
+            mLastModulation[channel] = lastModulation;
+        }
+    }
+    
+    // run the crossfade kernel until the fade is done, and the plain one for the rest
+    int numCrossfadeSamples = 0;
+    
+    if (mCrossfadeGain < 1) {
+        numCrossfadeSamples = juce::jmin(numSamples, (int)std::ceil((1 - mCrossfadeGain) / mCrossfadeStep));
         
-        if (delayReadHeadRight < 0) {
-            delayReadHeadRight += mCircularBufferLength;
+        for (int channel = 0; channel < numChannels; channel++) {
+            mChannelPointers[channel] = channels[channel] + offset;
+            mModulationPointers[channel] = modulation[channel];
         }
         
-        // calculate linear interpolation points for left channel
-        int readHeadLeftX0 = (int)delayReadHeadLeft;
-        int readHeadLeftX1 = readHeadLeftX0 + 1;
-        float readHeadFloatLeft = delayReadHeadLeft - readHeadLeftX0;
+        Kernel kernel = selectKernel(mPreviousType, mCurrentType, numChannels, interpolation);
+        (this->*kernel)(mChannelPointers, mModulationPointers, feedback, dryWet, numChannels, numCrossfadeSamples);
         
-        if (readHeadLeftX1 >= mCircularBufferLength) {
-            readHeadLeftX1 -= mCircularBufferLength;
+        mCrossfadeGain = juce::jmin(1.0f, mCrossfadeGain + numCrossfadeSamples * mCrossfadeStep);
+    }
+    
+    if (numCrossfadeSamples < numSamples) {
+        for (int channel = 0; channel < numChannels; channel++) {
+            mChannelPointers[channel] = channels[channel] + offset + numCrossfadeSamples;
+            mModulationPointers[channel] = modulation[channel] + numCrossfadeSamples;
         }
         
-        int readHeadRightX0 = (int)delayReadHeadRight;
-        int readHeadRightX1 = readHeadRightX0 + 1;
-        float readHeadFloatRight = delayReadHeadRight - readHeadRightX0;
+        Kernel kernel = selectKernel(mCurrentType, mCurrentType, numChannels, interpolation);
+        (this->*kernel)(mChannelPointers, mModulationPointers, feedback + numCrossfadeSamples, dryWet + numCrossfadeSamples, numChannels, numSamples - numCrossfadeSamples);
+    }
+}
+
+//==============================================================================
+template <typename FromRange, typename ToRange, int NumChannels, typename Interpolator>
+void KadenzeChorusFlangerAudioProcessor::processKernel(float* const* channels, const float* const* modulation, const float* feedback, const float* dryWet, int numChannels, int numSamples)
+{
+    // the same range twice is the steady state, otherwise fade from one range's read to the other's
+    const bool crossfading = ! std::is_same<FromRange, ToRange>::value;
+    
+    const float sampleRate = mInternalSampleRate;
+    
+    // map the modulation [-1, 1] onto each range's delay times, as centre + depth * modulation in samples
+    const float toCentre = sampleRate * (ToRange::minDelayTime + ToRange::maxDelayTime) * 0.5f;
+    const float toDepth = sampleRate * (ToRange::maxDelayTime - ToRange::minDelayTime) * 0.5f;
+    const float fromCentre = sampleRate * (FromRange::minDelayTime + FromRange::maxDelayTime) * 0.5f;
+    const float fromDepth = sampleRate * (FromRange::maxDelayTime - FromRange::minDelayTime) * 0.5f;
+    
+    // with the count fixed at compile time the channel loop disappears for mono and stereo
+    if (NumChannels > 0) {
+        numChannels = NumChannels;
+    }
+    
+    // the interpolator reads a whole run before the run is written, so a run has to stay shorter
+    // than the shortest delay either range reaches (less the taps it reads ahead of the delay)
+    const float shortestDelayTime = FromRange::minDelayTime < ToRange::minDelayTime ? FromRange::minDelayTime : ToRange::minDelayTime;
+    const int maxRunLength = juce::jmax(1, (int)(sampleRate * shortestDelayTime) - Interpolator::kNumTapsAhead - 1);
+    
+    // every channel has its own delay row and feedback, so each one runs through the whole chunk
+    // in turn on its own view of the write head
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        MultiChannelDelayLine::Channel delayLine = mDelayLine.getChannel(channel);
+        const DelayTapRow row = delayLine.getTapRow();
+        float& feedbackState = mFeedback[channel];
+        
+        float* audio = channels[channel];
+        const float* channelModulation = modulation[channel];
+        
+        float crossfadeGain = mCrossfadeGain;
+        float feedbackSample = feedbackState;
         
-        if (readHeadRightX1 >= mCircularBufferLength) {
-            readHeadRightX1 -= mCircularBufferLength;
+        for (int start = 0; start < numSamples; start += maxRunLength)
+        {
+            const int runLength = juce::jmin(maxRunLength, numSamples - start);
+            
+            // generate the run's delayed samples (the interpolator wraps the read heads itself)
+            for (int sample = 0; sample < runLength; sample++) {
+                mDelayTimes[sample] = toCentre + toDepth * channelModulation[start + sample];
+            }
+            
+            Interpolator::process(row, delayLine.getWriteHead(), mDelayTimes, mDelayedSamples, runLength, mInterpolatorState[2 * channel]);
+            
+            if (crossfading) {
+                for (int sample = 0; sample < runLength; sample++) {
+                    mDelayTimes[sample] = fromCentre + fromDepth * channelModulation[start + sample];
+                }
+                
+                Interpolator::process(row, delayLine.getWriteHead(), mDelayTimes, mFadingDelayedSamples, runLength, mInterpolatorState[2 * channel + 1]);
+                
+                for (int sample = 0; sample < runLength; sample++) {
+                    crossfadeGain = juce::jmin(1.0f, crossfadeGain + mCrossfadeStep);
+                    mDelayedSamples[sample] = mFadingDelayedSamples[sample] + crossfadeGain * (mDelayedSamples[sample] - mFadingDelayedSamples[sample]);
+                }
+            }
+            
+            // write into our delay line, each delayed sample feeding the next write
+            for (int sample = 0; sample < runLength; sample++)
+            {
+                delayLine.write(audio[start + sample] + feedbackSample);
+                feedbackSample = mDelayedSamples[sample] * feedback[start + sample];
+                delayLine.advance();
+            }
+            
+            for (int sample = 0; sample < runLength; sample++)
+            {
+                float dryAmount = 1 - dryWet[start + sample];
+                float wetAmount  = dryWet[start + sample];
+                
+                audio[start + sample] = audio[start + sample] * dryAmount + mDelayedSamples[sample] * wetAmount;
+            }
         }
         
-        // generate left and right output samples
-        float delaySampleLeft = linInterp(mCircularBufferLeft[readHeadLeftX0], mCircularBufferLeft[readHeadLeftX1], readHeadFloatLeft);
-        float delaySampleRight = linInterp(mCircularBufferRight[readHeadRightX0], mCircularBufferRight[readHeadRightX1], readHeadFloatRight);
+        feedbackState = feedbackSample;
+    }
+    
+    mDelayLine.advance(numSamples);
+}
+
+template <typename FromRange, typename ToRange, typename Interpolator>
+KadenzeChorusFlangerAudioProcessor::Kernel KadenzeChorusFlangerAudioProcessor::selectChannelKernel(int numChannels)
+{
+    if (numChannels == 1) {
+        return &KadenzeChorusFlangerAudioProcessor::processKernel<FromRange, ToRange, 1, Interpolator>;
+    }
+    
+    if (numChannels == 2) {
+        return &KadenzeChorusFlangerAudioProcessor::processKernel<FromRange, ToRange, 2, Interpolator>;
+    }
+    
+    return &KadenzeChorusFlangerAudioProcessor::processKernel<FromRange, ToRange, 0, Interpolator>;
+}
+
+template <typename FromRange, typename ToRange>
+KadenzeChorusFlangerAudioProcessor::Kernel KadenzeChorusFlangerAudioProcessor::selectInterpolatorKernel(int numChannels, InterpolationType interpolation)
+{
+    switch (interpolation)
+    {
+        case InterpolationType::hermite:    return selectChannelKernel<FromRange, ToRange, Interpolators::Hermite>(numChannels);
+        case InterpolationType::lagrange4:  return selectChannelKernel<FromRange, ToRange, Interpolators::Lagrange4>(numChannels);
+        case InterpolationType::lagrange6:  return selectChannelKernel<FromRange, ToRange, Interpolators::Lagrange6>(numChannels);
+        case InterpolationType::allpass:    return selectChannelKernel<FromRange, ToRange, Interpolators::Allpass>(numChannels);
+        case InterpolationType::linear:
+        default:                            return selectChannelKernel<FromRange, ToRange, Interpolators::Linear>(numChannels);
+    }
+}
+
+KadenzeChorusFlangerAudioProcessor::Kernel KadenzeChorusFlangerAudioProcessor::selectKernel(int fromType, int toType, int numChannels, InterpolationType interpolation)
+{
+    if (fromType == 0) {
+        return toType == 0 ? selectInterpolatorKernel<ChorusRange, ChorusRange>(numChannels, interpolation)
+                           : selectInterpolatorKernel<ChorusRange, FlangerRange>(numChannels, interpolation);
+    }
+    
+    return toType == 0 ? selectInterpolatorKernel<FlangerRange, ChorusRange>(numChannels, interpolation)
+                       : selectInterpolatorKernel<FlangerRange, FlangerRange>(numChannels, interpolation);
+}
+
+void KadenzeChorusFlangerAudioProcessor::processEnsemble(float* const* channels, int offset, const float* rate, const float* phaseOffset, const float* depth,
+                                                         const float* feedback, const float* dryWet, int numChannels, int numSamples,
+                                                         int numVoices, float spread, int modulationInterval, InterpolationType interpolation)
+{
+    // the single read head carries on as voice 0, at the full gain it had on every channel
+    if (mNumVoices == 1) {
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            const int voice = channel * kMaxNumVoices;
+            
+            mVoiceModulation[voice] = mLastModulation[channel];
+            mVoiceInterpolatorState[2 * voice] = mInterpolatorState[2 * channel];
+            mVoiceInterpolatorState[2 * voice + kMaxNumVoices] = mInterpolatorState[2 * channel + 1];
+            mVoiceGains[voice] = 1;
+            mVoiceFeedbackGains[voice] = 1;
+        }
+    }
+    
+    mLFO.processPhase(rate, mLFOPhases, numSamples);
+    
+    // voices joining start from where their lfo is, at no gain (they were faded out when they left)
+    for (int voice = mNumVoices; voice < numVoices; voice++) {
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            const float phase = mLFOPhases[0] + kVoicePhases[voice] + phaseOffset[0] * mOffsetScale[channel];
+            float* voiceState = mVoiceInterpolatorState + 2 * channel * kMaxNumVoices;
+            
+            mVoiceModulation[channel * kMaxNumVoices + voice] = depth[0] * std::sin(juce::MathConstants<float>::twoPi * phase);
+            voiceState[voice] = 0;
+            voiceState[kMaxNumVoices + voice] = 0;
+        }
+    }
+    
+    // ramp every voice's gains to where the voice count and spread put them over the chunk, so
+    // voices fade in and out and move across the field without a click
+    if (numVoices != mTargetNumVoices || spread != mTargetSpread) {
+        updateVoiceTargets(numVoices, spread, numChannels);
+    }
+    
+    const int numVoiceValues = numChannels * kMaxNumVoices;
+    const float inverseNumSamples = 1.0f / numSamples;
+    
+    for (int i = 0; i < numVoiceValues; i++) {
+        mVoiceGainSteps[i] = (mVoiceTargetGains[i] - mVoiceGains[i]) * inverseNumSamples;
+        mVoiceFeedbackGainSteps[i] = (mVoiceTargetFeedbackGains[i] - mVoiceFeedbackGains[i]) * inverseNumSamples;
+    }
+    
+    // the voices fading out still run this chunk
+    const int numVoiceGroups = (juce::jmax(numVoices, mNumVoices) + VoiceLanes::kNumLanes - 1) / VoiceLanes::kNumLanes;
+    
+    // as the single read head, the crossfade kernel until the type fade is done and the plain one after
+    int numCrossfadeSamples = 0;
+    
+    for (int channel = 0; channel < numChannels; channel++) {
+        mChannelPointers[channel] = channels[channel] + offset;
+    }
+    
+    if (mCrossfadeGain < 1) {
+        numCrossfadeSamples = juce::jmin(numSamples, (int)std::ceil((1 - mCrossfadeGain) / mCrossfadeStep));
         
-        mFeedbackLeft = delaySampleLeft * *mFeedbackParameter;
-        mFeedbackRight = delaySampleRight * *mFeedbackParameter;
+        EnsembleKernel kernel = selectEnsembleKernel(mPreviousType, mCurrentType, numVoiceGroups, interpolation);
+        (this->*kernel)(mChannelPointers, mLFOPhases, phaseOffset, depth, feedback, dryWet, numChannels, numCrossfadeSamples, modulationInterval);
         
-        mCircularBufferWriteHead++;
+        mCrossfadeGain = juce::jmin(1.0f, mCrossfadeGain + numCrossfadeSamples * mCrossfadeStep);
+    }
+    
+    if (numCrossfadeSamples < numSamples) {
+        const int start = numCrossfadeSamples;
         
-        if (mCircularBufferWriteHead >= mCircularBufferLength) {
-            mCircularBufferWriteHead = 0;
+        for (int channel = 0; channel < numChannels; channel++) {
+            mChannelPointers[channel] = channels[channel] + offset + start;
         }
         
-        float dryAmount = 1 - *mDryWetParameter;
-        float wetAmount  = *mDryWetParameter;
+        EnsembleKernel kernel = selectEnsembleKernel(mCurrentType, mCurrentType, numVoiceGroups, interpolation);
+        (this->*kernel)(mChannelPointers, mLFOPhases + start, phaseOffset + start, depth + start, feedback + start, dryWet + start,
+                        numChannels, numSamples - start, modulationInterval);
+    }
+    
+    // land exactly on the targets
+    juce::FloatVectorOperations::copy(mVoiceGains, mVoiceTargetGains, numVoiceValues);
+    juce::FloatVectorOperations::copy(mVoiceFeedbackGains, mVoiceTargetFeedbackGains, numVoiceValues);
+    
+    // faded down to voice 0 alone, which is the single read head from here on
+    if (numVoices == 1) {
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            const int voice = channel * kMaxNumVoices;
+            
+            mLastModulation[channel] = mVoiceModulation[voice];
+            mInterpolatorState[2 * channel] = mVoiceInterpolatorState[2 * voice];
+            mInterpolatorState[2 * channel + 1] = mVoiceInterpolatorState[2 * voice + kMaxNumVoices];
+        }
+    }
+    
+    mNumVoices = numVoices;
+}
+
+void KadenzeChorusFlangerAudioProcessor::updateVoiceTargets(int numVoices, float spread, int numChannels)
+{
+    mTargetNumVoices = numVoices;
+    mTargetSpread = spread;
+    
+    juce::FloatVectorOperations::clear(mVoiceTargetGains, numChannels * kMaxNumVoices);
+    juce::FloatVectorOperations::clear(mVoiceTargetFeedbackGains, numChannels * kMaxNumVoices);
+    
+    // the voices are far enough apart to add up in power, so the mix scales by 1 / sqrt(voices) to
+    // keep the wet level; the feedback takes their plain mean, so the loop gain stays what one voice's was
+    const float mixGain = 1.0f / std::sqrt((float)numVoices);
+    const float feedbackGain = 1.0f / numVoices;
+    
+    for (int voice = 0; voice < numVoices; voice++)
+    {
+        // evenly from the first channel to the last at full spread, all in the middle at none
+        const float position = numVoices > 1 ? 0.5f + spread * ((float)voice / (numVoices - 1) - 0.5f) : 0.5f;
+        float* voiceGains = mVoiceTargetGains + voice;
+        
+        // a lone voice (the single read head) and a mono bus take every voice whole
+        if (numVoices == 1 || numChannels == 1) {
+            for (int channel = 0; channel < numChannels; channel++) {
+                voiceGains[channel * kMaxNumVoices] = mixGain;
+            }
+        } else {
+            // a cosine of the distance to each channel, scaled so the voice has as much power over
+            // all the channels as the single read head (for stereo, the equal-power pan law)
+            float power = 0;
+            
+            for (int channel = 0; channel < numChannels; channel++)
+            {
+                const float distance = juce::jmin(1.0f, std::abs(mOffsetScale[channel] - position));
+                const float pan = std::cos(juce::MathConstants<float>::halfPi * distance);
+                
+                voiceGains[channel * kMaxNumVoices] = pan;
+                power += pan * pan;
+            }
+            
+            const float scale = mixGain * std::sqrt(numChannels / power);
+            
+            for (int channel = 0; channel < numChannels; channel++) {
+                voiceGains[channel * kMaxNumVoices] *= scale;
+            }
+        }
         
-        buffer.setSample(0, sample,  buffer.getSample(0, sample) * dryAmount + delaySampleLeft * wetAmount);
-        buffer.setSample(1, sample,  buffer.getSample(1, sample) * dryAmount + delaySampleRight * wetAmount);
+        for (int channel = 0; channel < numChannels; channel++) {
+            mVoiceTargetFeedbackGains[channel * kMaxNumVoices + voice] = feedbackGain;
+        }
     }
 }
 
+template <typename FromRange, typename ToRange, int NumVoiceGroups, typename Interpolator>
+void KadenzeChorusFlangerAudioProcessor::processEnsembleKernel(float* const* channels, const float* phases, const float* phaseOffset, const float* depth, const float* feedback, const float* dryWet, int numChannels, int numSamples, int interval)
+{
+    typedef VoiceLanesInterpolators::Reader<Interpolator> Reader;
+    
+    const bool crossfading = ! std::is_same<FromRange, ToRange>::value;
+    
+    const float sampleRate = mInternalSampleRate;
+    
+    // as processKernel, centre + depth * modulation in samples, for four voices at a time
+    const VoiceLanes toCentre = VoiceLanes::broadcast(sampleRate * (ToRange::minDelayTime + ToRange::maxDelayTime) * 0.5f);
+    const VoiceLanes toDepth = VoiceLanes::broadcast(sampleRate * (ToRange::maxDelayTime - ToRange::minDelayTime) * 0.5f);
+    const VoiceLanes fromCentre = VoiceLanes::broadcast(sampleRate * (FromRange::minDelayTime + FromRange::maxDelayTime) * 0.5f);
+    const VoiceLanes fromDepth = VoiceLanes::broadcast(sampleRate * (FromRange::maxDelayTime - FromRange::minDelayTime) * 0.5f);
+    
+    // with the group count fixed at compile time the voice loops unroll, and every voice's state
+    // stays in registers through the run
+    VoiceLanes voicePhases[NumVoiceGroups];
+    
+    for (int group = 0; group < NumVoiceGroups; group++) {
+        voicePhases[group] = VoiceLanes::load(kVoicePhases + group * VoiceLanes::kNumLanes);
+    }
+    
+    // as processKernel, a run of reads has to stay shorter than the shortest delay, less the taps
+    // read ahead of it, since it is read before it is written
+    const float shortestDelayTime = FromRange::minDelayTime < ToRange::minDelayTime ? FromRange::minDelayTime : ToRange::minDelayTime;
+    const int maxRunLength = juce::jmax(1, (int)(sampleRate * shortestDelayTime) - Interpolator::kNumTapsAhead - 1);
+    
+    // every channel's voices read its one line, so the write, feedback and mix happen once per
+    // channel and sample however many voices there are
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        MultiChannelDelayLine::Channel delayLine = mDelayLine.getChannel(channel);
+        const DelayTapRow row = delayLine.getTapRow();
+        
+        float* audio = channels[channel];
+        const float offsetScale = mOffsetScale[channel];
+        
+        float* voiceModulation = mVoiceModulation + channel * kMaxNumVoices;
+        float* voiceState = mVoiceInterpolatorState + 2 * channel * kMaxNumVoices;
+        float* voiceGains = mVoiceGains + channel * kMaxNumVoices;
+        float* voiceFeedbackGains = mVoiceFeedbackGains + channel * kMaxNumVoices;
+        const float* voiceGainSteps = mVoiceGainSteps + channel * kMaxNumVoices;
+        const float* voiceFeedbackGainSteps = mVoiceFeedbackGainSteps + channel * kMaxNumVoices;
+        
+        VoiceLanes modulation[NumVoiceGroups];
+        VoiceLanes toState[NumVoiceGroups];
+        VoiceLanes fromState[NumVoiceGroups];
+        VoiceLanes gains[NumVoiceGroups];
+        VoiceLanes gainSteps[NumVoiceGroups];
+        VoiceLanes feedbackGains[NumVoiceGroups];
+        VoiceLanes feedbackGainSteps[NumVoiceGroups];
+        
+        for (int group = 0; group < NumVoiceGroups; group++)
+        {
+            const int first = group * VoiceLanes::kNumLanes;
+            
+            modulation[group] = VoiceLanes::load(voiceModulation + first);
+            toState[group] = VoiceLanes::load(voiceState + first);
+            fromState[group] = VoiceLanes::load(voiceState + kMaxNumVoices + first);
+            gains[group] = VoiceLanes::load(voiceGains + first);
+            gainSteps[group] = VoiceLanes::load(voiceGainSteps + first);
+            feedbackGains[group] = VoiceLanes::load(voiceFeedbackGains + first);
+            feedbackGainSteps[group] = VoiceLanes::load(voiceFeedbackGainSteps + first);
+        }
+        
+        VoiceLanes targets[NumVoiceGroups];
+        VoiceLanes steps[NumVoiceGroups];
+        int segmentEnd = 0;
+        
+        // every voice's modulation at the last sample of the segment that starts at sample, reached
+        // in equal steps from where it is now (every sample, at audio rate)
+        auto startSegment = [&] (int sample)
+        {
+            segmentEnd = juce::jmin(sample + interval, numSamples) - 1;
+            
+            const VoiceLanes endPhase = VoiceLanes::broadcast(phases[segmentEnd] + phaseOffset[segmentEnd] * offsetScale);
+            const VoiceLanes endDepth = VoiceLanes::broadcast(depth[segmentEnd]);
+            const VoiceLanes inverseLength = VoiceLanes::broadcast(1.0f / (segmentEnd - sample + 1));
+            
+            for (int group = 0; group < NumVoiceGroups; group++) {
+                targets[group] = VoiceLanes::sine(endPhase + voicePhases[group]) * endDepth;
+                steps[group] = (targets[group] - modulation[group]) * inverseLength;
+            }
+        };
+        
+        startSegment(0);
+        
+        float crossfadeGain = mCrossfadeGain;
+        float feedbackSample = mFeedback[channel];
+        
+        for (int start = 0; start < numSamples; start += maxRunLength)
+        {
+            const int runLength = juce::jmin(maxRunLength, numSamples - start);
+            
+            // every voice's read for the run, summed into the channel's wet sample and the mean
+            // the feedback takes
+            for (int sample = start; sample < start + runLength; sample++)
+            {
+                if (sample > segmentEnd) {
+                    startSegment(sample);
+                }
+                
+                const int writeHead = delayLine.getWriteHead() + sample - start;
+                
+                VoiceLanes wet = VoiceLanes::broadcast(0.0f);
+                VoiceLanes delayedMean = VoiceLanes::broadcast(0.0f);
+                
+                if (crossfading) {
+                    crossfadeGain = juce::jmin(1.0f, crossfadeGain + mCrossfadeStep);
+                }
+                
+                for (int group = 0; group < NumVoiceGroups; group++)
+                {
+                    modulation[group] = modulation[group] + steps[group];
+                    
+                    VoiceLanes delayed = Reader::read(row, writeHead, toCentre + toDepth * modulation[group], toState[group]);
+                    
+                    if (crossfading) {
+                        const VoiceLanes fading = Reader::read(row, writeHead, fromCentre + fromDepth * modulation[group], fromState[group]);
+                        delayed = fading + VoiceLanes::broadcast(crossfadeGain) * (delayed - fading);
+                    }
+                    
+                    gains[group] = gains[group] + gainSteps[group];
+                    feedbackGains[group] = feedbackGains[group] + feedbackGainSteps[group];
+                    
+                    wet = wet + delayed * gains[group];
+                    delayedMean = delayedMean + delayed * feedbackGains[group];
+                }
+                
+                mDelayedSamples[sample - start] = wet.sum();
+                mFadingDelayedSamples[sample - start] = delayedMean.sum();
+                
+                // land exactly on the control point
+                if (sample == segmentEnd) {
+                    for (int group = 0; group < NumVoiceGroups; group++) {
+                        modulation[group] = targets[group];
+                    }
+                }
+            }
+            
+            // write into our delay line, each sample's voices feeding the next write
+            for (int sample = 0; sample < runLength; sample++)
+            {
+                delayLine.write(audio[start + sample] + feedbackSample);
+                feedbackSample = mFadingDelayedSamples[sample] * feedback[start + sample];
+                delayLine.advance();
+            }
+            
+            for (int sample = 0; sample < runLength; sample++)
+            {
+                float dryAmount = 1 - dryWet[start + sample];
+                float wetAmount  = dryWet[start + sample];
+                
+                audio[start + sample] = audio[start + sample] * dryAmount + mDelayedSamples[sample] * wetAmount;
+            }
+        }
+        
+        for (int group = 0; group < NumVoiceGroups; group++)
+        {
+            const int first = group * VoiceLanes::kNumLanes;
+            
+            modulation[group].store(voiceModulation + first);
+            toState[group].store(voiceState + first);
+            fromState[group].store(voiceState + kMaxNumVoices + first);
+            gains[group].store(voiceGains + first);
+            feedbackGains[group].store(voiceFeedbackGains + first);
+        }
+        
+        mFeedback[channel] = feedbackSample;
+    }
+    
+    mDelayLine.advance(numSamples);
+}
+
+template <typename FromRange, typename ToRange, typename Interpolator>
+KadenzeChorusFlangerAudioProcessor::EnsembleKernel KadenzeChorusFlangerAudioProcessor::selectVoiceGroupKernel(int numVoiceGroups)
+{
+    static_assert(kMaxNumVoiceGroups == 4, "one kernel per group count");
+    
+    switch (numVoiceGroups)
+    {
+        case 1:     return &KadenzeChorusFlangerAudioProcessor::processEnsembleKernel<FromRange, ToRange, 1, Interpolator>;
+        case 2:     return &KadenzeChorusFlangerAudioProcessor::processEnsembleKernel<FromRange, ToRange, 2, Interpolator>;
+        case 3:     return &KadenzeChorusFlangerAudioProcessor::processEnsembleKernel<FromRange, ToRange, 3, Interpolator>;
+        default:    return &KadenzeChorusFlangerAudioProcessor::processEnsembleKernel<FromRange, ToRange, 4, Interpolator>;
+    }
+}
+
+template <typename FromRange, typename ToRange>
+KadenzeChorusFlangerAudioProcessor::EnsembleKernel KadenzeChorusFlangerAudioProcessor::selectEnsembleInterpolatorKernel(int numVoiceGroups, InterpolationType interpolation)
+{
+    switch (interpolation)
+    {
+        case InterpolationType::hermite:    return selectVoiceGroupKernel<FromRange, ToRange, Interpolators::Hermite>(numVoiceGroups);
+        case InterpolationType::lagrange4:  return selectVoiceGroupKernel<FromRange, ToRange, Interpolators::Lagrange4>(numVoiceGroups);
+        case InterpolationType::lagrange6:  return selectVoiceGroupKernel<FromRange, ToRange, Interpolators::Lagrange6>(numVoiceGroups);
+        case InterpolationType::allpass:    return selectVoiceGroupKernel<FromRange, ToRange, Interpolators::Allpass>(numVoiceGroups);
+        case InterpolationType::linear:
+        default:                            return selectVoiceGroupKernel<FromRange, ToRange, Interpolators::Linear>(numVoiceGroups);
+    }
+}
+
+KadenzeChorusFlangerAudioProcessor::EnsembleKernel KadenzeChorusFlangerAudioProcessor::selectEnsembleKernel(int fromType, int toType, int numVoiceGroups, InterpolationType interpolation)
+{
+    if (fromType == 0) {
+        return toType == 0 ? selectEnsembleInterpolatorKernel<ChorusRange, ChorusRange>(numVoiceGroups, interpolation)
+                           : selectEnsembleInterpolatorKernel<ChorusRange, FlangerRange>(numVoiceGroups, interpolation);
+    }
+    
+    return toType == 0 ? selectEnsembleInterpolatorKernel<FlangerRange, ChorusRange>(numVoiceGroups, interpolation)
+                       : selectEnsembleInterpolatorKernel<FlangerRange, FlangerRange>(numVoiceGroups, interpolation);
+}
+
+size_t KadenzeChorusFlangerAudioProcessor::getMemoryFootprint() const
+{
+    const size_t bufferSize = (size_t)(mLFOBuffer.getNumChannels() * mLFOBuffer.getNumSamples()
+                                     + mModulationBuffer.getNumChannels() * mModulationBuffer.getNumSamples()
+                                     + 4 * mMaxBlockSize
+                                     + 9 * mDelayLine.getNumChannels() * kMaxNumVoices) * sizeof(float);
+    
+    return sizeof(*this)
+        + mDelayLine.getMemoryFootprint()
+        + mOversampler.getMemoryFootprint()
+        + mMeterFeed.getMemoryFootprint()
+        + mDryWetRamp.getMemoryFootprint() + mDepthRamp.getMemoryFootprint() + mRateRamp.getMemoryFootprint()
+        + mPhaseOffsetRamp.getMemoryFootprint() + mFeedbackRamp.getMemoryFootprint()
+        + bufferSize;
+}
+
 //==============================================================================
 bool KadenzeChorusFlangerAudioProcessor::hasEditor() const
 {
@@ -355,20 +1265,16 @@ juce::AudioProcessorEditor* KadenzeChorusFlangerAudioProcessor::createEditor()
 //==============================================================================
 void KadenzeChorusFlangerAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    std::unique_ptr<juce::XmlElement> xml(new juce::XmlElement("FlangerChorus"));
-    
-    xml->setAttribute("DryWet", *mDryWetParameter);
-    xml->setAttribute("Depth", *mDepthParameter);
-    xml->setAttribute("Rate", *mRateParameter);
-    xml->setAttribute("PhaseOffset", *mPhaseOffsetParameter);
-    xml->setAttribute("Feedback", *mFeedbackParameter);
-    xml->setAttribute("Type", *mTypeParameter);
-    
-    copyXmlToBinary(*xml, destData);
+    mParameterState.save(destData);
 }
 
 void KadenzeChorusFlangerAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    if (mParameterState.restore(data, sizeInBytes)) {
+        return;
+    }
+    
+    // sessions saved before the binary state hold XML
     std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
     
     if (xml.get() != nullptr && xml->hasTagName(("FlangerChorus"))) {
@@ -378,16 +1284,24 @@ void KadenzeChorusFlangerAudioProcessor::setStateInformation (const void* data,
         *mPhaseOffsetParameter = xml->getDoubleAttribute(("PhaseOffset"));
         *mFeedbackParameter = xml->getDoubleAttribute(("Feedback"));
         *mTypeParameter = xml->getIntAttribute("Type");
+        
+        // sessions saved before the quality setting existed keep the default
+        if (xml->hasAttribute("ModulationQuality")) {
+            *mModulationQualityParameter = xml->getIntAttribute("ModulationQuality");
+        }
+        
+        // and ones saved before the interpolation setting keep the linear reads they were made with
+        *mInterpolationParameter = xml->getIntAttribute("Interpolation", (int) InterpolationType::linear);
     }
 }
 
 //==============================================================================
 // This creates new instances of the plugin..
+// (headless hosts such as KadenzeBenchmark link all three processors into one
+// binary, so they define KADENZE_HEADLESS and construct the processors directly)
+#if ! KADENZE_HEADLESS
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new KadenzeChorusFlangerAudioProcessor();
 }
-
-float KadenzeChorusFlangerAudioProcessor::linInterp(float sampleX0, float sampleX1, float inPhase) {
-    return (1 - inPhase) * sampleX0 + inPhase * sampleX1;
-}
+#endif
@@ -9,8 +9,18 @@
 #pragma once
 
 #include <JuceHeader.h>
-
-#define MAX_DELAY_TIME 2
+#include "../../Shared/BlockTrace.h"
+#include "../../Shared/MultiChannelDelayLine.h"
+#include "../../Shared/Interpolators.h"
+#include "../../Shared/LFO.h"
+#include "../../Shared/MeterFeed.h"
+#include "../../Shared/Oversampler.h"
+#include "../../Shared/ParameterRamp.h"
+#include "../../Shared/ParameterState.h"
+#include "../../Shared/PresetPrograms.h"
+#include "../../Shared/RenderProfile.h"
+#include "../../Shared/SilenceDetector.h"
+#include "../../Shared/VoiceLanes.h"
 
 //==============================================================================
 /**
@@ -55,10 +65,78 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
     
-    float linInterp(float sampleX0, float sampleX1, float inPhase);
+    //==============================================================================
+    // choose how the modulation is generated (wavetable by default), call before playback starts
+    void setLFOBackend(LFO::Backend backend) { mLFO.setBackend(backend); }
+    
+    // bytes this instance owns once prepared: the object itself plus its delay lines and buffers
+    // (the lfo's sine table is shared by every instance, so it is not counted)
+    size_t getMemoryFootprint() const;
+    
+    // what the editor's meters and lfo scope show
+    MeterFeed& getMeterFeed() { return mMeterFeed; }
 
 private:
     
+    // runs the line and lfo 1 << numStages times faster than the host from here on; the lines have
+    // to start again empty, so this is only called while nothing is heard
+    void setNumOversamplingStages(int numStages);
+    
+    // tells the host the latency the oversampling adds, on the message thread, once the audio
+    // thread has published a new one (the audio thread mustn't post messages itself)
+    void reportLatency();
+    
+    // one timer, shared by every instance, that calls reportLatency() on each of them
+    class LatencyReporter;
+    
+    // Processing Kernels
+    
+    // one chunk of the delay-line loop, with the effect type (delay range), channel count and
+    // read interpolation fixed at compile time; FromRange != ToRange crossfades between the two,
+    // and NumChannels == 0 takes the channel count from numChannels instead
+    typedef void (KadenzeChorusFlangerAudioProcessor::*Kernel)(float* const* channels, const float* const* modulation, const float* feedback, const float* dryWet, int numChannels, int numSamples);
+    
+    template <typename FromRange, typename ToRange, int NumChannels, typename Interpolator>
+    void processKernel(float* const* channels, const float* const* modulation, const float* feedback, const float* dryWet, int numChannels, int numSamples);
+    
+    template <typename FromRange, typename ToRange, typename Interpolator>
+    static Kernel selectChannelKernel(int numChannels);
+    
+    template <typename FromRange, typename ToRange>
+    static Kernel selectInterpolatorKernel(int numChannels, InterpolationType interpolation);
+    
+    static Kernel selectKernel(int fromType, int toType, int numChannels, InterpolationType interpolation);
+    
+    // the ensemble's chunk loop: every channel's line is read by NumVoiceGroups groups of
+    // VoiceLanes::kNumLanes voices, each voice evaluating its own lfo every interval samples from
+    // the chunk's lfo phases; FromRange != ToRange crossfades as processKernel does
+    typedef void (KadenzeChorusFlangerAudioProcessor::*EnsembleKernel)(float* const* channels, const float* phases, const float* phaseOffset, const float* depth, const float* feedback, const float* dryWet, int numChannels, int numSamples, int interval);
+    
+    template <typename FromRange, typename ToRange, int NumVoiceGroups, typename Interpolator>
+    void processEnsembleKernel(float* const* channels, const float* phases, const float* phaseOffset, const float* depth, const float* feedback, const float* dryWet, int numChannels, int numSamples, int interval);
+    
+    template <typename FromRange, typename ToRange, typename Interpolator>
+    static EnsembleKernel selectVoiceGroupKernel(int numVoiceGroups);
+    
+    template <typename FromRange, typename ToRange>
+    static EnsembleKernel selectEnsembleInterpolatorKernel(int numVoiceGroups, InterpolationType interpolation);
+    
+    static EnsembleKernel selectEnsembleKernel(int fromType, int toType, int numVoiceGroups, InterpolationType interpolation);
+    
+    // one chunk of the single read head, from the lfo on
+    void processReadHead(float* const* channels, int offset, const float* rate, const float* phaseOffset, const float* depth,
+                         const float* feedback, const float* dryWet, int numChannels, int numSamples,
+                         int modulationInterval, InterpolationType interpolation);
+    
+    // one chunk of the ensemble, from the lfo on; also hands the single read head's state over to
+    // voice 0 when the ensemble starts, and back once it has faded down to that one voice
+    void processEnsemble(float* const* channels, int offset, const float* rate, const float* phaseOffset, const float* depth,
+                         const float* feedback, const float* dryWet, int numChannels, int numSamples,
+                         int numVoices, float spread, int modulationInterval, InterpolationType interpolation);
+    
+    // the mix and feedback gains every voice settles on for numVoices voices spread this wide
+    void updateVoiceTargets(int numVoices, float spread, int numChannels);
+    
     // Parameter Declarations
 
     juce::AudioParameterFloat* mDryWetParameter;
@@ -67,21 +145,123 @@ private:
     juce::AudioParameterFloat* mPhaseOffsetParameter;
     juce::AudioParameterFloat* mFeedbackParameter;
     juce::AudioParameterInt* mTypeParameter;
+    juce::AudioParameterChoice* mModulationQualityParameter;
+    juce::AudioParameterChoice* mInterpolationParameter;
+    juce::AudioParameterInt* mVoicesParameter;
+    juce::AudioParameterFloat* mSpreadParameter;
+    juce::AudioParameterChoice* mOversamplingParameter;
+    
+    // Per-block Parameter Snapshots
+    
+    ParameterRamp mDryWetRamp;
+    ParameterRamp mDepthRamp;
+    ParameterRamp mRateRamp { ParameterRamp::Shape::exponential };
+    ParameterRamp mPhaseOffsetRamp;
+    ParameterRamp mFeedbackRamp;
+    
+    // the most samples a chunk covers at the internal rate
+    int mMaxBlockSize;
     
-    // Circular Buffer Data
+    // Oversampling Data
     
-    int mCircularBufferWriteHead;
-    int mCircularBufferLength;
+    // the host's blocks go up to the internal rate and back down around the line
+    Oversampler mOversampler;
+    int mNumOversamplingStages;
     
-    float* mCircularBufferLeft;
-    float* mCircularBufferRight;
+    // the rate the line, lfo and crossfades run at, the host's times the oversampling factor
+    double mInternalSampleRate;
     
-    float mFeedbackLeft;
-    float mFeedbackRight;
+    // the latency of the oversampling the audio thread runs at, for reportLatency()
+    std::atomic<int> mLatencyInSamples;
+    juce::SharedResourcePointer<LatencyReporter> mLatencyReporter;
+    
+    // Delay Line Data
+    
+    // one row per channel, every channel is modulated separately
+    MultiChannelDelayLine mDelayLine;
+    
+    // the last delayed sample of every channel, times the feedback
+    juce::HeapBlock<float> mFeedback;
+    
+    // idle chunks (silent input, nothing audible left in the line) skip the lfo and the line
+    SilenceDetector mSilenceDetector;
+    
+    ParameterState mParameterState;
+    
+    // the factory presets, and the fade that hides a switch from one to another
+    PresetPrograms mPrograms;
+    PresetFader mPresetFader;
+    
+   #if KADENZE_ENABLE_TRACING
+    // every block's cost against its deadline, for the trace file
+    BlockTrace mBlockTrace;
+   #endif
+    
+    // the interpolation, modulation rate and chunk size offline renders raise
+    RenderProfile mRenderProfile;
+    
+    // the levels and lfo, for the editor while one is open
+    MeterFeed mMeterFeed;
+    
+    // where each kernel call starts in the audio and modulation, one pointer per channel
+    juce::HeapBlock<float*> mChannelPointers;
+    juce::HeapBlock<const float*> mModulationPointers;
+    
+    // one run of delay times and delayed samples for the block interpolators, and their state per
+    // channel (the current type's read, then the faded-out type's)
+    juce::HeapBlock<float> mDelayTimes;
+    juce::HeapBlock<float> mDelayedSamples;
+    juce::HeapBlock<float> mFadingDelayedSamples;
+    juce::HeapBlock<float> mInterpolatorState;
     
     // LFO Data
     
-    float mLFOPhase;
+    LFO mLFO;
+    
+    // how much of the phase offset each channel gets, spread evenly from 0 (first channel)
+    // to 1 (last channel), so stereo is the lfo on the left and the offset one on the right
+    juce::HeapBlock<float> mOffsetScale;
+    
+    // one block of control-rate lfo output per channel
+    juce::AudioBuffer<float> mLFOBuffer;
+    
+    // one block of modulation (lfo * depth) per channel, and the last values computed (where
+    // the control-rate path interpolates from)
+    juce::AudioBuffer<float> mModulationBuffer;
+    juce::HeapBlock<float> mLastModulation;
+    
+    // Type Crossfade Data
+    
+    int mCurrentType;
+    int mPreviousType;
+    
+    // 1 once the fade from the previous type is done
+    float mCrossfadeGain;
+    float mCrossfadeStep;
+    
+    // Ensemble Data
+    
+    // the voices the last chunk ended on, 1 while the single read head runs
+    int mNumVoices;
+    
+    // what the voice targets were last worked out for
+    int mTargetNumVoices;
+    float mTargetSpread;
+    
+    // the lfo phase at every sample of the chunk, each voice adds its own offset
+    juce::HeapBlock<float> mLFOPhases;
+    
+    // kMaxNumVoices per channel each: the last modulation every voice reached, its interpolator
+    // state (current type's read, then the faded-out type's), and its gains into the mix and into
+    // the feedback, with the values they ramp towards over the chunk and the step per sample
+    juce::HeapBlock<float> mVoiceModulation;
+    juce::HeapBlock<float> mVoiceInterpolatorState;
+    juce::HeapBlock<float> mVoiceGains;
+    juce::HeapBlock<float> mVoiceTargetGains;
+    juce::HeapBlock<float> mVoiceGainSteps;
+    juce::HeapBlock<float> mVoiceFeedbackGains;
+    juce::HeapBlock<float> mVoiceTargetFeedbackGains;
+    juce::HeapBlock<float> mVoiceFeedbackGainSteps;
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (KadenzeChorusFlangerAudioProcessor)
@@ -11,7 +11,7 @@
 
 //==============================================================================
 KadenzeDelayAudioProcessorEditor::KadenzeDelayAudioProcessorEditor (KadenzeDelayAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p), mMeterView (p.getMeterFeed(), "delay time", 0.0f, (float) MAX_DELAY_TIME)
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
@@ -27,6 +27,22 @@ KadenzeDelayAudioProcessorEditor::KadenzeDelayAudioProcessorEditor (KadenzeDelay
 
     juce::AudioParameterFloat* delayTimeParameter = (juce::AudioParameterFloat*) params.getUnchecked(2);
     setSlider(this, &mDelayTimeSlider, delayTimeParameter, 200);
+    
+    juce::AudioParameterChoice* interpolationParameter = (juce::AudioParameterChoice*) params.getUnchecked(3);
+    mInterpolation.setBounds(300, 0, 100, 30);
+    mInterpolation.addItemList(interpolationParameter->choices, 1);
+    addAndMakeVisible(mInterpolation);
+    
+    mInterpolation.onChange = [this, interpolationParameter] {
+        interpolationParameter->beginChangeGesture();
+        *interpolationParameter = mInterpolation.getSelectedItemIndex();
+        interpolationParameter->endChangeGesture();
+    };
+    
+    mInterpolation.setSelectedItemIndex(*interpolationParameter);
+    
+    mMeterView.setBounds(0, 200, 400, 100);
+    addAndMakeVisible(mMeterView);
 }
 
 KadenzeDelayAudioProcessorEditor::~KadenzeDelayAudioProcessorEditor()
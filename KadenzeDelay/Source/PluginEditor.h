@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "../../Shared/MeterView.h"
 
 //==============================================================================
 /**
@@ -32,6 +33,9 @@ private:
     juce::Slider mDryWetSlider;
     juce::Slider mFeedbackSlider;
     juce::Slider mDelayTimeSlider;
+    juce::ComboBox mInterpolation;
+    
+    MeterView mMeterView;
     
     void setSlider(juce::Component* component, juce::Slider* slider, juce::AudioParameterFloat* param, int boundX);
 
@@ -9,6 +9,16 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+// the widest layout isBusesLayoutSupported accepts (9.1.6 is 16 channels)
+static const int kMaxNumChannels = 16;
+
+// room past the longest delay for the taps the interpolators read behind it
+static const int kDelayMarginSamples = 4;
+
+// how quickly the delay time glides to a new setting (the old per-sample coefficient of 0.001,
+// at 44.1 kHz)
+static const float kDelayTimeSmoothingMs = 22.7f;
+
 //==============================================================================
 KadenzeDelayAudioProcessor::KadenzeDelayAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -37,29 +47,36 @@ KadenzeDelayAudioProcessor::KadenzeDelayAudioProcessor()
                                                             0.01,
                                                             MAX_DELAY_TIME,
                                                             0.5));
-    mDelayTimeSmoothed = 0;
-    mCircularBufferLeft = nullptr;
-    mCircularBufferRight = nullptr;
-    mCircularBufferWriteHead = 0;
-    mCircularBufferLength = 0;
+    
+    // how the delayed reads are interpolated, from cheapest to smoothest; linear dulls the
+    // repeats a little more on every pass through the feedback, Hermite costs little more
+    addParameter(mInterpolationParameter = new juce::AudioParameterChoice("interpolation",
+                                                            "Interpolation",
+                                                            { "Linear", "Hermite", "Lagrange 4", "Lagrange 6", "Allpass" },
+                                                            1));
+    
+    mParameterState.initialise("KadenzeDelay", getParameters());
+    
+    mPrograms.open("KadenzeDelay", mParameterState, mPresetFader,
+    {
+        { "Default", {} },
+        { "Slapback", { { "delaytime", 0.12f }, { "feedback", 0.15f }, { "drywet", 0.35f } } },
+        { "Eighth Repeats", { { "delaytime", 0.25f }, { "feedback", 0.55f }, { "drywet", 0.4f } } },
+        { "Dub", { { "delaytime", 0.375f }, { "feedback", 0.85f }, { "drywet", 0.5f }, { "interpolation", 0.0f } } },
+        { "Ambient Wash", { { "delaytime", 1.5f }, { "feedback", 0.9f }, { "drywet", 0.6f }, { "interpolation", 2.0f } } }
+    });
+    
+    mDelayTimeSmoother.setTimeConstant(kDelayTimeSmoothingMs);
     mDelayTimeInSamples = 0;
-    mDelayReadHead = 0;
     
-    mFeedbackLeft = 0;
-    mFeedbackRight = 0;
+    mMaxBlockSize = 0;
+    
+    mDelayLineLayout = DelayLineLayout::interleaved;
+    mUseStereoDelayLine = false;
 }
 
 KadenzeDelayAudioProcessor::~KadenzeDelayAudioProcessor()
 {
-    if (mCircularBufferLeft != nullptr) {
-        delete [] mCircularBufferLeft;
-        mCircularBufferLeft = nullptr;
-    }
-    
-    if (mCircularBufferRight != nullptr) {
-        delete [] mCircularBufferRight;
-        mCircularBufferRight = nullptr;
-    }
 }
 
 //==============================================================================
@@ -97,61 +114,106 @@ bool KadenzeDelayAudioProcessor::isMidiEffect() const
 
 double KadenzeDelayAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // the repeats of the current delay time and feedback, until they fall below the silence threshold
+    return SilenceDetector::getTailLengthSeconds(*mDelayTimeParameter, *mFeedbackParameter);
 }
 
 int KadenzeDelayAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return mPrograms.getNumPrograms();
 }
 
 int KadenzeDelayAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return mPrograms.getCurrentProgram();
 }
 
 void KadenzeDelayAudioProcessor::setCurrentProgram (int index)
 {
+    mPrograms.setCurrentProgram(index);
 }
 
 const juce::String KadenzeDelayAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return mPrograms.getProgramName(index);
 }
 
 void KadenzeDelayAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    mPrograms.changeProgramName(index, newName);
 }
 
 //==============================================================================
 void KadenzeDelayAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    mDelayTimeInSamples = sampleRate * *mDelayTimeParameter;
+    // the longest delay at this sample rate, and room for the taps the interpolators read behind it
+    const int maxDelayInSamples = (int)std::ceil(sampleRate * MAX_DELAY_TIME) + kDelayMarginSamples;
+    
+    const int numChannels = juce::jmax(1, getTotalNumOutputChannels());
+    const bool useStereoDelayLine = numChannels == 2 && mDelayLineLayout == DelayLineLayout::interleaved;
     
-    mCircularBufferLength = sampleRate * MAX_DELAY_TIME;
+    // build and clear the new line here, and only swap it in under the callback lock below
+    MultiChannelDelayLine delayLine;
+    StereoDelayLine stereoDelayLine;
     
-    if (mCircularBufferLeft == nullptr) {
-        mCircularBufferLeft = new float[(int)mCircularBufferLength];
+    if (useStereoDelayLine) {
+        stereoDelayLine.prepare(maxDelayInSamples);
+    } else {
+        delayLine.prepare(numChannels, maxDelayInSamples);
     }
     
-    juce::zeromem(mCircularBufferLeft, mCircularBufferLength * sizeof(float));
+    // hosts don't process while preparing, the lock makes sure no block ever sees half the new state;
+    // the old lines go back to the pool once the lock is released
+    const juce::ScopedLock lock(getCallbackLock());
     
-    if (mCircularBufferRight == nullptr) {
-        mCircularBufferRight = new float[(int)mCircularBufferLength];
-    }
+    mUseStereoDelayLine = useStereoDelayLine;
+    mDelayLine.swapWith(delayLine);
+    mStereoDelayLine.swapWith(stereoDelayLine);
+    mSilenceDetector.reset();
+    KADENZE_TRACE_PREPARE(mBlockTrace, "KadenzeDelay", sampleRate);
+    mMeterFeed.prepare(sampleRate);
+    mRenderProfile.prepare(isNonRealtime());
+    
+    // offline renders run in longer chunks than the host announced
+    const int blockSize = RenderProfile::getBlockSize(isNonRealtime(), samplesPerBlock);
+    
+    mDelayTimeInSamples = sampleRate * *mDelayTimeParameter;
+    
+    mFeedback.allocate(numChannels, true);
+    mFrame.allocate(numChannels, true);
+    
+    mDelayTimes.allocate(blockSize, true);
+    mDelayedSamples.setSize(numChannels, blockSize);
+    mInterpolatorState.allocate(numChannels, true);
+    
+    mWriteSamples.setSize(numChannels, blockSize);
+    mDryGains.allocate(blockSize, true);
     
-    juce::zeromem(mCircularBufferRight, mCircularBufferLength * sizeof(float));
+    mMaxBlockSize = blockSize;
     
-    mCircularBufferWriteHead = 0;
+    mPresetFader.prepare(sampleRate, numChannels, mMaxBlockSize);
     
-    mDelayTimeSmoothed = *mDelayTimeParameter;
+    mDelayTimeSmoother.prepare(sampleRate, mMaxBlockSize);
+    mDelayTimeSmoother.reset(*mDelayTimeParameter);
+    
+    mDryWetRamp.prepare(mMaxBlockSize);
+    mDryWetRamp.reset(*mDryWetParameter);
+    
+    mFeedbackRamp.prepare(mMaxBlockSize);
+    mFeedbackRamp.reset(*mFeedbackParameter);
 }
 
 void KadenzeDelayAudioProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    // hand the delay memory back to the shared pool until the next prepareToPlay
+    MultiChannelDelayLine delayLine;
+    StereoDelayLine stereoDelayLine;
+    
+    const juce::ScopedLock lock(getCallbackLock());
+    
+    mUseStereoDelayLine = false;
+    mDelayLine.swapWith(delayLine);
+    mStereoDelayLine.swapWith(stereoDelayLine);
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -161,12 +223,13 @@ bool KadenzeDelayAudioProcessor::isBusesLayoutSupported (const BusesLayout& layo
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
+    // Every channel gets its own delay row, so any discrete or surround
+    // layout up to kMaxNumChannels works (mono, stereo, 5.1, 7.1.4, ...).
     // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // load plugins that support stereo bus layouts, so stereo stays the default.
+    const int numChannels = layouts.getMainOutputChannelSet().size();
+    
+    if (numChannels < 1 || numChannels > kMaxNumChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -182,6 +245,7 @@ bool KadenzeDelayAudioProcessor::isBusesLayoutSupported (const BusesLayout& layo
 
 void KadenzeDelayAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    KADENZE_TRACE_BLOCK(mBlockTrace, buffer.getNumSamples());
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -194,51 +258,361 @@ void KadenzeDelayAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     // this code if your algorithm always overwrites all the output channels.
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
-
-    mDelayTimeInSamples = getSampleRate() * *mDelayTimeParameter;
     
-    float* leftChannel = buffer.getWritePointer(0);
-    float* rightChannel = buffer.getWritePointer(1);
+    // a host that calls before prepareToPlay gets its audio back untouched, there are no chunks to
+    // work in yet
+    if (mMaxBlockSize == 0) {
+        return;
+    }
+    
+    mMeterFeed.measureInput(buffer.getArrayOfReadPointers(), buffer.getNumChannels(), buffer.getNumSamples());
+    
+    const double sampleRate = getSampleRate();
+    
+    // a change of the host's mode mid-stream swaps the interpolator behind a fade of the wet path
+    mRenderProfile.update(isNonRealtime(), mSilenceDetector.isSilent(), mPresetFader);
     
-    for (int sample = 0; sample < buffer.getNumSamples(); sample++)
+    // snapshot the parameters once per block, so the sample loop only reads plain arrays; while a
+    // preset switch is pending the wet path's glides stay where they are, and only the mix follows
+    mPresetFader.startBlock();
+    
+    const float dryWetTarget = *mDryWetParameter;
+    float feedbackTarget = *mFeedbackParameter;
+    float delayTimeTarget = *mDelayTimeParameter;
+    
+    if (mPresetFader.isHolding()) {
+        feedbackTarget = mFeedbackRamp.getCurrentValue();
+        delayTimeTarget = mDelayTimeSmoother.getCurrentValue();
+    }
+    
+    InterpolationType interpolation = mRenderProfile.getInterpolation((InterpolationType) mInterpolationParameter->getIndex());
+    
+    // the host hands over the channels prepareToPlay was told about
+    const int numChannels = mUseStereoDelayLine ? 2 : mDelayLine.getNumChannels();
+    jassert(buffer.getNumChannels() >= numChannels);
+    
+    // hosts may send bigger blocks than announced in prepareToPlay, so work in ramp-sized chunks
+    int numSamples = 0;
+    
+    for (int offset = 0; offset < buffer.getNumSamples(); offset += numSamples)
     {
-        mDelayTimeSmoothed = mDelayTimeSmoothed - 0.001 * (mDelayTimeSmoothed - *mDelayTimeParameter);
-        mDelayTimeInSamples = getSampleRate() * mDelayTimeSmoothed;
+        // chunks end where a preset switch's fade starts or ends
+        numSamples = mPresetFader.getChunkLength(juce::jmin(mMaxBlockSize, buffer.getNumSamples() - offset));
+        
+        // the wet signal has faded out, the repeats jump to the new preset's delay time and feedback,
+        // and the interpolator to the host's mode (the line keeps what it holds, so the old echoes
+        // carry on at the new time)
+        if (mPresetFader.switchesNow()) {
+            feedbackTarget = *mFeedbackParameter;
+            delayTimeTarget = *mDelayTimeParameter;
+            
+            mFeedbackRamp.reset(feedbackTarget);
+            mDelayTimeSmoother.reset(delayTimeTarget);
+            
+            mRenderProfile.switchNow();
+            interpolation = mRenderProfile.getInterpolation((InterpolationType) mInterpolationParameter->getIndex());
+        }
+        
+        const float* dryWet = mDryWetRamp.process(dryWetTarget, numSamples);
+        const float* feedback = mPresetFader.processFeedback(mFeedbackRamp.process(feedbackTarget, numSamples), numSamples);
+        
+        const float previousDelayTime = mDelayTimeSmoother.getCurrentValue();
+        const float* delayTimes = mDelayTimeSmoother.process(delayTimeTarget, numSamples);
+        
+        // the lines are cleared lazily, zero whatever the chunk's reads would find unwritten; the
+        // glide only moves one way, so the chunk's delay times lie between where it starts and ends
+        const float minDelayInSamples = sampleRate * juce::jmin(previousDelayTime, delayTimes[numSamples - 1]);
+        const float maxDelayInSamples = sampleRate * juce::jmax(previousDelayTime, delayTimes[numSamples - 1]);
+        
+        // with the input silent and nothing audible left to read, the wet signal is silent too, and
+        // only the dry part of the mix remains (the ramps run monotonically, so their larger end is
+        // their largest value)
+        const float inputPeak = SilenceDetector::getPeak(buffer.getArrayOfWritePointers(), numChannels, offset, numSamples);
+        const float maxFeedback = juce::jmax(feedback[0], feedback[numSamples - 1]);
+        const bool wasSilent = mSilenceDetector.isSilent();
+        
+        if (mSilenceDetector.process(inputPeak, maxFeedback, (int)maxDelayInSamples + kDelayMarginSamples, numSamples)) {
+            juce::FloatVectorOperations::copyWithMultiply(mDryGains, dryWet, -1.0f, numSamples);
+            juce::FloatVectorOperations::add(mDryGains, 1.0f, numSamples);
+            
+            for (int channel = 0; channel < numChannels; channel++) {
+                juce::FloatVectorOperations::multiply(buffer.getWritePointer(channel, offset), mDryGains, numSamples);
+            }
+            
+            mPresetFader.processDry(buffer.getArrayOfWritePointers(), offset, numChannels, numSamples);
+            continue;
+        }
+        
+        // back from idle, start again from an empty line: what it held within reach was below the
+        // threshold, and anything further back must not resurface if the delay time grows
+        if (wasSilent) {
+            mDelayLine.clearLazily();
+            mStereoDelayLine.clearLazily();
+            
+            juce::FloatVectorOperations::clear(mFeedback, numChannels);
+            juce::FloatVectorOperations::clear(mInterpolatorState, numChannels);
+        }
+        
+        if (mUseStereoDelayLine) {
+            mStereoDelayLine.ensureReadable(minDelayInSamples, maxDelayInSamples, numSamples);
+        } else {
+            mDelayLine.ensureReadable(minDelayInSamples, maxDelayInSamples, numSamples);
+        }
+        
+        // around a preset switch the wet signal fades, and the dry part of the mix passes straight through
+        mPresetFader.processInput(buffer.getArrayOfWritePointers(), offset, numChannels, numSamples);
+        
+        // once the delay time has stopped moving, a delay that reaches back past the whole chunk
+        // only reads what earlier chunks wrote
+        if (! mDelayTimeSmoother.isSmoothing() && sampleRate * delayTimes[0] >= numSamples + kDelayMarginSamples) {
+            switch (interpolation)
+            {
+                case InterpolationType::hermite:
+                    processSettled<Interpolators::Hermite>(buffer, offset, feedback, dryWet, numChannels, numSamples);
+                    break;
+                case InterpolationType::lagrange4:
+                    processSettled<Interpolators::Lagrange4>(buffer, offset, feedback, dryWet, numChannels, numSamples);
+                    break;
+                case InterpolationType::lagrange6:
+                    processSettled<Interpolators::Lagrange6>(buffer, offset, feedback, dryWet, numChannels, numSamples);
+                    break;
+                case InterpolationType::allpass:
+                    processSettled<Interpolators::Allpass>(buffer, offset, feedback, dryWet, numChannels, numSamples);
+                    break;
+                case InterpolationType::linear:
+                default:
+                    processSettled<Interpolators::Linear>(buffer, offset, feedback, dryWet, numChannels, numSamples);
+                    break;
+            }
+        } else {
+            switch (interpolation)
+            {
+                case InterpolationType::hermite:
+                    processInterpolated<Interpolators::Hermite>(buffer, offset, feedback, dryWet, delayTimes, numChannels, numSamples);
+                    break;
+                case InterpolationType::lagrange4:
+                    processInterpolated<Interpolators::Lagrange4>(buffer, offset, feedback, dryWet, delayTimes, numChannels, numSamples);
+                    break;
+                case InterpolationType::lagrange6:
+                    processInterpolated<Interpolators::Lagrange6>(buffer, offset, feedback, dryWet, delayTimes, numChannels, numSamples);
+                    break;
+                case InterpolationType::allpass:
+                    processInterpolated<Interpolators::Allpass>(buffer, offset, feedback, dryWet, delayTimes, numChannels, numSamples);
+                    break;
+                case InterpolationType::linear:
+                default:
+                    processLinear(buffer, offset, feedback, dryWet, delayTimes, numChannels, numSamples);
+                    break;
+            }
+        }
         
-        mCircularBufferLeft[mCircularBufferWriteHead] = leftChannel[sample] + mFeedbackLeft;
-        mCircularBufferRight[mCircularBufferWriteHead] = rightChannel[sample] + mFeedbackRight;
+        mPresetFader.processDryWet(buffer.getArrayOfWritePointers(), offset, numChannels, numSamples, dryWet);
+    }
+    
+    
+    mMeterFeed.measureOutput(buffer.getArrayOfReadPointers(), buffer.getNumChannels(), buffer.getNumSamples(), mDelayTimeSmoother.getCurrentValue());
+}
+
+void KadenzeDelayAudioProcessor::processLinear(juce::AudioBuffer<float>& buffer, int offset, const float* feedback, const float* dryWet, const float* delayTimes, int numChannels, int numSamples)
+{
+    const double sampleRate = getSampleRate();
+    
+    // every channel shares the delay time, so the stereo line reads both as one frame
+    if (mUseStereoDelayLine) {
+        float* leftChannel = buffer.getWritePointer(0, offset);
+        float* rightChannel = buffer.getWritePointer(1, offset);
         
-        mDelayReadHead = mCircularBufferWriteHead - mDelayTimeInSamples;
+        for (int sample = 0; sample < numSamples; sample++)
+        {
+            mDelayTimeInSamples = sampleRate * delayTimes[sample];
+            
+            mStereoDelayLine.write(leftChannel[sample] + mFeedback[0], rightChannel[sample] + mFeedback[1]);
+            
+            float delaySampleLeft;
+            float delaySampleRight;
+            mStereoDelayLine.readLinear(mDelayTimeInSamples, delaySampleLeft, delaySampleRight);
+            
+            mFeedback[0] = delaySampleLeft * feedback[sample];
+            mFeedback[1] = delaySampleRight * feedback[sample];
+            
+            mStereoDelayLine.advance();
+            
+            leftChannel[sample] = leftChannel[sample] * (1 - dryWet[sample]) + delaySampleLeft * dryWet[sample];
+            rightChannel[sample] = rightChannel[sample] * (1 - dryWet[sample]) + delaySampleRight * dryWet[sample];
+        }
         
-        if (mDelayReadHead < 0) {
-            mDelayReadHead += mCircularBufferLength;
+        return;
+    }
+    
+    // and the split rows read every channel at the position worked out once per frame
+    float* const* channels = buffer.getArrayOfWritePointers();
+    
+    for (int sample = 0; sample < numSamples; sample++)
+    {
+        mDelayTimeInSamples = sampleRate * delayTimes[sample];
+        
+        for (int channel = 0; channel < numChannels; channel++) {
+            mFrame[channel] = channels[channel][offset + sample] + mFeedback[channel];
         }
         
-        int readHeadX0 = (int)mDelayReadHead;
-        int readHeadX1 = readHeadX0 + 1;
-        float readHeadFloat = mDelayReadHead - readHeadX0;
+        mDelayLine.write(mFrame);
+        mDelayLine.readLinear(mDelayTimeInSamples, mFrame);
+        mDelayLine.advance();
         
-        if (readHeadX1 >= mCircularBufferLength) {
-            readHeadX1 -= mCircularBufferLength;
+        for (int channel = 0; channel < numChannels; channel++) {
+            float& channelSample = channels[channel][offset + sample];
+            const float delaySample = mFrame[channel];
+            
+            mFeedback[channel] = delaySample * feedback[sample];
+            channelSample = channelSample * (1 - dryWet[sample]) + delaySample * dryWet[sample];
         }
+    }
+}
+
+template <typename Interpolator>
+void KadenzeDelayAudioProcessor::processInterpolated(juce::AudioBuffer<float>& buffer, int offset, const float* feedback, const float* dryWet, const float* delayTimes, int numChannels, int numSamples)
+{
+    const double sampleRate = getSampleRate();
+    
+    // the interpolator reads a whole run before the run is written, so a run has to stay shorter
+    // than the shortest delay time (less the taps it reads ahead of the delay)
+    const int maxRunLength = juce::jmax(1, (int)(sampleRate * mDelayTimeParameter->range.start) - Interpolator::kNumTapsAhead - 1);
+    
+    float* const* channels = buffer.getArrayOfWritePointers();
+    float* const* delayedSamples = mDelayedSamples.getArrayOfWritePointers();
+    
+    for (int start = 0; start < numSamples; start += maxRunLength)
+    {
+        const int runLength = juce::jmin(maxRunLength, numSamples - start);
         
-        float delaySampleLeft = linInterp(mCircularBufferLeft[readHeadX0], mCircularBufferLeft[readHeadX1], readHeadFloat);
-        float delaySampleRight = linInterp(mCircularBufferRight[readHeadX0], mCircularBufferRight[readHeadX1], readHeadFloat);
+        juce::FloatVectorOperations::multiply(mDelayTimes, delayTimes + start, (float) sampleRate, runLength);
+        mDelayTimeInSamples = mDelayTimes[runLength - 1];
         
-        mFeedbackLeft = delaySampleLeft * *mFeedbackParameter;
-        mFeedbackRight = delaySampleRight * *mFeedbackParameter;
+        // every channel reads the same delay times out of its own row (or its half of the frames)
+        const int writeHead = mUseStereoDelayLine ? mStereoDelayLine.getWriteHead() : mDelayLine.getWriteHead();
         
-        mCircularBufferWriteHead++;
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            const DelayTapRow row = mUseStereoDelayLine ? mStereoDelayLine.getTapRow(channel) : mDelayLine.getChannel(channel).getTapRow();
+            Interpolator::process(row, writeHead, mDelayTimes, delayedSamples[channel], runLength, mInterpolatorState[channel]);
+        }
         
-        buffer.setSample(0, sample,  buffer.getSample(0, sample) * (1 - *mDryWetParameter) + delaySampleLeft * *mDryWetParameter);
-        buffer.setSample(1, sample,  buffer.getSample(1, sample) * (1 - *mDryWetParameter) + delaySampleRight * *mDryWetParameter);
+        // write into our delay line, each delayed sample feeding the next write
+        if (mUseStereoDelayLine) {
+            const float* leftChannel = channels[0] + offset + start;
+            const float* rightChannel = channels[1] + offset + start;
+            float feedbackLeft = mFeedback[0];
+            float feedbackRight = mFeedback[1];
+            
+            for (int sample = 0; sample < runLength; sample++)
+            {
+                mStereoDelayLine.write(leftChannel[sample] + feedbackLeft, rightChannel[sample] + feedbackRight);
+                mStereoDelayLine.advance();
+                
+                feedbackLeft = delayedSamples[0][sample] * feedback[start + sample];
+                feedbackRight = delayedSamples[1][sample] * feedback[start + sample];
+            }
+            
+            mFeedback[0] = feedbackLeft;
+            mFeedback[1] = feedbackRight;
+        } else {
+            for (int sample = 0; sample < runLength; sample++)
+            {
+                for (int channel = 0; channel < numChannels; channel++) {
+                    mFrame[channel] = channels[channel][offset + start + sample] + mFeedback[channel];
+                    mFeedback[channel] = delayedSamples[channel][sample] * feedback[start + sample];
+                }
+                
+                mDelayLine.write(mFrame);
+                mDelayLine.advance();
+            }
+        }
         
-        if (mCircularBufferWriteHead >= mCircularBufferLength) {
-            mCircularBufferWriteHead = 0;
+        // and mix the delayed samples in
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            float* audio = channels[channel] + offset + start;
+            const float* delaySamples = delayedSamples[channel];
+            
+            for (int sample = 0; sample < runLength; sample++) {
+                audio[sample] = audio[sample] * (1 - dryWet[start + sample]) + delaySamples[sample] * dryWet[start + sample];
+            }
         }
     }
 }
 
+template <typename Interpolator>
+void KadenzeDelayAudioProcessor::processSettled(juce::AudioBuffer<float>& buffer, int offset, const float* feedback, const float* dryWet, int numChannels, int numSamples)
+{
+    const float delayInSamples = getSampleRate() * mDelayTimeSmoother.getCurrentValue();
+    mDelayTimeInSamples = delayInSamples;
+    
+    float* const* channels = buffer.getArrayOfWritePointers();
+    float* const* delayedSamples = mDelayedSamples.getArrayOfWritePointers();
+    float* const* writeSamples = mWriteSamples.getArrayOfWritePointers();
+    
+    // read the whole chunk of every channel
+    juce::FloatVectorOperations::fill(mDelayTimes, delayInSamples, numSamples);
+    
+    const int writeHead = mUseStereoDelayLine ? mStereoDelayLine.getWriteHead() : mDelayLine.getWriteHead();
+    
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        const DelayTapRow row = mUseStereoDelayLine ? mStereoDelayLine.getTapRow(channel) : mDelayLine.getChannel(channel).getTapRow();
+        Interpolator::process(row, writeHead, mDelayTimes, delayedSamples[channel], numSamples, mInterpolatorState[channel]);
+    }
+    
+    // each sample is written with the feedback of the delayed sample before it
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        float* write = writeSamples[channel];
+        const float* delayed = delayedSamples[channel];
+        
+        write[0] = mFeedback[channel];
+        juce::FloatVectorOperations::multiply(write + 1, delayed, feedback, numSamples - 1);
+        juce::FloatVectorOperations::add(write, channels[channel] + offset, numSamples);
+        
+        mFeedback[channel] = delayed[numSamples - 1] * feedback[numSamples - 1];
+    }
+    
+    if (mUseStereoDelayLine) {
+        mStereoDelayLine.writeBlock(writeSamples[0], writeSamples[1], numSamples);
+        mStereoDelayLine.advance(numSamples);
+    } else {
+        for (int channel = 0; channel < numChannels; channel++) {
+            mDelayLine.writeBlock(channel, writeSamples[channel], numSamples);
+        }
+        
+        mDelayLine.advance(numSamples);
+    }
+    
+    // and mix the delayed samples in, dry * (1 - dryWet) + delayed * dryWet
+    juce::FloatVectorOperations::copyWithMultiply(mDryGains, dryWet, -1.0f, numSamples);
+    juce::FloatVectorOperations::add(mDryGains, 1.0f, numSamples);
+    
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        float* audio = channels[channel] + offset;
+        
+        juce::FloatVectorOperations::multiply(audio, mDryGains, numSamples);
+        juce::FloatVectorOperations::addWithMultiply(audio, delayedSamples[channel], dryWet, numSamples);
+    }
+}
+
+size_t KadenzeDelayAudioProcessor::getMemoryFootprint() const
+{
+    const size_t bufferSize = (size_t)(2 * mMaxBlockSize
+                                       + mDelayedSamples.getNumChannels() * mDelayedSamples.getNumSamples()
+                                       + mWriteSamples.getNumChannels() * mWriteSamples.getNumSamples()) * sizeof(float);
+    
+    return sizeof(*this)
+        + mDelayLine.getMemoryFootprint() + mStereoDelayLine.getMemoryFootprint()
+        + bufferSize
+        + mDryWetRamp.getMemoryFootprint() + mFeedbackRamp.getMemoryFootprint()
+        + mDelayTimeSmoother.getMemoryFootprint()
+        + mMeterFeed.getMemoryFootprint() + mPresetFader.getMemoryFootprint();
+}
+
 //==============================================================================
 bool KadenzeDelayAudioProcessor::hasEditor() const
 {
@@ -253,24 +627,21 @@ juce::AudioProcessorEditor* KadenzeDelayAudioProcessor::createEditor()
 //==============================================================================
 void KadenzeDelayAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    mParameterState.save(destData);
 }
 
 void KadenzeDelayAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    mParameterState.restore(data, sizeInBytes);
 }
 
 //==============================================================================
 // This creates new instances of the plugin..
+// (headless hosts such as KadenzeBenchmark link all three processors into one
+// binary, so they define KADENZE_HEADLESS and construct the processors directly)
+#if ! KADENZE_HEADLESS
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new KadenzeDelayAudioProcessor();
 }
-
-float KadenzeDelayAudioProcessor::linInterp(float sampleX0, float sampleX1, float inPhase) {
-    return (1 - inPhase) * sampleX0 + inPhase * sampleX1;
-}
+#endif
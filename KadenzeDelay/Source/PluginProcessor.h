@@ -9,6 +9,17 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "../../Shared/BlockTrace.h"
+#include "../../Shared/Interpolators.h"
+#include "../../Shared/MeterFeed.h"
+#include "../../Shared/MultiChannelDelayLine.h"
+#include "../../Shared/ParameterRamp.h"
+#include "../../Shared/ParameterState.h"
+#include "../../Shared/PresetPrograms.h"
+#include "../../Shared/RenderProfile.h"
+#include "../../Shared/ParameterSmoother.h"
+#include "../../Shared/SilenceDetector.h"
+#include "../../Shared/StereoDelayLine.h"
 
 #define MAX_DELAY_TIME 2
 
@@ -55,27 +66,98 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
     
-    float linInterp(float sampleX0, float sampleX1, float inPhase);
+    //==============================================================================
+    enum class DelayLineLayout
+    {
+        split,          // one MultiChannelDelayLine row per channel
+        interleaved     // one StereoDelayLine of (left, right) frames, stereo layouts only
+    };
+    
+    // choose how stereo is stored (interleaved by default), call before prepareToPlay; every
+    // other layout always uses the split rows
+    void setDelayLineLayout(DelayLineLayout layout) { mDelayLineLayout = layout; }
+    DelayLineLayout getDelayLineLayout() const { return mDelayLineLayout; }
+    
+    // bytes this instance owns once prepared: the object itself plus its delay lines and buffers
+    size_t getMemoryFootprint() const;
+    
+    // what the editor's meters and delay time scope show
+    MeterFeed& getMeterFeed() { return mMeterFeed; }
     
 private:
-
-    float mDelayTimeSmoothed;
+    
+    // one chunk of the delay loop with linear reads, sample by sample
+    void processLinear(juce::AudioBuffer<float>& buffer, int offset, const float* feedback, const float* dryWet, const float* delayTimes, int numChannels, int numSamples);
+    
+    // one chunk of the delay loop read through a block interpolator
+    template <typename Interpolator>
+    void processInterpolated(juce::AudioBuffer<float>& buffer, int offset, const float* feedback, const float* dryWet, const float* delayTimes, int numChannels, int numSamples);
+    
+    // one chunk at a settled delay time at least as long as the chunk: nothing the chunk reads
+    // is written in it, so the reads, the feedback, the writes and the mix each run as a block
+    template <typename Interpolator>
+    void processSettled(juce::AudioBuffer<float>& buffer, int offset, const float* feedback, const float* dryWet, int numChannels, int numSamples);
     
     juce::AudioParameterFloat* mDryWetParameter;
     juce::AudioParameterFloat* mFeedbackParameter;
     juce::AudioParameterFloat* mDelayTimeParameter;
+    juce::AudioParameterChoice* mInterpolationParameter;
+    
+    // Per-block Parameter Snapshots
+    
+    ParameterRamp mDryWetRamp;
+    ParameterRamp mFeedbackRamp;
+    
+    // the delay time glides rather than ramps, so repeats pitch-bend smoothly into a new setting
+    ParameterSmoother mDelayTimeSmoother;
+    
+    int mMaxBlockSize;
     
-    float mFeedbackLeft;
-    float mFeedbackRight;
+    // the last delayed sample of every channel, times the feedback
+    juce::HeapBlock<float> mFeedback;
+    
+    // one sample per channel, for the linked multichannel reads
+    juce::HeapBlock<float> mFrame;
+    
+    // one run of smoothed delay times, and of delayed samples per channel, for the block
+    // interpolators, and their state per channel
+    juce::HeapBlock<float> mDelayTimes;
+    juce::AudioBuffer<float> mDelayedSamples;
+    juce::HeapBlock<float> mInterpolatorState;
+    
+    // one chunk of what gets written to the line per channel, and the dry gains, for processSettled()
+    juce::AudioBuffer<float> mWriteSamples;
+    juce::HeapBlock<float> mDryGains;
     
     float mDelayTimeInSamples;
-    float mDelayReadHead;
     
-    int mCircularBufferWriteHead;
-    int mCircularBufferLength;
+    DelayLineLayout mDelayLineLayout;
+    
+    // only the line of the layout in use is allocated
+    bool mUseStereoDelayLine;
+    
+    MultiChannelDelayLine mDelayLine;
+    StereoDelayLine mStereoDelayLine;
+    
+    // idle chunks (silent input, nothing audible left in the line) skip the line altogether
+    SilenceDetector mSilenceDetector;
+    
+    ParameterState mParameterState;
+    
+    // the factory presets, and the fade that hides a switch from one to another
+    PresetPrograms mPrograms;
+    PresetFader mPresetFader;
+    
+   #if KADENZE_ENABLE_TRACING
+    // every block's cost against its deadline, for the trace file
+    BlockTrace mBlockTrace;
+   #endif
+    
+    // the interpolation and chunk size offline renders raise
+    RenderProfile mRenderProfile;
     
-    float* mCircularBufferLeft;
-    float* mCircularBufferRight;
+    // the levels and delay time, for the editor while one is open
+    MeterFeed mMeterFeed;
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (KadenzeDelayAudioProcessor)
@@ -19,6 +19,7 @@ KadenzePluginAudioProcessorEditor::KadenzePluginAudioProcessorEditor (KadenzePlu
     
     auto& params = processor.getParameters();
     juce::AudioParameterFloat* gainParameter = (juce::AudioParameterFloat*) params.getUnchecked(0);
+    juce::AudioParameterFloat* delayTimeParameter = (juce::AudioParameterFloat*) params.getUnchecked(1);
     
     mGainControlSlider.setBounds(0, 0, 100, 100);
     mGainControlSlider.setSliderStyle(juce::Slider::RotaryVerticalDrag);
@@ -39,6 +40,26 @@ KadenzePluginAudioProcessorEditor::KadenzePluginAudioProcessorEditor (KadenzePlu
     };
     
     addAndMakeVisible(mGainControlSlider);
+    
+    mDelayTimeControlSlider.setBounds(100, 0, 100, 100);
+    mDelayTimeControlSlider.setSliderStyle(juce::Slider::RotaryVerticalDrag);
+    mDelayTimeControlSlider.setTextBoxStyle(juce::Slider::NoTextBox, true, 0, 0);
+    mDelayTimeControlSlider.setRange(delayTimeParameter->range.start, delayTimeParameter->range.end);
+    mDelayTimeControlSlider.setValue(*delayTimeParameter);
+    
+    mDelayTimeControlSlider.onDragStart = [delayTimeParameter] {
+        delayTimeParameter->beginChangeGesture();
+    };
+    
+    mDelayTimeControlSlider.onValueChange = [this, delayTimeParameter] {
+        *delayTimeParameter = mDelayTimeControlSlider.getValue();
+    };
+    
+    mDelayTimeControlSlider.onDragEnd = [delayTimeParameter] {
+        delayTimeParameter->endChangeGesture();
+    };
+    
+    addAndMakeVisible(mDelayTimeControlSlider);
 }
 
 KadenzePluginAudioProcessorEditor::~KadenzePluginAudioProcessorEditor()
@@ -27,6 +27,7 @@ public:
 private:
     
     juce::Slider mGainControlSlider;
+    juce::Slider mDelayTimeControlSlider;
     
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
@@ -9,6 +9,19 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+// how quickly the gain follows the parameter (the old per-sample coefficient of 0.004, at 44.1 kHz)
+static const float kGainSmoothingMs = 5.7f;
+
+// how quickly the delay time glides to a new setting, as in KadenzeDelay
+static const float kDelayTimeSmoothingMs = 22.7f;
+
+// the delay time, a whole number of samples long, so the glide settles on a tap the block reads
+// can use
+static float roundToSamples(float delayTime, double sampleRate)
+{
+    return (float)(std::round(delayTime * sampleRate) / sampleRate);
+}
+
 //==============================================================================
 KadenzePluginAudioProcessor::KadenzePluginAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -27,21 +40,31 @@ KadenzePluginAudioProcessor::KadenzePluginAudioProcessor()
                                                                 0.0f,
                                                                 1.0f,
                                                                 0.5f));
-    mGainSmoothed = mGainParameter->get();
+    addParameter(mDelayTimeParameter = new juce::AudioParameterFloat("delaytime",
+                                                                     "Delay Time",
+                                                                     0.01f,
+                                                                     MAX_DELAY_TIME,
+                                                                     0.5f));
+    
+    mParameterState.initialise("KadenzePlugin", getParameters());
     
-    mCircularBuffer = nullptr;
-    mCircularBufferWriteHead = 0;
-    mCircularBufferLength = 0;
+    mPrograms.open("KadenzePlugin", mParameterState, mPresetFader,
+    {
+        { "Default", {} },
+        { "Unity", { { "gain", 1.0f } } },
+        { "Doubler", { { "gain", 0.7f }, { "delaytime", 0.03f } } },
+        { "Slapback", { { "gain", 0.6f }, { "delaytime", 0.12f } } }
+    });
+    
+    mGainSmoother.setTimeConstant(kGainSmoothingMs);
+    mGainSmoother.reset(mGainParameter->get());
+    
+    mDelayTimeSmoother.setTimeConstant(kDelayTimeSmoothingMs);
     mDelayTimeInSamples = 0;
-    mDelayReadHead = 0;
 }
 
 KadenzePluginAudioProcessor::~KadenzePluginAudioProcessor()
 {
-    if (mCircularBuffer != nullptr) {
-        delete [] mCircularBuffer;
-        mCircularBuffer = nullptr;
-    }
 }
 
 //==============================================================================
@@ -79,52 +102,71 @@ bool KadenzePluginAudioProcessor::isMidiEffect() const
 
 double KadenzePluginAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // one echo, there is no feedback
+    return SilenceDetector::getTailLengthSeconds(*mDelayTimeParameter, 0.0f);
 }
 
 int KadenzePluginAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return mPrograms.getNumPrograms();
 }
 
 int KadenzePluginAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return mPrograms.getCurrentProgram();
 }
 
 void KadenzePluginAudioProcessor::setCurrentProgram (int index)
 {
+    mPrograms.setCurrentProgram(index);
 }
 
 const juce::String KadenzePluginAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return mPrograms.getProgramName(index);
 }
 
 void KadenzePluginAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    mPrograms.changeProgramName(index, newName);
 }
 
 //==============================================================================
 void KadenzePluginAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    // build and clear the new line here, and only swap it in under the callback lock, so no block
+    // ever sees half the new state; the old line goes back to the pool once the lock is released.
+    // A chunk is written before it is read, so the line holds the longest delay plus a chunk, and
+    // offline renders run in longer chunks than the host announced.
+    const int blockSize = RenderProfile::getBlockSize(isNonRealtime(), samplesPerBlock);
     
-    mDelayTimeInSamples = sampleRate * 0.5;
+    const int numChannels = juce::jmax(1, getTotalNumInputChannels());
     
-    mCircularBufferLength = sampleRate * MAX_DELAY_TIME;
+    MultiChannelDelayLine delayLine;
+    delayLine.prepare(numChannels, (int)std::ceil(sampleRate * MAX_DELAY_TIME) + blockSize);
     
-    if (mCircularBuffer == nullptr) {
-        mCircularBuffer = new float[(int)(mCircularBufferLength)];
-    }
+    const juce::ScopedLock lock(getCallbackLock());
+    
+    mDelayTimeSmoother.prepare(sampleRate, blockSize);
+    mDelayTimeSmoother.reset(roundToSamples(*mDelayTimeParameter, sampleRate));
+    mDelayTimeInSamples = sampleRate * mDelayTimeSmoother.getCurrentValue();
+    mDelayLine.swapWith(delayLine);
+    mSilenceDetector.reset();
+    mPresetFader.prepare(sampleRate, numChannels, blockSize);
+    KADENZE_TRACE_PREPARE(mBlockTrace, "KadenzePlugin", sampleRate);
+    
+    mDelayedSamples.allocate(blockSize, true);
     
-    mCircularBufferWriteHead = 0;
+    mGainSmoother.prepare(sampleRate, blockSize);
 }
 
 void KadenzePluginAudioProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    // hand the delay memory back to the shared pool until the next prepareToPlay
+    MultiChannelDelayLine delayLine;
+    
+    const juce::ScopedLock lock(getCallbackLock());
+    mDelayLine.swapWith(delayLine);
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -155,6 +197,7 @@ bool KadenzePluginAudioProcessor::isBusesLayoutSupported (const BusesLayout& lay
 
 void KadenzePluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    KADENZE_TRACE_BLOCK(mBlockTrace, buffer.getNumSamples());
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -168,36 +211,125 @@ void KadenzePluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
     
-    for (int sample = 0; sample < buffer.getNumSamples(); sample++)
+    // a host that calls before prepareToPlay gets its audio back untouched, there are no chunks to
+    // work in yet
+    if (mGainSmoother.getMaxBlockSize() == 0) {
+        return;
+    }
+    
+    // read the parameters once per block instead of once per sample; the delay time glides to the
+    // parameter, and stays where it is while a preset switch is pending
+    mPresetFader.startBlock();
+    
+    const double sampleRate = getSampleRate();
+    const float gainTarget = mGainParameter->get();
+    float delayTimeTarget = roundToSamples(*mDelayTimeParameter, sampleRate);
+    
+    if (mPresetFader.isHolding()) {
+        delayTimeTarget = mDelayTimeSmoother.getCurrentValue();
+    }
+    
+    const int numChannels = juce::jmin(totalNumInputChannels, mDelayLine.getNumChannels());
+    
+    // hosts may send bigger blocks than announced in prepareToPlay, so work in smoother-sized chunks
+    const int maxBlockSize = mGainSmoother.getMaxBlockSize();
+    
+    int numSamples = 0;
+    
+    for (int offset = 0; offset < buffer.getNumSamples(); offset += numSamples)
     {
-        // Frequency Gain Formula: x = x - z * (x - y), where x = smoothed value, y = target value, z = scalar (speed)
-        mGainSmoothed = mGainSmoothed - 0.004 * (mGainSmoothed - mGainParameter->get());
+        // chunks end where a preset switch's fade starts or ends
+        numSamples = mPresetFader.getChunkLength(juce::jmin(maxBlockSize, buffer.getNumSamples() - offset));
         
-        for (int channel = 0; channel < totalNumInputChannels; ++channel)
-        {
-            auto* channelData = buffer.getWritePointer(channel);
-            
-            channelData[sample] *= mGainSmoothed;
-            
-            mCircularBuffer[mCircularBufferWriteHead] = channelData[sample];
+        // the echo has faded out, the delay time jumps to the new preset's
+        if (mPresetFader.switchesNow()) {
+            delayTimeTarget = roundToSamples(*mDelayTimeParameter, sampleRate);
+            mDelayTimeSmoother.reset(delayTimeTarget);
+        }
+        
+        // Frequency Gain Formula: x = x - z * (x - y), where x = smoothed value, y = target value, z = scalar (speed),
+        // worked out for the whole chunk at once
+        const float* gain = mGainSmoother.process(gainTarget, numSamples);
+        const bool gainIsSmoothing = mGainSmoother.isSmoothing();
+        
+        // the glide only moves one way, so the chunk's delay times lie between where it starts and ends
+        const float previousDelayTime = mDelayTimeSmoother.getCurrentValue();
+        const float* delayTimes = mDelayTimeSmoother.process(delayTimeTarget, numSamples);
+        const bool delayTimeIsSmoothing = mDelayTimeSmoother.isSmoothing();
+        
+        const float minDelayInSamples = sampleRate * juce::jmin(previousDelayTime, delayTimes[numSamples - 1]);
+        const float maxDelayInSamples = sampleRate * juce::jmax(previousDelayTime, delayTimes[numSamples - 1]);
+        mDelayTimeInSamples = sampleRate * delayTimes[numSamples - 1];
+        
+        // with the input silent and the echo of earlier chunks gone, there is nothing to delay
+        const float inputPeak = SilenceDetector::getPeak(buffer.getArrayOfWritePointers(), numChannels, offset, numSamples);
+        const float maxGain = juce::jmax(gain[0], gain[numSamples - 1]);
+        const bool wasSilent = mSilenceDetector.isSilent();
+        
+        if (mSilenceDetector.process(inputPeak * maxGain, 0.0f, (int) std::ceil(maxDelayInSamples), numSamples)) {
+            for (int channel = 0; channel < numChannels; ++channel) {
+                juce::FloatVectorOperations::multiply(buffer.getWritePointer(channel, offset), gain, numSamples);
+            }
             
-            mDelayReadHead = mCircularBufferWriteHead - mDelayTimeInSamples;
+            mPresetFader.processDry(buffer.getArrayOfWritePointers(), offset, numChannels, numSamples);
+            continue;
+        }
+        
+        // back from idle, start again from an empty line: what it held within reach was below the
+        // threshold, and anything further back must not resurface if the delay time grows
+        if (wasSilent) {
+            mDelayLine.clearLazily();
+        }
+        
+        // the line is cleared lazily, zero whatever this chunk's reads would find unwritten
+        mDelayLine.ensureReadable(minDelayInSamples, maxDelayInSamples, numSamples);
+        
+        // around a preset switch the echo fades, and the gained input passes straight through
+        mPresetFader.processInput(buffer.getArrayOfWritePointers(), offset, numChannels, numSamples);
+        
+        // each channel runs through the whole chunk on its own row: gain, write, then add the delayed
+        // samples, which for delays shorter than the chunk come out of what was just written; while
+        // the delay time glides, the tap moves every sample and reads between samples
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            float* channelData = buffer.getWritePointer(channel, offset);
             
-            if (mDelayReadHead < 0) {
-                mDelayReadHead += mCircularBufferLength;
+            if (gainIsSmoothing) {
+                juce::FloatVectorOperations::multiply(channelData, gain, numSamples);
+            } else {
+                juce::FloatVectorOperations::multiply(channelData, gain[0], numSamples);
             }
             
-            buffer.addSample(channel, sample, mCircularBuffer[(int)mDelayReadHead]);
-
-            mCircularBufferWriteHead++;
-            
-            if (mCircularBufferWriteHead >= mCircularBufferLength) {
-                mCircularBufferWriteHead = 0;
+            if (delayTimeIsSmoothing) {
+                MultiChannelDelayLine::Channel line = mDelayLine.getChannel(channel);
+                
+                for (int sample = 0; sample < numSamples; ++sample) {
+                    line.write(channelData[sample]);
+                    mDelayedSamples[sample] = line.readLinear(sampleRate * delayTimes[sample]);
+                    line.advance();
+                }
+            } else {
+                mDelayLine.writeBlock(channel, channelData, numSamples);
+                mDelayLine.readBlock(channel, (int) std::round(mDelayTimeInSamples), mDelayedSamples, numSamples);
             }
+            
+            juce::FloatVectorOperations::add(channelData, mDelayedSamples, numSamples);
         }
+        
+        mDelayLine.advance(numSamples);
+        
+        mPresetFader.processWet(buffer.getArrayOfWritePointers(), offset, numChannels, numSamples, gain);
     }
 }
 
+size_t KadenzePluginAudioProcessor::getMemoryFootprint() const
+{
+    return sizeof(*this) + mDelayLine.getMemoryFootprint()
+        + (size_t) mGainSmoother.getMaxBlockSize() * sizeof(float) + mGainSmoother.getMemoryFootprint()
+        + mDelayTimeSmoother.getMemoryFootprint()
+        + mPresetFader.getMemoryFootprint();
+}
+
 //==============================================================================
 bool KadenzePluginAudioProcessor::hasEditor() const
 {
@@ -212,20 +344,21 @@ juce::AudioProcessorEditor* KadenzePluginAudioProcessor::createEditor()
 //==============================================================================
 void KadenzePluginAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    mParameterState.save(destData);
 }
 
 void KadenzePluginAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    mParameterState.restore(data, sizeInBytes);
 }
 
 //==============================================================================
 // This creates new instances of the plugin..
+// (headless hosts such as KadenzeBenchmark link all three processors into one
+// binary, so they define KADENZE_HEADLESS and construct the processors directly)
+#if ! KADENZE_HEADLESS
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new KadenzePluginAudioProcessor();
 }
+#endif
@@ -9,6 +9,13 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "../../Shared/BlockTrace.h"
+#include "../../Shared/MultiChannelDelayLine.h"
+#include "../../Shared/ParameterSmoother.h"
+#include "../../Shared/ParameterState.h"
+#include "../../Shared/PresetPrograms.h"
+#include "../../Shared/RenderProfile.h"
+#include "../../Shared/SilenceDetector.h"
 
 #define MAX_DELAY_TIME 2
 
@@ -55,18 +62,40 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    //==============================================================================
+    // bytes this instance owns once prepared: the object itself plus its delay lines and buffers
+    size_t getMemoryFootprint() const;
+
 private:
     
     juce::AudioParameterFloat* mGainParameter;
-    float mGainSmoothed;
+    ParameterSmoother mGainSmoother;
     
+    juce::AudioParameterFloat* mDelayTimeParameter;
+    ParameterSmoother mDelayTimeSmoother;
+    
+    // where the delay time's glide has got to, in samples
     float mDelayTimeInSamples;
-    float mDelayReadHead;
     
-    int mCircularBufferWriteHead;
-    int mCircularBufferLength;
+    // one row per channel, all sharing the write head
+    MultiChannelDelayLine mDelayLine;
+    
+    // one chunk of one channel's delayed samples
+    juce::HeapBlock<float> mDelayedSamples;
     
-    float* mCircularBuffer;
+    // idle chunks (silent input, nothing audible left in the line) skip the line altogether
+    SilenceDetector mSilenceDetector;
+    
+    ParameterState mParameterState;
+    
+    // the factory presets, and the fade that hides a switch from one to another
+    PresetPrograms mPrograms;
+    PresetFader mPresetFader;
+    
+   #if KADENZE_ENABLE_TRACING
+    // every block's cost against its deadline, for the trace file
+    BlockTrace mBlockTrace;
+   #endif
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (KadenzePluginAudioProcessor)
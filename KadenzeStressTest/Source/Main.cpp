@@ -0,0 +1,705 @@
+/*
+  ==============================================================================
+
+    Headless worst-case stress test for the Kadenze processors.
+
+    Averages hide the block that drops out; this runs every processor the
+    way a busy host does and reports the distribution of processBlock
+    times instead. Each round the host prepares the processor again at a
+    random sample rate and announced block size. The blocks that follow
+    are random sizes: single samples, odd sizes, the announced size, and
+    blocks larger than announced. Before every block each parameter may
+    jump to a random value (the chorus/flanger's type, voices and
+    oversampling included), written from the audio thread as a host's
+    automation is. The input switches between noise, silence and
+    denormal-range noise. Silent stretches drive every feedback to its
+    maximum, so tails ring out towards the denormal range. Meanwhile a
+    second thread, standing in for the host's message thread, switches to
+    a random program every millisecond or so, so the preset writes race
+    the audio thread as they do in a host.
+
+    Every processBlock is timed into a histogram with log-spaced buckets.
+    The report gives p50, p99, p99.9 and the maximum, and the worst block
+    against its own deadline. While the audio thread runs the automation
+    and processBlock, every heap call and every mutex lock it makes is
+    counted. Any at all fails the run, and the first is reported with the
+    block it happened in. Heap calls and locks are caught by interposing
+    malloc and pthread_mutex_lock on Linux. Elsewhere only operator new is
+    replaced, so allocations through malloc and locks go unchecked.
+    --trap raises SIGTRAP at the first one, so a debugger stops with its
+    stack.
+
+    The run is reproducible: the same --seed and --seconds give the same
+    blocks, rates and automation, and the same sequence of programs; only
+    where the program switches land between blocks varies.
+
+    usage: KadenzeStressTest [--seconds <audio seconds per processor>] [--seed <n>]
+                             [--processor <plugin|delay|delay-split|chorusflanger|chorusflanger-rot>]
+                             [--trap]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+#include <csignal>
+
+#if JUCE_LINUX
+ #include <dlfcn.h>
+ #include <pthread.h>
+#endif
+
+#include "../../KadenzePlugin/Source/PluginProcessor.h"
+#include "../../KadenzeDelay/Source/PluginProcessor.h"
+#include "../../KadenzeChorusFlanger/Source/PluginProcessor.h"
+
+//==============================================================================
+// What the audio thread does that it mustn't. Only counted on a thread inside an
+// AudioThreadScope; the hooks below call noteHeapCall() and noteLock().
+namespace AudioThreadChecks
+{
+    thread_local bool isAudioThread = false;
+
+    std::atomic<int> numHeapCalls { 0 };
+    std::atomic<int> numLocks { 0 };
+
+    bool trap = false;
+
+    void noteViolation(std::atomic<int>& counter)
+    {
+        if (counter.fetch_add(1, std::memory_order_relaxed) == 0 && trap) {
+            std::raise(SIGTRAP);
+        }
+    }
+
+    void noteHeapCall()
+    {
+        if (isAudioThread) {
+            noteViolation(numHeapCalls);
+        }
+    }
+
+    void noteLock()
+    {
+        if (isAudioThread) {
+            noteViolation(numLocks);
+        }
+    }
+
+    // marks the thread it lives on as the audio thread; the counters stay as they are
+    struct AudioThreadScope
+    {
+        AudioThreadScope() { isAudioThread = true; }
+        ~AudioThreadScope() { isAudioThread = false; }
+    };
+}
+
+#if JUCE_LINUX
+// glibc's own allocator, under the names it exports for exactly this
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+extern "C" void __libc_free(void* pointer);
+
+extern "C" void* malloc(size_t size) noexcept
+{
+    AudioThreadChecks::noteHeapCall();
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) noexcept
+{
+    AudioThreadChecks::noteHeapCall();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) noexcept
+{
+    AudioThreadChecks::noteHeapCall();
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    AudioThreadChecks::noteHeapCall();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** pointer, size_t alignment, size_t size) noexcept
+{
+    AudioThreadChecks::noteHeapCall();
+    *pointer = __libc_memalign(alignment, size);
+    return *pointer != nullptr || size == 0 ? 0 : ENOMEM;
+}
+
+extern "C" void free(void* pointer) noexcept
+{
+    // freeing nothing costs nothing
+    if (pointer != nullptr) {
+        AudioThreadChecks::noteHeapCall();
+    }
+
+    __libc_free(pointer);
+}
+
+// juce::CriticalSection and std::mutex both end up here
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept
+{
+    static auto* realLock = (int (*)(pthread_mutex_t*)) dlsym(RTLD_NEXT, "pthread_mutex_lock");
+
+    AudioThreadChecks::noteLock();
+    return realLock(mutex);
+}
+
+extern "C" int pthread_mutex_trylock(pthread_mutex_t* mutex) noexcept
+{
+    static auto* realTryLock = (int (*)(pthread_mutex_t*)) dlsym(RTLD_NEXT, "pthread_mutex_trylock");
+
+    AudioThreadChecks::noteLock();
+    return realTryLock(mutex);
+}
+#else
+void* operator new(size_t size)
+{
+    AudioThreadChecks::noteHeapCall();
+
+    if (void* pointer = std::malloc(size > 0 ? size : 1)) {
+        return pointer;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    if (pointer != nullptr) {
+        AudioThreadChecks::noteHeapCall();
+    }
+
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    operator delete(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+#endif
+
+//==============================================================================
+struct ProcessorUnderTest
+{
+    juce::String name;
+    std::function<juce::AudioProcessor*()> create;
+};
+
+// processBlock times in buckets a tenth of a decade wide, from 100 ns up
+class LatencyHistogram
+{
+public:
+    static constexpr int kBucketsPerDecade = 10;
+    static constexpr int kNumBuckets = 7 * kBucketsPerDecade;
+    static constexpr double kMinNanoseconds = 100.0;
+
+    LatencyHistogram()
+    {
+        std::fill(std::begin(mCounts), std::end(mCounts), 0);
+        mNumBlocks = 0;
+        mMaxNanoseconds = 0;
+    }
+
+    void add(double nanoseconds)
+    {
+        mCounts[getBucket(nanoseconds)]++;
+        mNumBlocks++;
+        mMaxNanoseconds = juce::jmax(mMaxNanoseconds, nanoseconds);
+    }
+
+    juce::int64 getNumBlocks() const { return mNumBlocks; }
+    double getMaxNanoseconds() const { return mMaxNanoseconds; }
+
+    // the top of the bucket the fraction of blocks lies in, so never below the exact value
+    double getPercentile(double fraction) const
+    {
+        const juce::int64 rank = (juce::int64) std::ceil(fraction * mNumBlocks);
+        juce::int64 count = 0;
+
+        for (int bucket = 0; bucket < kNumBuckets; bucket++) {
+            count += mCounts[bucket];
+
+            if (count >= rank) {
+                return juce::jmin(getBucketTop(bucket), mMaxNanoseconds);
+            }
+        }
+
+        return mMaxNanoseconds;
+    }
+
+    // every bucket from the first to the last one used, with a bar scaled to the fullest
+    void print() const
+    {
+        int first = 0;
+        int last = kNumBuckets - 1;
+
+        while (first < last && mCounts[first] == 0) {
+            first++;
+        }
+
+        while (last > first && mCounts[last] == 0) {
+            last--;
+        }
+
+        const juce::int64 fullest = *std::max_element(std::begin(mCounts), std::end(mCounts));
+
+        for (int bucket = first; bucket <= last; bucket++)
+        {
+            const int barLength = fullest > 0 ? (int) std::ceil(40.0 * mCounts[bucket] / fullest) : 0;
+
+            std::cout << "    " << formatMicroseconds(getBucketTop(bucket) / kBucketWidth).paddedLeft(' ', 10)
+                      << " - " << formatMicroseconds(getBucketTop(bucket)).paddedRight(' ', 10)
+                      << juce::String(mCounts[bucket]).paddedLeft(' ', 10) << "  "
+                      << juce::String::repeatedString("#", barLength) << std::endl;
+        }
+    }
+
+    static juce::String formatMicroseconds(double nanoseconds)
+    {
+        return juce::String(nanoseconds / 1000.0, nanoseconds < 10000.0 ? 2 : 1) + " us";
+    }
+
+private:
+
+    static constexpr double kBucketWidth = 1.2589254117941673;   // 10^(1 / kBucketsPerDecade)
+
+    static int getBucket(double nanoseconds)
+    {
+        const double decades = std::log10(juce::jmax(nanoseconds, kMinNanoseconds) / kMinNanoseconds);
+        return juce::jlimit(0, kNumBuckets - 1, (int)(decades * kBucketsPerDecade));
+    }
+
+    static double getBucketTop(int bucket)
+    {
+        return kMinNanoseconds * std::pow(10.0, (bucket + 1) / (double) kBucketsPerDecade);
+    }
+
+    juce::int64 mCounts[kNumBuckets];
+    juce::int64 mNumBlocks;
+    double mMaxNanoseconds;
+};
+
+// the host's message thread, switching programs while the audio thread runs; what it does on its
+// own thread isn't checked, only what the switches make the audio thread do
+class ProgramSwitcher : private juce::Thread
+{
+public:
+    ProgramSwitcher(juce::AudioProcessor& processor, juce::int64 seed)
+        : juce::Thread("Kadenze program switcher"),
+          mProcessor(processor),
+          mRandom(seed)
+    {
+        mNumSwitches = 0;
+    }
+
+    ~ProgramSwitcher() override
+    {
+        stop();
+    }
+
+    void start()
+    {
+        if (mProcessor.getNumPrograms() > 1) {
+            startThread();
+        }
+    }
+
+    void stop()
+    {
+        stopThread(1000);
+    }
+
+    int getNumSwitches() const { return mNumSwitches; }
+
+private:
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            wait(1 + mRandom.nextInt(kMaxIntervalMs));
+
+            if (threadShouldExit()) {
+                break;
+            }
+
+            mProcessor.setCurrentProgram(mRandom.nextInt(mProcessor.getNumPrograms()));
+            mNumSwitches++;
+        }
+    }
+
+    // the longest wait between switches; the audio runs far faster than realtime, so even a
+    // millisecond apart the switches land fades or more from each other
+    static constexpr int kMaxIntervalMs = 2;
+
+    juce::AudioProcessor& mProcessor;
+    juce::Random mRandom;
+    std::atomic<int> mNumSwitches;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProgramSwitcher)
+};
+
+// where the first heap call or lock happened
+struct Violation
+{
+    juce::String what;
+    double sampleRate;
+    int announcedBlockSize;
+    int blockSize;
+    juce::int64 block;
+};
+
+static const double kSampleRates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+static const int kAnnouncedBlockSizes[] = { 32, 64, 128, 256, 441, 512, 1024, 2048, 4096 };
+
+// hosts may send up to twice what they announced
+static const int kMaxBlockSize = 2 * 4096;
+
+static const int kNumChannels = 2;
+
+// how long the host keeps one rate and block size, and one kind of input
+static const double kMinRoundSeconds = 0.2;
+static const double kMaxRoundSeconds = 1.0;
+static const double kMinSegmentSeconds = 0.02;
+static const double kMaxSegmentSeconds = 0.4;
+
+// the chance, before each block, that a parameter jumps
+static const float kAutomationProbability = 0.125f;
+
+static const char* const kUsage =
+    "usage: KadenzeStressTest [--seconds <s>] [--seed <n>]\n"
+    "                         [--processor <plugin|delay|delay-split|chorusflanger|chorusflanger-rot>]\n"
+    "                         [--trap]";
+
+//==============================================================================
+static std::vector<ProcessorUnderTest> createProcessorsUnderTest()
+{
+    return { { "plugin", [] { return new KadenzePluginAudioProcessor(); } },
+             { "delay", [] { return new KadenzeDelayAudioProcessor(); } },
+             { "delay-split", [] {
+                   auto* processor = new KadenzeDelayAudioProcessor();
+                   processor->setDelayLineLayout(KadenzeDelayAudioProcessor::DelayLineLayout::split);
+                   return processor;
+               } },
+             { "chorusflanger", [] { return new KadenzeChorusFlangerAudioProcessor(); } },
+             { "chorusflanger-rot", [] {
+                   auto* processor = new KadenzeChorusFlangerAudioProcessor();
+                   processor->setLFOBackend(LFO::Backend::quadrature);
+                   return processor;
+               } } };
+}
+
+// single samples, odd sizes, anything up to the announced size, exactly that, and more
+static int pickBlockSize(juce::Random& random, int announcedBlockSize)
+{
+    const int kind = random.nextInt(10);
+
+    if (kind == 0) {
+        return 1;
+    }
+
+    if (kind == 1) {
+        return 2 * random.nextInt(16) + 3;
+    }
+
+    if (kind == 2) {
+        return announcedBlockSize;
+    }
+
+    if (kind == 3) {
+        return announcedBlockSize + 1 + random.nextInt(announcedBlockSize);
+    }
+
+    return 1 + random.nextInt(announcedBlockSize);
+}
+
+enum class InputKind
+{
+    noise,
+    silence,        // what a loud stretch leaves ringing in the feedback
+    denormal        // noise far below the smallest normal float
+};
+
+static void fillInput(juce::AudioBuffer<float>& buffer, int numSamples, InputKind kind, float level, juce::Random& random)
+{
+    for (int channel = 0; channel < kNumChannels; channel++)
+    {
+        float* samples = buffer.getWritePointer(channel);
+
+        for (int sample = 0; sample < numSamples; sample++)
+        {
+            switch (kind)
+            {
+                case InputKind::noise:
+                    samples[sample] = (random.nextFloat() * 2.0f - 1.0f) * level;
+                    break;
+                case InputKind::denormal:
+                    samples[sample] = (random.nextFloat() * 2.0f - 1.0f) * 1.0e-39f;
+                    break;
+                case InputKind::silence:
+                default:
+                    samples[sample] = 0;
+                    break;
+            }
+        }
+    }
+}
+
+static int countDenormals(const juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    int numDenormals = 0;
+
+    for (int channel = 0; channel < kNumChannels; channel++)
+    {
+        const float* samples = buffer.getReadPointer(channel);
+
+        for (int sample = 0; sample < numSamples; sample++) {
+            numDenormals += std::fpclassify(samples[sample]) == FP_SUBNORMAL ? 1 : 0;
+        }
+    }
+
+    return numDenormals;
+}
+
+//==============================================================================
+// returns whether the processor got through without a heap call or a lock on the audio thread
+static bool runStressTest(const ProcessorUnderTest& processorUnderTest, double secondsOfAudio, juce::int64 seed)
+{
+    std::unique_ptr<juce::AudioProcessor> processor(processorUnderTest.create());
+    processor->setPlayConfigDetails(kNumChannels, kNumChannels, kSampleRates[0], kAnnouncedBlockSizes[0]);
+
+    juce::Array<juce::AudioProcessorParameter*> parameters(processor->getParameters());
+
+    // the tails ring longest with every feedback at its maximum
+    juce::Array<juce::AudioProcessorParameter*> feedbackParameters;
+
+    for (auto* param : parameters) {
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(param)) {
+            if (ranged->paramID.containsIgnoreCase("feedback")) {
+                feedbackParameters.add(param);
+            }
+        }
+    }
+
+    juce::Random random(seed);
+    juce::AudioBuffer<float> buffer(kNumChannels, kMaxBlockSize);
+    juce::MidiBuffer midiMessages;
+
+    LatencyHistogram histogram;
+    double worstDeadlineRatio = 0;
+    int worstDeadlineBlockSize = 0;
+
+    // its own random, so the audio thread's blocks stay the same whenever it switches
+    ProgramSwitcher programSwitcher(*processor, seed);
+
+    std::vector<Violation> violations;
+    juce::int64 block = 0;
+    juce::int64 numDenormals = 0;
+    int numPrepares = 0;
+    double totalSeconds = 0;
+
+    while (totalSeconds < secondsOfAudio)
+    {
+        // a new round: the host may release the processor first, then prepares it at a new rate
+        // and block size
+        const double sampleRate = kSampleRates[random.nextInt((int) juce::numElementsInArray(kSampleRates))];
+        const int announcedBlockSize = kAnnouncedBlockSizes[random.nextInt((int) juce::numElementsInArray(kAnnouncedBlockSizes))];
+
+        if (random.nextBool()) {
+            processor->releaseResources();
+        }
+
+        processor->setRateAndBufferSizeDetails(sampleRate, announcedBlockSize);
+        processor->prepareToPlay(sampleRate, announcedBlockSize);
+        numPrepares++;
+
+        if (numPrepares == 1) {
+            programSwitcher.start();
+        }
+
+        const double roundSeconds = kMinRoundSeconds + random.nextDouble() * (kMaxRoundSeconds - kMinRoundSeconds);
+        const juce::int64 numRoundSamples = (juce::int64)(roundSeconds * sampleRate);
+
+        InputKind inputKind = InputKind::noise;
+        float inputLevel = 0;
+        juce::int64 segmentEnd = 0;
+
+        for (juce::int64 position = 0; position < numRoundSamples; block++)
+        {
+            if (position >= segmentEnd) {
+                inputKind = (InputKind) random.nextInt(3);
+                inputLevel = 0.1f + 0.9f * random.nextFloat();
+                segmentEnd = position + (juce::int64)((kMinSegmentSeconds + random.nextDouble() * (kMaxSegmentSeconds - kMinSegmentSeconds)) * sampleRate);
+            }
+
+            const int blockSize = pickBlockSize(random, announcedBlockSize);
+            fillInput(buffer, blockSize, inputKind, inputLevel, random);
+
+            // the automation's values are drawn here, so the audio thread only writes them
+            float values[64];
+            const int numValues = juce::jmin(parameters.size(), (int) juce::numElementsInArray(values));
+
+            for (int index = 0; index < numValues; index++) {
+                values[index] = random.nextFloat() < kAutomationProbability ? random.nextFloat() : -1.0f;
+            }
+
+            const bool maxFeedback = inputKind != InputKind::noise;
+
+            juce::AudioBuffer<float> blockBuffer(buffer.getArrayOfWritePointers(), kNumChannels, blockSize);
+
+            const int numHeapCalls = AudioThreadChecks::numHeapCalls.load();
+            const int numLocks = AudioThreadChecks::numLocks.load();
+            juce::int64 elapsedTicks;
+
+            {
+                const AudioThreadChecks::AudioThreadScope audioThread;
+
+                for (int index = 0; index < numValues; index++) {
+                    if (values[index] >= 0) {
+                        parameters.getUnchecked(index)->setValue(values[index]);
+                    }
+                }
+
+                if (maxFeedback) {
+                    for (auto* param : feedbackParameters) {
+                        param->setValue(1.0f);
+                    }
+                }
+
+                const juce::int64 start = juce::Time::getHighResolutionTicks();
+                processor->processBlock(blockBuffer, midiMessages);
+                elapsedTicks = juce::Time::getHighResolutionTicks() - start;
+            }
+
+            const double nanoseconds = juce::Time::highResolutionTicksToSeconds(elapsedTicks) * 1.0e9;
+            histogram.add(nanoseconds);
+
+            const double deadlineRatio = nanoseconds * 1.0e-9 * sampleRate / blockSize;
+
+            if (deadlineRatio > worstDeadlineRatio) {
+                worstDeadlineRatio = deadlineRatio;
+                worstDeadlineBlockSize = blockSize;
+            }
+
+            if (violations.empty() && (AudioThreadChecks::numHeapCalls.load() != numHeapCalls || AudioThreadChecks::numLocks.load() != numLocks)) {
+                const juce::String what = AudioThreadChecks::numHeapCalls.load() != numHeapCalls ? "heap call" : "lock";
+                violations.push_back({ what, sampleRate, announcedBlockSize, blockSize, block });
+            }
+
+            numDenormals += countDenormals(blockBuffer, blockSize);
+            position += blockSize;
+        }
+
+        totalSeconds += numRoundSamples / sampleRate;
+    }
+
+    programSwitcher.stop();
+    processor->releaseResources();
+
+    std::cout << processorUnderTest.name << ": " << histogram.getNumBlocks() << " blocks, "
+              << juce::String(totalSeconds, 1) << " s of audio, " << numPrepares << " prepares, "
+              << programSwitcher.getNumSwitches() << " program switches, seed " << seed << std::endl;
+
+    std::cout << "  processBlock   p50 " << LatencyHistogram::formatMicroseconds(histogram.getPercentile(0.5))
+              << "   p99 " << LatencyHistogram::formatMicroseconds(histogram.getPercentile(0.99))
+              << "   p99.9 " << LatencyHistogram::formatMicroseconds(histogram.getPercentile(0.999))
+              << "   max " << LatencyHistogram::formatMicroseconds(histogram.getMaxNanoseconds()) << std::endl;
+
+    std::cout << "  worst block    " << juce::String(worstDeadlineRatio * 100.0, 2) << "% of its deadline ("
+              << worstDeadlineBlockSize << (worstDeadlineBlockSize == 1 ? " sample)" : " samples)") << std::endl;
+
+    histogram.print();
+
+    std::cout << "  denormal output samples: " << numDenormals << std::endl;
+
+    const bool passed = violations.empty();
+
+    if (passed) {
+        std::cout << "  audio thread: no heap calls or locks" << std::endl;
+    } else {
+        const Violation& first = violations.front();
+
+        std::cout << "  audio thread: FAILED, first " << first.what << " in block " << first.block
+                  << " (" << first.blockSize << " samples, prepared for " << first.announcedBlockSize
+                  << " at " << (int) first.sampleRate << " Hz)" << std::endl;
+    }
+
+    std::cout << std::endl;
+    return passed;
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the chorus/flanger's latency timer and the program switches expect a message manager, as in a host
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    double secondsOfAudio = 10.0;
+    juce::int64 seed = 1;
+    juce::String processorFilter;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const juce::String arg(argv[i]);
+
+        if (arg == "--seconds" && i + 1 < argc) {
+            secondsOfAudio = juce::String(argv[++i]).getDoubleValue();
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = juce::String(argv[++i]).getLargeIntValue();
+        } else if (arg == "--processor" && i + 1 < argc) {
+            processorFilter = argv[++i];
+        } else if (arg == "--trap") {
+            AudioThreadChecks::trap = true;
+        } else {
+            std::cerr << kUsage << std::endl;
+            return 1;
+        }
+    }
+
+   #if ! JUCE_LINUX
+    std::cout << "malloc and locks are only checked on Linux, here just operator new is" << std::endl << std::endl;
+   #endif
+
+    bool passed = true;
+    int numRun = 0;
+
+    for (auto& processorUnderTest : createProcessorsUnderTest())
+    {
+        if (processorFilter.isNotEmpty() && processorFilter != processorUnderTest.name) {
+            continue;
+        }
+
+        passed = runStressTest(processorUnderTest, secondsOfAudio, seed) && passed;
+        numRun++;
+    }
+
+    if (numRun == 0) {
+        std::cerr << kUsage << std::endl;
+        return 1;
+    }
+
+    return passed ? 0 : 2;
+}
@@ -0,0 +1,244 @@
+/*
+  ==============================================================================
+
+    BlockTrace.cpp
+
+  ==============================================================================
+*/
+
+#include "BlockTrace.h"
+
+#if KADENZE_ENABLE_TRACING
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+static_assert((BlockTrace::kCapacity & (BlockTrace::kCapacity - 1)) == 0, "the ring wraps with a mask");
+
+// the writer goes when the last instance does and comes back with the next one, this counts how
+// often that happened in this process
+static std::atomic<int> numWritersCreated { 0 };
+
+BlockTrace::BlockTrace()
+{
+    mEvents.allocate(kCapacity, true);
+    mWritePosition = 0;
+    mReadPosition = 0;
+    mNumDropped = 0;
+
+    mTicksPerSample = 0;
+
+    mId = mWriter->add(this);
+}
+
+BlockTrace::~BlockTrace()
+{
+    mWriter->remove(this);
+}
+
+void BlockTrace::prepare(const juce::String& name, double sampleRate)
+{
+    mTicksPerSample = juce::Time::getHighResolutionTicksPerSecond() / sampleRate;
+
+    mWriter->setTrackName(mId, name + " #" + juce::String(mId));
+}
+
+BlockTrace::Scope::Scope(BlockTrace& trace, int numSamples) noexcept
+    : mTrace(trace)
+{
+    mNumSamples = numSamples;
+    mStartTicks = juce::Time::getHighResolutionTicks();
+    mStartCycles = readCycleCounter();
+}
+
+BlockTrace::Scope::~Scope()
+{
+    Event event;
+    event.elapsedCycles = readCycleCounter() - mStartCycles;
+    event.elapsedTicks = juce::Time::getHighResolutionTicks() - mStartTicks;
+    event.startTicks = mStartTicks;
+    event.numSamples = mNumSamples;
+
+    const double deadlineTicks = mNumSamples * mTrace.mTicksPerSample;
+    event.deadlineRatio = deadlineTicks > 0 ? (float)(event.elapsedTicks / deadlineTicks) : 0.0f;
+
+    mTrace.push(event);
+}
+
+template <typename WriteEvent>
+int BlockTrace::drain(WriteEvent&& writeEvent)
+{
+    const juce::uint32 readPosition = mReadPosition.load(std::memory_order_relaxed);
+    const juce::uint32 writePosition = mWritePosition.load(std::memory_order_acquire);
+
+    for (juce::uint32 position = readPosition; position != writePosition; position++) {
+        writeEvent(mEvents[position & (kCapacity - 1)]);
+    }
+
+    // the slots are free again once the positions say so
+    mReadPosition.store(writePosition, std::memory_order_release);
+
+    return mNumDropped.exchange(0);
+}
+
+juce::uint64 BlockTrace::readCycleCounter() noexcept
+{
+   #if JUCE_INTEL
+    return (juce::uint64)__rdtsc();
+   #elif defined (__aarch64__)
+    juce::uint64 counter;
+    asm volatile ("mrs %0, cntvct_el0" : "=r" (counter));
+    return counter;
+   #else
+    return (juce::uint64)juce::Time::getHighResolutionTicks();
+   #endif
+}
+
+void BlockTrace::push(const Event& event) noexcept
+{
+    const juce::uint32 writePosition = mWritePosition.load(std::memory_order_relaxed);
+    const juce::uint32 readPosition = mReadPosition.load(std::memory_order_acquire);
+
+    // full: the writer hasn't caught up, keep what is there and count the loss
+    if (writePosition - readPosition >= (juce::uint32)kCapacity) {
+        mNumDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    mEvents[writePosition & (kCapacity - 1)] = event;
+    mWritePosition.store(writePosition + 1, std::memory_order_release);
+}
+
+//==============================================================================
+BlockTraceWriter::BlockTraceWriter()
+    : juce::Thread("Kadenze block trace")
+{
+    mNextId = 1;
+    mFirstEvent = true;
+    mOriginTicks = juce::Time::getHighResolutionTicks();
+
+    const juce::String path = juce::SystemStats::getEnvironmentVariable("KADENZE_TRACE_FILE", {});
+    juce::File file = juce::File::getSpecialLocation(juce::File::tempDirectory).getNonexistentChildFile("KadenzeTrace", ".json", false);
+
+    // the process's first writer replaces whatever an earlier run left in the named file (a
+    // FileOutputStream would append to it); later ones, once every instance has gone and a new one
+    // comes, start a file of their own next to it, so no trace of this run is lost
+    if (path.isNotEmpty()) {
+        file = juce::File(path);
+
+        if (numWritersCreated++ == 0) {
+            file.deleteFile();
+        } else {
+            file = file.getNonexistentSibling(false);
+        }
+    }
+
+    mStream = file.createOutputStream();
+
+    if (mStream != nullptr) {
+        *mStream << "[\n";
+    }
+
+    startThread();
+}
+
+BlockTraceWriter::~BlockTraceWriter()
+{
+    stopThread(1000);
+
+    if (mStream != nullptr) {
+        *mStream << "\n]\n";
+        mStream->flush();
+    }
+}
+
+int BlockTraceWriter::add(BlockTrace* trace)
+{
+    const juce::ScopedLock lock(mLock);
+
+    mTraces.add(trace);
+    return mNextId++;
+}
+
+void BlockTraceWriter::remove(BlockTrace* trace)
+{
+    const juce::ScopedLock lock(mLock);
+
+    drain(*trace);
+    mTraces.removeFirstMatchingValue(trace);
+}
+
+void BlockTraceWriter::setTrackName(int id, const juce::String& name)
+{
+    const juce::ScopedLock lock(mLock);
+
+    write("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + juce::String(id)
+          + ",\"args\":{\"name\":\"" + name + "\"}}");
+}
+
+void BlockTraceWriter::run()
+{
+    while (! threadShouldExit())
+    {
+        wait(kDrainIntervalMs);
+
+        const juce::ScopedLock lock(mLock);
+
+        for (auto* trace : mTraces) {
+            drain(*trace);
+        }
+
+        if (mStream != nullptr) {
+            mStream->flush();
+        }
+    }
+}
+
+void BlockTraceWriter::drain(BlockTrace& trace)
+{
+    const juce::String tid(trace.getId());
+
+    const int numDropped = trace.drain([this, &tid] (const BlockTrace::Event& event)
+    {
+        // the trace format counts in microseconds
+        const double start = juce::Time::highResolutionTicksToSeconds(event.startTicks - mOriginTicks) * 1.0e6;
+        const double duration = juce::Time::highResolutionTicksToSeconds(event.elapsedTicks) * 1.0e6;
+        const bool overrun = event.deadlineRatio >= 1;
+
+        write("{\"name\":\"processBlock\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid
+              + ",\"ts\":" + juce::String(start, 3) + ",\"dur\":" + juce::String(duration, 3)
+              + (overrun ? ",\"cname\":\"terrible\"" : "")
+              + ",\"args\":{\"samples\":" + juce::String(event.numSamples)
+              + ",\"cycles\":" + juce::String((juce::int64)event.elapsedCycles)
+              + ",\"deadline\":" + juce::String(event.deadlineRatio, 3) + "}}");
+
+        if (overrun) {
+            write("{\"name\":\"overrun\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" + tid
+                  + ",\"ts\":" + juce::String(start + duration, 3) + "}");
+        }
+    });
+
+    if (numDropped > 0) {
+        const double now = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - mOriginTicks) * 1.0e6;
+
+        write("{\"name\":\"dropped " + juce::String(numDropped) + " blocks\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" + tid
+              + ",\"ts\":" + juce::String(now, 3) + "}");
+    }
+}
+
+void BlockTraceWriter::write(const juce::String& event)
+{
+    if (mStream == nullptr) {
+        return;
+    }
+
+    *mStream << (mFirstEvent ? "" : ",\n") << event;
+    mFirstEvent = false;
+}
+
+#endif
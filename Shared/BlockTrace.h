@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+    BlockTrace.h
+
+    Per-instance processBlock timing, written to a Chrome trace file that
+    chrome://tracing and ui.perfetto.dev open as one track per instance.
+    Every block records its start, elapsed time and cycles, its size and
+    its deadline ratio (elapsed time over the block's duration, above 1 the
+    block took longer than it plays for). Blocks over their deadline are
+    coloured and get an overrun marker, so an instance that blows the budget
+    under load stands out at a glance.
+
+    The audio thread only pushes into a preallocated single-producer ring;
+    a background thread, shared by every instance, drains the rings a few
+    times a second and appends to the file. A ring that fills up drops the
+    newest blocks and the trace says how many. The file is a JSON array
+    written as it goes, so it opens even if the host never shuts down.
+
+    Tracing is off unless the build defines KADENZE_ENABLE_TRACING=1; off,
+    the hooks below expand to nothing and the processors carry no trace
+    member. The file goes to KADENZE_TRACE_FILE if that is set in the
+    environment, otherwise to a new KadenzeTrace.json in the temp directory.
+    The writer only lives while some instance does; when it comes back
+    later in the same process, it starts a new file next to the first
+    rather than replacing it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef KADENZE_ENABLE_TRACING
+ #define KADENZE_ENABLE_TRACING 0
+#endif
+
+#if KADENZE_ENABLE_TRACING
+
+class BlockTraceWriter;
+
+//==============================================================================
+/**
+*/
+class BlockTrace
+{
+public:
+    // blocks the ring holds between drains, a power of two (5 s of 64-sample blocks at 48 kHz)
+    static constexpr int kCapacity = 4096;
+
+    struct Event
+    {
+        juce::int64 startTicks;
+        juce::int64 elapsedTicks;
+        juce::uint64 elapsedCycles;
+        int numSamples;
+        float deadlineRatio;
+    };
+
+    BlockTrace();
+    ~BlockTrace();
+
+    // message thread, from prepareToPlay: names the instance's track, and sets the rate the
+    // deadline is worked out at
+    void prepare(const juce::String& name, double sampleRate);
+
+    // times the block it lives in
+    class Scope
+    {
+    public:
+        Scope(BlockTrace& trace, int numSamples) noexcept;
+        ~Scope();
+
+    private:
+        BlockTrace& mTrace;
+        int mNumSamples;
+        juce::int64 mStartTicks;
+        juce::uint64 mStartCycles;
+    };
+
+    // the writer thread: hands every event recorded since the last call to writeEvent, oldest
+    // first, and returns how many blocks were dropped in the meantime
+    template <typename WriteEvent>
+    int drain(WriteEvent&& writeEvent);
+
+    int getId() const { return mId; }
+
+    // a timestamp counter: cpu cycles on x86, elsewhere the finest counter the platform has
+    static juce::uint64 readCycleCounter() noexcept;
+
+private:
+
+    // the audio thread, never blocks
+    void push(const Event& event) noexcept;
+
+    juce::HeapBlock<Event> mEvents;
+    std::atomic<juce::uint32> mWritePosition;
+    std::atomic<juce::uint32> mReadPosition;
+    std::atomic<int> mNumDropped;
+
+    double mTicksPerSample;
+
+    juce::SharedResourcePointer<BlockTraceWriter> mWriter;
+    int mId;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BlockTrace)
+};
+
+//==============================================================================
+/**
+*/
+class BlockTraceWriter : private juce::Thread
+{
+public:
+    // how often the rings are drained into the file
+    static constexpr int kDrainIntervalMs = 100;
+
+    BlockTraceWriter();
+    ~BlockTraceWriter() override;
+
+    // returns the id of the instance's track
+    int add(BlockTrace* trace);
+
+    // drains what the trace still holds before it goes
+    void remove(BlockTrace* trace);
+
+    void setTrackName(int id, const juce::String& name);
+
+private:
+
+    void run() override;
+
+    // with mLock held
+    void drain(BlockTrace& trace);
+    void write(const juce::String& event);
+
+    juce::CriticalSection mLock;
+    juce::Array<BlockTrace*> mTraces;
+    int mNextId;
+
+    std::unique_ptr<juce::FileOutputStream> mStream;
+    bool mFirstEvent;
+
+    // the trace's time zero
+    juce::int64 mOriginTicks;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BlockTraceWriter)
+};
+
+#endif
+
+// the processors' hooks, for prepareToPlay and the top of processBlock
+#if KADENZE_ENABLE_TRACING
+ #define KADENZE_TRACE_PREPARE(trace, name, sampleRate) trace.prepare(name, sampleRate)
+ #define KADENZE_TRACE_BLOCK(trace, numSamples) const BlockTrace::Scope blockTraceScope(trace, numSamples)
+#else
+ #define KADENZE_TRACE_PREPARE(trace, name, sampleRate)
+ #define KADENZE_TRACE_BLOCK(trace, numSamples)
+#endif
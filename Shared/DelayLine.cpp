@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    DelayLine.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayLine.h"
+
+DelayLine::DelayLine()
+{
+    mCapacity = 0;
+    mMask = 0;
+    mWriteHead = 0;
+}
+
+void DelayLine::swapWith(DelayLine& other) noexcept
+{
+    mBuffer.swapWith(other.mBuffer);
+    std::swap(mCapacity, other.mCapacity);
+    std::swap(mMask, other.mMask);
+    std::swap(mWriteHead, other.mWriteHead);
+    std::swap(mLazyClear, other.mLazyClear);
+}
+
+void DelayLine::prepare(int maxDelayInSamples)
+{
+    // the interpolating reads touch one sample beyond the longest delay
+    const int capacity = juce::nextPowerOfTwo(juce::jmax(maxDelayInSamples + 2, kNumGuardSamples));
+
+    if (capacity != mCapacity) {
+        mBuffer = mPool->allocate(capacity + kNumGuardSamples);
+        mCapacity = capacity;
+        mMask = capacity - 1;
+    }
+
+    clearLazily();
+}
+
+void DelayLine::clear()
+{
+    juce::zeromem(mBuffer.getData(), (size_t)(mCapacity + kNumGuardSamples) * sizeof(float));
+    mWriteHead = 0;
+    mLazyClear.setFull(mCapacity);
+}
+
+void DelayLine::clearLazily()
+{
+    mWriteHead = 0;
+    mLazyClear.reset();
+}
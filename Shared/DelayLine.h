@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    DelayLine.h
+
+    Circular delay buffer whose capacity is rounded up to a power of two, so
+    the heads wrap with a bitmask instead of a compare-and-subtract. The first
+    few samples are mirrored past the end of the buffer, which lets the
+    interpolating reads run off the end without checking for the wrap.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayMemoryPool.h"
+#include "LazyClear.h"
+
+//==============================================================================
+/**
+*/
+class DelayLine
+{
+public:
+    // how many samples past the end are mirrored from the start of the buffer
+    static constexpr int kNumGuardSamples = 8;
+
+    DelayLine();
+
+    // make room for delays of up to maxDelayInSamples, reallocating only if the capacity changes;
+    // this clears the line lazily, see ensureReadable()
+    void prepare(int maxDelayInSamples);
+
+    // zero the whole buffer and rewind the write head
+    void clear();
+
+    // rewind the write head and forget what was written, without touching the buffer
+    void clearLazily();
+
+    // call before every block after a lazy clear: makes sure the block's reads, at delays between
+    // minDelayInSamples and maxDelayInSamples, only ever find written samples or zeros
+    inline void ensureReadable(float minDelayInSamples, float maxDelayInSamples, int numSamples)
+    {
+        mLazyClear.ensureReadable(mCapacity, mWriteHead, minDelayInSamples, maxDelayInSamples, numSamples,
+                                  [this] (int begin, int end) { juce::zeromem(mBuffer + begin, (size_t)(end - begin) * sizeof(float)); });
+    }
+
+    // exchange buffers and heads with another line; no allocation, so a line prepared off the
+    // audio thread can be swapped in under the processor's callback lock
+    void swapWith(DelayLine& other) noexcept;
+
+    // store a sample at the write head (call advance() once the sample's reads are done)
+    inline void write(float sample)
+    {
+        mBuffer[mWriteHead] = sample;
+
+        // the mirror index is the write head itself except inside the guard region,
+        // so this is a select rather than a branch
+        mBuffer[mWriteHead + (mWriteHead < kNumGuardSamples ? mCapacity : 0)] = sample;
+    }
+
+    inline void advance()
+    {
+        mWriteHead = (mWriteHead + 1) & mMask;
+        mLazyClear.advance(1);
+    }
+
+    // the sample written delayInSamples samples before the current write head
+    inline float read(int delayInSamples) const
+    {
+        return mBuffer[(mWriteHead - delayInSamples) & mMask];
+    }
+
+    // linearly interpolated read, delayInSamples may be anywhere in [0, capacity - 2]
+    inline float readLinear(float delayInSamples) const
+    {
+        // split the delay before subtracting it, so large write heads don't eat the float precision
+        const int delayWhole = (int)delayInSamples;
+        const float delayFraction = delayInSamples - delayWhole;
+
+        // x[0] is one sample further back than the whole delay, x[1] may sit in the guard region
+        const float* x = mBuffer + ((mWriteHead - delayWhole - 1) & mMask);
+        const float fraction = 1.0f - delayFraction;
+
+        return x[0] + fraction * (x[1] - x[0]);
+    }
+
+    int getCapacity() const { return mCapacity; }
+    int getMask() const { return mMask; }
+    int getWriteHead() const { return mWriteHead; }
+
+    // raw storage, valid for getCapacity() + kNumGuardSamples samples
+    const float* getData() const { return mBuffer; }
+
+    // bytes allocated for the buffer, including the guard samples
+    size_t getMemoryFootprint() const { return mBuffer.getNumBytes(); }
+
+private:
+
+    // the pool goes first, so it outlives the block
+    juce::SharedResourcePointer<DelayMemoryPool> mPool;
+    DelayMemoryPool::Block mBuffer;
+
+    int mCapacity;
+    int mMask;
+    int mWriteHead;
+
+    LazyClear mLazyClear;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayLine)
+};
@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+    DelayMemoryPool.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayMemoryPool.h"
+
+//==============================================================================
+DelayMemoryPool::Block::Block() noexcept
+{
+    mPool = nullptr;
+    mData = nullptr;
+    mNumBytes = 0;
+}
+
+DelayMemoryPool::Block::Block(Block&& other) noexcept
+{
+    mPool = other.mPool;
+    mData = other.mData;
+    mNumBytes = other.mNumBytes;
+
+    other.mData = nullptr;
+    other.mNumBytes = 0;
+}
+
+DelayMemoryPool::Block& DelayMemoryPool::Block::operator=(Block&& other) noexcept
+{
+    if (this != &other) {
+        reset();
+        swapWith(other);
+    }
+
+    return *this;
+}
+
+DelayMemoryPool::Block::~Block()
+{
+    reset();
+}
+
+void DelayMemoryPool::Block::reset()
+{
+    if (mData != nullptr) {
+        mPool->release(mData, mNumBytes);
+        mData = nullptr;
+        mNumBytes = 0;
+    }
+}
+
+void DelayMemoryPool::Block::swapWith(Block& other) noexcept
+{
+    std::swap(mPool, other.mPool);
+    std::swap(mData, other.mData);
+    std::swap(mNumBytes, other.mNumBytes);
+}
+
+//==============================================================================
+DelayMemoryPool::DelayMemoryPool()
+{
+    mBytesInUse = 0;
+    mBytesSpare = 0;
+}
+
+DelayMemoryPool::~DelayMemoryPool()
+{
+    // every block holds on to the pool through its delay line's SharedResourcePointer
+    jassert(mBytesInUse == 0);
+
+    for (auto& spare : mSpareBlocks) {
+        freeAligned(spare.data);
+    }
+}
+
+DelayMemoryPool::Block DelayMemoryPool::allocate(size_t numFloats)
+{
+    const size_t numBytes = (numFloats * sizeof(float) + kAlignment - 1) & ~(kAlignment - 1);
+
+    Block block;
+    block.mPool = this;
+    block.mNumBytes = numBytes;
+
+    const juce::ScopedLock lock(mLock);
+
+    // the newest spare of the same size is the most likely to still be in cache
+    for (int i = mSpareBlocks.size() - 1; i >= 0; i--)
+    {
+        if (mSpareBlocks.getReference(i).numBytes == numBytes) {
+            block.mData = mSpareBlocks.getReference(i).data;
+            mSpareBlocks.remove(i);
+            mBytesSpare -= numBytes;
+            break;
+        }
+    }
+
+    if (block.mData == nullptr) {
+        block.mData = allocateAligned(numBytes);
+    }
+
+    if (block.mData == nullptr) {
+        jassertfalse;
+        block.mNumBytes = 0;
+        return block;
+    }
+
+    mBytesInUse += numBytes;
+    trimSpares();
+
+    return block;
+}
+
+size_t DelayMemoryPool::getBytesInUse() const
+{
+    const juce::ScopedLock lock(mLock);
+    return mBytesInUse;
+}
+
+size_t DelayMemoryPool::getBytesSpare() const
+{
+    const juce::ScopedLock lock(mLock);
+    return mBytesSpare;
+}
+
+void DelayMemoryPool::release(float* data, size_t numBytes)
+{
+    const juce::ScopedLock lock(mLock);
+
+    mBytesInUse -= numBytes;
+
+    mSpareBlocks.add({ data, numBytes });
+    mBytesSpare += numBytes;
+
+    trimSpares();
+}
+
+void DelayMemoryPool::trimSpares()
+{
+    // keep no more spare memory than is in use, so the pool follows demand down as well as up
+    while (! mSpareBlocks.isEmpty() && (mSpareBlocks.size() > kMaxSpareBlocks || mBytesSpare > mBytesInUse))
+    {
+        const SpareBlock oldest = mSpareBlocks.getReference(0);
+        mSpareBlocks.remove(0);
+        mBytesSpare -= oldest.numBytes;
+
+        freeAligned(oldest.data);
+    }
+}
+
+float* DelayMemoryPool::allocateAligned(size_t numBytes)
+{
+    // over-allocate by one alignment, so there is always room for the original pointer
+    // just before the aligned address
+    void* raw = std::malloc(numBytes + kAlignment);
+
+    if (raw == nullptr) {
+        return nullptr;
+    }
+
+    const uintptr_t address = (reinterpret_cast<uintptr_t>(raw) + kAlignment) & ~(uintptr_t)(kAlignment - 1);
+    reinterpret_cast<void**>(address)[-1] = raw;
+
+    return reinterpret_cast<float*>(address);
+}
+
+void DelayMemoryPool::freeAligned(float* data)
+{
+    std::free(reinterpret_cast<void**>(data)[-1]);
+}
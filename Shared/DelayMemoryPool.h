@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    DelayMemoryPool.h
+
+    Process-wide pool of 64-byte aligned delay-line memory, shared by every
+    plugin instance through a juce::SharedResourcePointer. Blocks handed back
+    by one instance are kept as spares and reused by the next instance that
+    asks for the same size (instances at one sample rate and channel count
+    always do), so re-preparing a set of instances allocates little. Spares
+    are capped so the pool never holds much more than is in use, and are
+    freed entirely once every block is back.
+
+    Only call it off the audio thread (prepareToPlay, releaseResources and
+    constructors/destructors); it takes a lock and may allocate.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+*/
+class DelayMemoryPool
+{
+public:
+    // every block starts on a cache line, and is a whole number of them
+    static constexpr size_t kAlignment = 64;
+
+    // spares kept at most, oldest freed first
+    static constexpr int kMaxSpareBlocks = 8;
+
+    //==============================================================================
+    // a block of floats from the pool, handed back when it is reset, reassigned or destroyed;
+    // the same role as a juce::HeapBlock<float>
+    class Block
+    {
+    public:
+        Block() noexcept;
+        Block(Block&& other) noexcept;
+        Block& operator=(Block&& other) noexcept;
+        ~Block();
+
+        inline operator float*() const noexcept { return mData; }
+        inline float* getData() const noexcept { return mData; }
+
+        // the block's size, a multiple of kAlignment, 0 when empty
+        size_t getNumBytes() const noexcept { return mNumBytes; }
+
+        // hand the memory back to the pool and leave the block empty
+        void reset();
+
+        void swapWith(Block& other) noexcept;
+
+    private:
+        friend class DelayMemoryPool;
+
+        DelayMemoryPool* mPool;
+        float* mData;
+        size_t mNumBytes;
+
+        JUCE_DECLARE_NON_COPYABLE (Block)
+    };
+
+    //==============================================================================
+    DelayMemoryPool();
+    ~DelayMemoryPool();
+
+    // at least numFloats floats, aligned to kAlignment; the contents are undefined
+    Block allocate(size_t numFloats);
+
+    // bytes in blocks handed out, and in spares waiting to be reused
+    size_t getBytesInUse() const;
+    size_t getBytesSpare() const;
+
+private:
+
+    void release(float* data, size_t numBytes);
+    void trimSpares();
+
+    static float* allocateAligned(size_t numBytes);
+    static void freeAligned(float* data);
+
+    struct SpareBlock
+    {
+        float* data;
+        size_t numBytes;
+    };
+
+    juce::CriticalSection mLock;
+    juce::Array<SpareBlock> mSpareBlocks;
+
+    size_t mBytesInUse;
+    size_t mBytesSpare;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayMemoryPool)
+};
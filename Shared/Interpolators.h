@@ -0,0 +1,221 @@
+/*
+  ==============================================================================
+
+    Interpolators.h
+
+    Fractional-delay interpolators that read a whole block of delay times out
+    of a delay line at once. Each one first gathers its taps into small
+    per-tap arrays, then does the arithmetic in a separate pass over those
+    arrays. That pass has no indexing or wrapping in it, so the compiler can
+    vectorize it.
+
+    A block read is only valid while none of its reads reach a sample that is
+    written during the same block, so callers split their blocks into runs of
+    at most (shortest delay - kNumTapsAhead) samples.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// where one channel of a delay line lives: sample n of the channel is data[stride * n], for
+// n in [0, mask + 1 + the line's guard samples)
+struct DelayTapRow
+{
+    const float* data;
+    int stride;
+    int mask;
+};
+
+enum class InterpolationType
+{
+    linear,
+    hermite,
+    lagrange4,
+    lagrange6,
+    allpass
+};
+
+namespace Interpolators
+{
+    // how many positions are gathered before the arithmetic pass runs
+    static constexpr int kGatherSize = 64;
+
+    // Every interpolator reads out[i] at delays[i] samples behind writeHead + i, which is where
+    // the write head is when sample i is processed. For a delay d, x0 is the sample
+    // (int)d + 1 samples back, x1 the one after it, and t = 1 - (d - (int)d) is how far the
+    // read sits from x0 towards x1, in (0, 1].
+    //
+    // kNumTapsBehind taps older than x0 are read, and kNumTapsAhead taps newer than x1.
+
+    //==============================================================================
+    struct Linear
+    {
+        static constexpr int kNumTapsBehind = 0;
+        static constexpr int kNumTapsAhead = 0;
+
+        static void process(const DelayTapRow& row, int writeHead, const float* delays, float* out, int numSamples, float& /*state*/)
+        {
+            for (int i = 0; i < numSamples; i++)
+            {
+                const int delayWhole = (int)delays[i];
+                const float delayFraction = delays[i] - delayWhole;
+
+                const float* x = row.data + row.stride * ((writeHead + i - delayWhole - 1) & row.mask);
+                const float fraction = 1.0f - delayFraction;
+
+                out[i] = x[0] + fraction * (x[row.stride] - x[0]);
+            }
+        }
+    };
+
+    //==============================================================================
+    // gathers NumTaps consecutive samples from kNumTapsBehind before x0, and t, for a run of
+    // up to kGatherSize positions
+    template <int NumTapsBehind, int NumTaps>
+    inline void gather(const DelayTapRow& row, int writeHead, const float* delays, int numSamples,
+                       float (&taps)[NumTaps][kGatherSize], float (&t)[kGatherSize])
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            const int delayWhole = (int)delays[i];
+            const float* x = row.data + row.stride * ((writeHead + i - delayWhole - 1 - NumTapsBehind) & row.mask);
+
+            for (int tap = 0; tap < NumTaps; tap++) {
+                taps[tap][i] = x[tap * row.stride];
+            }
+
+            t[i] = 1.0f - (delays[i] - delayWhole);
+        }
+    }
+
+    //==============================================================================
+    // 4-point, 3rd-order Hermite (Catmull-Rom)
+    struct Hermite
+    {
+        static constexpr int kNumTapsBehind = 1;
+        static constexpr int kNumTapsAhead = 1;
+
+        static void process(const DelayTapRow& row, int writeHead, const float* delays, float* out, int numSamples, float& /*state*/)
+        {
+            float taps[4][kGatherSize];
+            float t[kGatherSize];
+
+            for (int start = 0; start < numSamples; start += kGatherSize)
+            {
+                const int count = juce::jmin(kGatherSize, numSamples - start);
+                gather<kNumTapsBehind>(row, writeHead + start, delays + start, count, taps, t);
+
+                for (int i = 0; i < count; i++)
+                {
+                    const float xm1 = taps[0][i];
+                    const float x0 = taps[1][i];
+                    const float x1 = taps[2][i];
+                    const float x2 = taps[3][i];
+
+                    const float c1 = 0.5f * (x1 - xm1);
+                    const float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+                    const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+
+                    out[start + i] = ((c3 * t[i] + c2) * t[i] + c1) * t[i] + x0;
+                }
+            }
+        }
+    };
+
+    //==============================================================================
+    // NumPoints-point Lagrange, the taps sitting at -(NumPoints / 2 - 1) ... NumPoints / 2 around x0
+    template <int NumPoints>
+    struct Lagrange
+    {
+        static constexpr int kNumTapsBehind = NumPoints / 2 - 1;
+        static constexpr int kNumTapsAhead = NumPoints / 2 - 1;
+
+        static void process(const DelayTapRow& row, int writeHead, const float* delays, float* out, int numSamples, float& /*state*/)
+        {
+            float taps[NumPoints][kGatherSize];
+            float t[kGatherSize];
+
+            // the denominators of the weights only depend on the tap
+            float inverseDenominator[NumPoints];
+
+            for (int k = 0; k < NumPoints; k++)
+            {
+                float denominator = 1;
+
+                for (int j = 0; j < NumPoints; j++) {
+                    if (j != k) {
+                        denominator *= (float)(k - j);
+                    }
+                }
+
+                inverseDenominator[k] = 1.0f / denominator;
+            }
+
+            for (int start = 0; start < numSamples; start += kGatherSize)
+            {
+                const int count = juce::jmin(kGatherSize, numSamples - start);
+                gather<kNumTapsBehind>(row, writeHead + start, delays + start, count, taps, t);
+
+                for (int i = 0; i < count; i++)
+                {
+                    // with x the position relative to x0, tap k sits at k - kNumTapsBehind
+                    const float x = t[i] + kNumTapsBehind;
+                    float sum = 0;
+
+                    for (int k = 0; k < NumPoints; k++)
+                    {
+                        float weight = inverseDenominator[k];
+
+                        for (int j = 0; j < NumPoints; j++) {
+                            if (j != k) {
+                                weight *= x - j;
+                            }
+                        }
+
+                        sum += weight * taps[k][i];
+                    }
+
+                    out[start + i] = sum;
+                }
+            }
+        }
+    };
+
+    //==============================================================================
+    // first-order allpass, keeping the fractional part in [0.5, 1.5) so the coefficient stays in
+    // (-1/5, 1/3] and the filter well damped; state is the previous output, kept per read
+    struct Allpass
+    {
+        static constexpr int kNumTapsBehind = 0;
+        static constexpr int kNumTapsAhead = 1;
+
+        static void process(const DelayTapRow& row, int writeHead, const float* delays, float* out, int numSamples, float& state)
+        {
+            float previous = state;
+
+            for (int i = 0; i < numSamples; i++)
+            {
+                const int delayWhole = (int)(delays[i] - 0.5f);
+                const float delayFraction = delays[i] - delayWhole;
+                const float coefficient = (1.0f - delayFraction) / (1.0f + delayFraction);
+
+                // older is delayWhole + 1 samples back, newer delayWhole samples back
+                const float* x = row.data + row.stride * ((writeHead + i - delayWhole - 1) & row.mask);
+                const float older = x[0];
+                const float newer = x[row.stride];
+
+                previous = coefficient * (newer - previous) + older;
+                out[i] = previous;
+            }
+
+            state = previous;
+        }
+    };
+
+    typedef Lagrange<4> Lagrange4;
+    typedef Lagrange<6> Lagrange6;
+}
@@ -0,0 +1,258 @@
+/*
+  ==============================================================================
+
+    LFO.cpp
+
+  ==============================================================================
+*/
+
+#include "LFO.h"
+
+namespace
+{
+    // one cycle of sine plus a wrap-around point, so lookups never need to wrap the upper index
+    struct SineTable
+    {
+        static constexpr int kSize = 2048;
+
+        SineTable()
+        {
+            for (int i = 0; i <= kSize; i++) {
+                values[i] = (float)std::sin(juce::MathConstants<double>::twoPi * i / kSize);
+            }
+        }
+
+        float values[kSize + 1];
+    };
+
+    // built on first use and shared, read-only, by every instance in the process
+    const SineTable& getSineTable()
+    {
+        static const SineTable table;
+        return table;
+    }
+
+    // phase must be in [0, 1)
+    inline float lookupSine(const float* table, float phase)
+    {
+        const float position = phase * SineTable::kSize;
+        const int index = (int)position;
+        const float fraction = position - index;
+
+        return table[index] + fraction * (table[index + 1] - table[index]);
+    }
+
+    // wraps a non-negative phase back into [0, 1)
+    inline float wrapPhase(float phase)
+    {
+        return phase - (int)phase;
+    }
+}
+
+LFO::LFO()
+{
+    mBackend = Backend::wavetable;
+    mPhase = 0;
+    mInverseSampleRate = 0;
+}
+
+void LFO::prepare(double sampleRate)
+{
+    mInverseSampleRate = (float)(1.0 / sampleRate);
+
+    // make sure the table isn't built on the audio thread
+    getSineTable();
+}
+
+void LFO::reset(float phase)
+{
+    mPhase = wrapPhase(phase);
+}
+
+void LFO::process(const float* rate, const float* phaseOffset, const float* offsetScale,
+                  float* const* outputs, int numOutputs, int numSamples)
+{
+    if (numSamples <= 0) {
+        return;
+    }
+
+    // every output runs the same phase sequence from the same start, so they are rendered one
+    // after the other, and the phase is only moved on afterwards
+    const float startPhase = mPhase;
+    float endPhase = startPhase;
+
+    for (int output = 0; output < numOutputs; output++)
+    {
+        mPhase = startPhase;
+
+        if (mBackend == Backend::wavetable) {
+            processWavetable(rate, phaseOffset, offsetScale[output], outputs[output], numSamples);
+        } else {
+            processQuadrature(rate, phaseOffset, offsetScale[output], outputs[output], numSamples);
+        }
+
+        endPhase = mPhase;
+    }
+
+    mPhase = endPhase;
+}
+
+void LFO::process(const float* rate, const float* phaseOffset, float* out, float* offsetOut, int numSamples)
+{
+    static const float stereoOffsetScale[] = { 0.0f, 1.0f };
+    float* outputs[] = { out, offsetOut };
+
+    process(rate, phaseOffset, stereoOffsetScale, outputs, 2, numSamples);
+}
+
+int LFO::processDecimated(const float* rate, const float* phaseOffset, const float* offsetScale,
+                          float* const* outputs, int numOutputs, int numSamples, int interval)
+{
+    // so few values are needed that both backends just read the table here
+    const float* table = getSineTable().values;
+    float phase = mPhase;
+    int numValues = 0;
+
+    for (int start = 0; start < numSamples; start += interval)
+    {
+        const int last = juce::jmin(start + interval, numSamples) - 1;
+
+        // advance to the segment's last sample by the trapezoid over the segment's rates: exact for
+        // a linear ramp, and for the rate's exponential ramp a slight overestimate that the phase
+        // keeps, so the control-rate lfo ends up a hair ahead of the sample-accurate one each time
+        // the rate moves
+        if (last > start) {
+            phase = wrapPhase(phase + (last - start) * (rate[start] + rate[last - 1]) * 0.5f * mInverseSampleRate);
+        }
+
+        for (int output = 0; output < numOutputs; output++) {
+            outputs[output][numValues] = lookupSine(table, wrapPhase(phase + phaseOffset[last] * offsetScale[output]));
+        }
+
+        numValues++;
+
+        // and on to the first sample of the next segment
+        phase = wrapPhase(phase + rate[last] * mInverseSampleRate);
+    }
+
+    mPhase = phase;
+    return numValues;
+}
+
+int LFO::processDecimated(const float* rate, const float* phaseOffset, float* out, float* offsetOut, int numSamples, int interval)
+{
+    static const float stereoOffsetScale[] = { 0.0f, 1.0f };
+    float* outputs[] = { out, offsetOut };
+
+    return processDecimated(rate, phaseOffset, stereoOffsetScale, outputs, 2, numSamples, interval);
+}
+
+void LFO::advance(const float* rate, int numSamples)
+{
+    float rateSum = 0;
+
+    for (int sample = 0; sample < numSamples; sample++) {
+        rateSum += rate[sample];
+    }
+
+    mPhase = wrapPhase(mPhase + rateSum * mInverseSampleRate);
+}
+
+void LFO::processPhase(const float* rate, float* phases, int numSamples)
+{
+    float phase = mPhase;
+
+    for (int sample = 0; sample < numSamples; sample++)
+    {
+        phases[sample] = phase;
+        phase = wrapPhase(phase + rate[sample] * mInverseSampleRate);
+    }
+
+    mPhase = phase;
+}
+
+void LFO::processWavetable(const float* rate, const float* phaseOffset, float offsetScale, float* out, int numSamples)
+{
+    const float* table = getSineTable().values;
+    float phase = mPhase;
+
+    for (int sample = 0; sample < numSamples; sample++)
+    {
+        // the offset outputs read the same table, no second oscillator needed
+        out[sample] = lookupSine(table, wrapPhase(phase + phaseOffset[sample] * offsetScale));
+
+        phase = wrapPhase(phase + rate[sample] * mInverseSampleRate);
+    }
+
+    mPhase = phase;
+}
+
+void LFO::processQuadrature(const float* rate, const float* phaseOffset, float offsetScale, float* out, int numSamples)
+{
+    const double twoPi = juce::MathConstants<double>::twoPi;
+
+    // the phase offset ramps linearly across a block, so it changes by a fixed angle per sample,
+    // which is itself just a rotation
+    const double lastSample = juce::jmax(1, numSamples - 1);
+    const double firstOffset = phaseOffset[0] * (double)offsetScale;
+    const double offsetChange = (phaseOffset[numSamples - 1] - phaseOffset[0]) * (double)offsetScale / lastSample;
+
+    double offsetCosine = std::cos(twoPi * firstOffset);
+    double offsetSine = std::sin(twoPi * firstOffset);
+    const double offsetStepCosine = std::cos(twoPi * offsetChange);
+    const double offsetStepSine = std::sin(twoPi * offsetChange);
+
+    // the recursion can only change its phase step by a fixed angle per sample, a linear chirp, and
+    // the rate ramp is exponential. A steady rate is a single rotation for the whole block; a moving
+    // one is followed in short segments, each a chirp from the segment's first rate fitted to the
+    // phase its rates really reach, so the recursion stays within a segment of the exact ramp
+    const int segmentLength = rate[0] == rate[numSamples - 1] ? numSamples : kChirpSegmentLength;
+    double phase = mPhase;
+
+    for (int start = 0; start < numSamples; start += segmentLength)
+    {
+        const int length = juce::jmin(segmentLength, numSamples - start);
+        double phaseAdvance = 0;
+
+        for (int sample = start; sample < start + length; sample++) {
+            phaseAdvance += rate[sample];
+        }
+
+        phaseAdvance *= mInverseSampleRate;
+
+        const double firstIncrement = rate[start] * (double)mInverseSampleRate;
+        const double incrementChange = length > 1 ? (phaseAdvance - length * firstIncrement) / (0.5 * length * (length - 1)) : 0.0;
+
+        // reseeding from the tracked phase every segment keeps the recursion from drifting
+        double cosine = std::cos(twoPi * phase);
+        double sine = std::sin(twoPi * phase);
+
+        double stepCosine = std::cos(twoPi * firstIncrement);
+        double stepSine = std::sin(twoPi * firstIncrement);
+        const double chirpCosine = std::cos(twoPi * incrementChange);
+        const double chirpSine = std::sin(twoPi * incrementChange);
+
+        for (int sample = start; sample < start + length; sample++)
+        {
+            // sin(a + b) = sin(a) cos(b) + cos(a) sin(b), so the offset comes from the same state
+            out[sample] = (float)(sine * offsetCosine + cosine * offsetSine);
+
+            const double nextCosine = cosine * stepCosine - sine * stepSine;
+            sine = sine * stepCosine + cosine * stepSine;
+            cosine = nextCosine;
+
+            const double nextStepCosine = stepCosine * chirpCosine - stepSine * chirpSine;
+            stepSine = stepSine * chirpCosine + stepCosine * chirpSine;
+            stepCosine = nextStepCosine;
+
+            const double nextOffsetCosine = offsetCosine * offsetStepCosine - offsetSine * offsetStepSine;
+            offsetSine = offsetSine * offsetStepCosine + offsetCosine * offsetStepSine;
+            offsetCosine = nextOffsetCosine;
+        }
+
+        phase += phaseAdvance;
+        phase -= std::floor(phase);
+    }
+
+    mPhase = wrapPhase((float)phase);
+}
@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    LFO.h
+
+    Block-based sine LFO with any number of outputs, each shifted by its own
+    share of a phase offset (the stereo case is the LFO itself for the left
+    channel and the fully offset copy for the right). Neither backend calls a
+    transcendental function per sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+*/
+class LFO
+{
+public:
+    enum class Backend
+    {
+        wavetable,     // linear interpolation into a shared, read-only sine table
+        quadrature     // recursive rotation of a (cos, sin) pair, reseeded every block (every
+                       // kChirpSegmentLength samples while the rate moves)
+    };
+
+    LFO();
+
+    void setBackend(Backend backend) { mBackend = backend; }
+    Backend getBackend() const { return mBackend; }
+
+    void prepare(double sampleRate);
+
+    // phase is in cycles, [0, 1)
+    void reset(float phase = 0);
+    float getPhase() const { return mPhase; }
+
+    // fills numSamples values of sin(2 pi (phase + phaseOffset * offsetScale[i])) into each of the
+    // numOutputs outputs, advancing the phase by rate / sampleRate after every sample
+    void process(const float* rate, const float* phaseOffset, const float* offsetScale,
+                 float* const* outputs, int numOutputs, int numSamples);
+
+    // the stereo case: sin(2 pi phase) into out, and sin(2 pi (phase + phaseOffset)) into offsetOut
+    void process(const float* rate, const float* phaseOffset, float* out, float* offsetOut, int numSamples);
+
+    // control-rate version of process(): splits the block into interval-long segments (the last
+    // one may be shorter) and writes one value per segment and output, taken at the segment's
+    // last sample. Returns the number of segments.
+    int processDecimated(const float* rate, const float* phaseOffset, const float* offsetScale,
+                         float* const* outputs, int numOutputs, int numSamples, int interval);
+
+    int processDecimated(const float* rate, const float* phaseOffset, float* out, float* offsetOut, int numSamples, int interval);
+
+    // moves the phase on as process() would, without computing any output
+    void advance(const float* rate, int numSamples);
+
+    // moves the phase on as process() would, writing the phase (in cycles, [0, 1)) each sample
+    // is at, for callers that evaluate the sine themselves
+    void processPhase(const float* rate, float* phases, int numSamples);
+
+private:
+
+    // how many samples the quadrature backend runs on one chirp while the rate is moving
+    static constexpr int kChirpSegmentLength = 32;
+
+    void processWavetable(const float* rate, const float* phaseOffset, float offsetScale, float* out, int numSamples);
+    void processQuadrature(const float* rate, const float* phaseOffset, float offsetScale, float* out, int numSamples);
+
+    Backend mBackend;
+
+    float mPhase;
+    float mInverseSampleRate;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LFO)
+};
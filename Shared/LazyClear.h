@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    LazyClear.h
+
+    Lazy zero-fill for the delay lines. Clearing a line only rewinds it and
+    resets a watermark of how many samples have been written since; nothing
+    is zeroed up front. Before each block the line is told which delays the
+    block will read, and zeroes just the part of that range it has not
+    written yet. A steady delay zeroes about one block per block, and once
+    the write head has gone all the way round the check is one compare.
+
+    Until then the unwritten samples sit at the top of the buffer, where the
+    reads wrap to, and the zeroed part of them is kept as one range, so a
+    sample is never zeroed twice and a written sample is never zeroed.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+*/
+class LazyClear
+{
+public:
+    // how far reads reach past their delay on either side (the widest interpolator's taps)
+    static constexpr int kNumReachSamples = 4;
+
+    LazyClear()
+    {
+        mNumWrittenSamples = 0;
+        mZeroedBegin = 0;
+        mZeroedEnd = 0;
+    }
+
+    // nothing written yet, every read must go through ensureReadable()
+    void reset()
+    {
+        mNumWrittenSamples = 0;
+        mZeroedBegin = 0;
+        mZeroedEnd = 0;
+    }
+
+    // the whole buffer holds valid samples (zeroed eagerly, say)
+    void setFull(int capacity)
+    {
+        mNumWrittenSamples = capacity;
+    }
+
+    inline void advance(int numSamples)
+    {
+        mNumWrittenSamples += numSamples;
+    }
+
+    inline bool isFull(int capacity) const
+    {
+        return mNumWrittenSamples >= capacity;
+    }
+
+    // zeroes whatever the reads of the next numSamples samples, at delays between minDelay and
+    // maxDelay, could find unwritten; zeroRange(begin, end) clears buffer positions [begin, end)
+    template <typename ZeroRange>
+    void ensureReadable(int capacity, int writeHead, float minDelay, float maxDelay, int numSamples, ZeroRange zeroRange)
+    {
+        if (isFull(capacity)) {
+            return;
+        }
+
+        // in the first lap a read d samples behind the head lands at head - d, and below zero it wraps
+        // to the top of the buffer, which is only written later; everything from the head up is unwritten
+        const int begin = juce::jmax(writeHead, capacity + writeHead - ((int)maxDelay + 1 + kNumReachSamples));
+        const int end = juce::jmin(capacity, capacity + writeHead + numSamples - juce::jmax(0, (int)minDelay - kNumReachSamples));
+
+        if (begin >= end) {
+            return;
+        }
+
+        if (mZeroedBegin >= mZeroedEnd) {
+            zeroRange(begin, end);
+            mZeroedBegin = begin;
+            mZeroedEnd = end;
+            return;
+        }
+
+        // grow the zeroed range to cover the reads, filling any gap between the two as well
+        if (begin < mZeroedBegin) {
+            zeroRange(begin, mZeroedBegin);
+            mZeroedBegin = begin;
+        }
+
+        if (end > mZeroedEnd) {
+            zeroRange(juce::jmax(mZeroedEnd, writeHead), end);
+            mZeroedEnd = end;
+        }
+    }
+
+private:
+
+    juce::int64 mNumWrittenSamples;
+
+    // the part of the unwritten top of the buffer that has been zeroed
+    int mZeroedBegin;
+    int mZeroedEnd;
+};
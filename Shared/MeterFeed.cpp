@@ -0,0 +1,158 @@
+/*
+  ==============================================================================
+
+    MeterFeed.cpp
+
+  ==============================================================================
+*/
+
+#include "MeterFeed.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#elif JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
+static_assert((MeterFeed::kCapacity & (MeterFeed::kCapacity - 1)) == 0, "the ring wraps with a mask");
+
+namespace
+{
+    // the peak and the sum of squares of one channel of a block, in four interleaved lanes so the
+    // maximum and the sum aren't one long chain of dependent adds
+    void measure(const float* samples, int numSamples, float& peak, float& sumOfSquares)
+    {
+        float peaks[4] = { 0, 0, 0, 0 };
+        float sums[4] = { 0, 0, 0, 0 };
+        int sample = 0;
+
+        // eight samples at a time, in two vectors of lanes
+       #if JUCE_USE_SSE_INTRINSICS
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        __m128 peak0 = _mm_setzero_ps(), peak1 = _mm_setzero_ps(), sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+
+        for (; sample + 8 <= numSamples; sample += 8)
+        {
+            const __m128 x0 = _mm_loadu_ps(samples + sample);
+            const __m128 x1 = _mm_loadu_ps(samples + sample + 4);
+
+            peak0 = _mm_max_ps(peak0, _mm_and_ps(x0, absMask));
+            peak1 = _mm_max_ps(peak1, _mm_and_ps(x1, absMask));
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(x0, x0));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(x1, x1));
+        }
+
+        _mm_storeu_ps(peaks, _mm_max_ps(peak0, peak1));
+        _mm_storeu_ps(sums, _mm_add_ps(sum0, sum1));
+       #elif JUCE_USE_ARM_NEON
+        float32x4_t peak0 = vdupq_n_f32(0), peak1 = vdupq_n_f32(0), sum0 = vdupq_n_f32(0), sum1 = vdupq_n_f32(0);
+
+        for (; sample + 8 <= numSamples; sample += 8)
+        {
+            const float32x4_t x0 = vld1q_f32(samples + sample);
+            const float32x4_t x1 = vld1q_f32(samples + sample + 4);
+
+            peak0 = vmaxq_f32(peak0, vabsq_f32(x0));
+            peak1 = vmaxq_f32(peak1, vabsq_f32(x1));
+            sum0 = vaddq_f32(sum0, vmulq_f32(x0, x0));
+            sum1 = vaddq_f32(sum1, vmulq_f32(x1, x1));
+        }
+
+        vst1q_f32(peaks, vmaxq_f32(peak0, peak1));
+        vst1q_f32(sums, vaddq_f32(sum0, sum1));
+       #endif
+
+        // the rest, and everything without SIMD
+        for (; sample + 4 <= numSamples; sample += 4)
+        {
+            for (int lane = 0; lane < 4; lane++) {
+                const float x = samples[sample + lane];
+                peaks[lane] = juce::jmax(peaks[lane], std::abs(x));
+                sums[lane] += x * x;
+            }
+        }
+
+        for (; sample < numSamples; sample++) {
+            peaks[0] = juce::jmax(peaks[0], std::abs(samples[sample]));
+            sums[0] += samples[sample] * samples[sample];
+        }
+
+        peak = juce::jmax(peak, juce::jmax(peaks[0], peaks[1]), juce::jmax(peaks[2], peaks[3]));
+        sumOfSquares += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    }
+}
+
+MeterFeed::MeterFeed()
+{
+    mPending = {};
+    mPendingNumSamples = 0;
+    mSamplesPerFrame = 1;
+
+    mEnabled = false;
+    mActive = false;
+
+    mInverseSampleRate = 0;
+
+    mFrames.allocate(kCapacity, true);
+    mWritePosition = 0;
+    mReadPosition = 0;
+}
+
+void MeterFeed::prepare(double sampleRate)
+{
+    mSamplesPerFrame = juce::jmax(1, juce::roundToInt(sampleRate * kFrameSeconds));
+    mInverseSampleRate = (float)(1.0 / sampleRate);
+    mPendingNumSamples = 0;
+}
+
+void MeterFeed::addInput(const float* const* channels, int numChannels, int numSamples) noexcept
+{
+    // the first block of a frame starts it from nothing
+    if (mPendingNumSamples == 0) {
+        mPending = {};
+    }
+
+    numChannels = juce::jmin(numChannels, kMaxNumChannels);
+    mPending.numChannels = numChannels;
+
+    for (int channel = 0; channel < numChannels; channel++) {
+        measure(channels[channel], numSamples, mPending.inputPeak[channel], mPending.inputMeanSquare[channel]);
+    }
+}
+
+void MeterFeed::addOutput(const float* const* channels, int numChannels, int numSamples, float modulation) noexcept
+{
+    numChannels = juce::jmin(numChannels, kMaxNumChannels);
+
+    for (int channel = 0; channel < numChannels; channel++) {
+        measure(channels[channel], numSamples, mPending.outputPeak[channel], mPending.outputMeanSquare[channel]);
+    }
+
+    mPendingNumSamples += numSamples;
+
+    if (mPendingNumSamples < mSamplesPerFrame) {
+        return;
+    }
+
+    const float inverseNumSamples = 1.0f / mPendingNumSamples;
+
+    for (int channel = 0; channel < numChannels; channel++) {
+        mPending.inputMeanSquare[channel] *= inverseNumSamples;
+        mPending.outputMeanSquare[channel] *= inverseNumSamples;
+    }
+
+    mPending.seconds = mPendingNumSamples * mInverseSampleRate;
+    mPending.modulation = modulation;
+    mPendingNumSamples = 0;
+
+    const juce::uint32 writePosition = mWritePosition.load(std::memory_order_relaxed);
+    const juce::uint32 readPosition = mReadPosition.load(std::memory_order_acquire);
+
+    // full: the editor hasn't caught up, keep what is there
+    if (writePosition - readPosition >= (juce::uint32)kCapacity) {
+        return;
+    }
+
+    mFrames[writePosition & (kCapacity - 1)] = mPending;
+    mWritePosition.store(writePosition + 1, std::memory_order_release);
+}
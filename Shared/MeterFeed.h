@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    MeterFeed.h
+
+    What the editors' meters and scope show, sent from the audio thread.
+    The processor measures every block's input and output, peak and mean
+    square per channel, and sums them into frames about kFrameSeconds long
+    whatever the host's block size. Each frame also carries one reading of
+    the modulation (the lfo, or the delay time) taken at its end. Finished
+    frames go into a preallocated single-producer, single-consumer ring
+    that the editor drains on its timer. A ring the editor hasn't drained
+    in time drops the newest frames.
+
+    Nothing is measured unless an editor has turned the feed on. Off, a
+    block costs a load and a couple of stores.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+*/
+class MeterFeed
+{
+public:
+    // the meters show the first two channels
+    static constexpr int kMaxNumChannels = 2;
+
+    // frames the ring holds, a power of two (over a second's worth)
+    static constexpr int kCapacity = 128;
+
+    // how much audio a frame sums up, at least one block of it
+    static constexpr double kFrameSeconds = 0.01;
+
+    struct Frame
+    {
+        float seconds;
+        int numChannels;
+        float inputPeak[kMaxNumChannels];
+        float inputMeanSquare[kMaxNumChannels];
+        float outputPeak[kMaxNumChannels];
+        float outputMeanSquare[kMaxNumChannels];
+        float modulation;
+    };
+
+    MeterFeed();
+
+    // message thread, from prepareToPlay, while no audio runs
+    void prepare(double sampleRate);
+
+    // the editor's, on while it is open
+    void setEnabled(bool enabled) { mEnabled.store(enabled, std::memory_order_relaxed); }
+
+    // audio thread, at the top of processBlock: decides whether this block is measured
+    void measureInput(const float* const* channels, int numChannels, int numSamples) noexcept
+    {
+        mActive = mEnabled.load(std::memory_order_relaxed);
+
+        if (mActive) {
+            addInput(channels, numChannels, numSamples);
+        } else {
+            mPendingNumSamples = 0;
+        }
+    }
+
+    // whether the block measureInput() was called for is measured, so the processor only works
+    // out the modulation when someone is watching
+    bool isActive() const noexcept { return mActive; }
+
+    // audio thread, at the end of processBlock
+    void measureOutput(const float* const* channels, int numChannels, int numSamples, float modulation) noexcept
+    {
+        if (mActive) {
+            addOutput(channels, numChannels, numSamples, modulation);
+        }
+    }
+
+    // the editor's timer: hands every frame finished since the last call to readFrame, oldest
+    // first, and returns how many there were
+    template <typename ReadFrame>
+    int drain(ReadFrame&& readFrame)
+    {
+        const juce::uint32 readPosition = mReadPosition.load(std::memory_order_relaxed);
+        const juce::uint32 writePosition = mWritePosition.load(std::memory_order_acquire);
+
+        for (juce::uint32 position = readPosition; position != writePosition; position++) {
+            readFrame(mFrames[position & (kCapacity - 1)]);
+        }
+
+        // the slots are free again once the positions say so
+        mReadPosition.store(writePosition, std::memory_order_release);
+
+        return (int)(writePosition - readPosition);
+    }
+
+    // bytes allocated for the ring
+    size_t getMemoryFootprint() const { return (size_t)kCapacity * sizeof(Frame); }
+
+private:
+
+    void addInput(const float* const* channels, int numChannels, int numSamples) noexcept;
+    void addOutput(const float* const* channels, int numChannels, int numSamples, float modulation) noexcept;
+
+    // the frame being summed up, its mean squares still sums until it is pushed
+    Frame mPending;
+    int mPendingNumSamples;
+    int mSamplesPerFrame;
+
+    std::atomic<bool> mEnabled;
+    bool mActive;
+
+    float mInverseSampleRate;
+
+    juce::HeapBlock<Frame> mFrames;
+    std::atomic<juce::uint32> mWritePosition;
+    std::atomic<juce::uint32> mReadPosition;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeterFeed)
+};
@@ -0,0 +1,294 @@
+/*
+  ==============================================================================
+
+    MeterView.cpp
+
+  ==============================================================================
+*/
+
+#include "MeterView.h"
+
+namespace
+{
+    const int kMargin = 8;
+    const int kLabelHeight = 16;
+    const int kBarWidth = 8;
+    const int kBarGap = 2;
+    const int kPairGap = 10;
+    const int kScopeGap = 12;
+
+    // the scale's lines, every 12 dB down from full scale
+    const float kScaleStepDecibels = 12.0f;
+
+    const juce::Colour kTrackColour(0xff111111);
+    const juce::Colour kScaleColour(0xff3a3a3a);
+    const juce::Colour kRmsColour(0xff4caf50);
+    const juce::Colour kPeakColour(0xffe0e0e0);
+    const juce::Colour kTraceColour(0xff29b6f6);
+}
+
+MeterView::MeterView(MeterFeed& feed, const juce::String& modulationName, float minModulation, float maxModulation)
+    : mFeed(feed)
+{
+    mModulationName = modulationName;
+    mMinModulation = minModulation;
+    mMaxModulation = maxModulation;
+
+    for (int bar = 0; bar < kNumBars; bar++) {
+        mPeakDecibels[bar] = kMinDecibels;
+        mRmsDecibels[bar] = kMinDecibels;
+        mPeakHeights[bar] = 0;
+        mRmsHeights[bar] = 0;
+    }
+
+    mPendingColumns = 0;
+    mLastModulation = minModulation;
+
+    // every pixel comes from the cached images
+    setOpaque(true);
+
+    // frames left over from an editor open before are old news
+    mFeed.setEnabled(true);
+    mFeed.drain([](const MeterFeed::Frame&) {});
+
+    startTimerHz(kRefreshRateHz);
+}
+
+MeterView::~MeterView()
+{
+    stopTimer();
+    mFeed.setEnabled(false);
+}
+
+void MeterView::paint(juce::Graphics& g)
+{
+    if (mBackground.isNull()) {
+        g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
+        return;
+    }
+
+    g.drawImageAt(mBackground, 0, 0);
+
+    for (int bar = 0; bar < kNumBars; bar++)
+    {
+        const juce::Rectangle<int>& bounds = mBarBounds[bar];
+
+        g.setColour(kRmsColour);
+        g.fillRect(bounds.withTop(bounds.getBottom() - mRmsHeights[bar]));
+
+        if (mPeakHeights[bar] > 0) {
+            g.setColour(kPeakColour);
+            g.fillRect(bounds.getX(), bounds.getBottom() - mPeakHeights[bar], bounds.getWidth(), 1);
+        }
+    }
+
+    g.drawImageAt(mScope, mScopeBounds.getX(), mScopeBounds.getY());
+}
+
+void MeterView::resized()
+{
+    juce::Rectangle<int> bounds = getLocalBounds().reduced(kMargin);
+
+    if (bounds.getWidth() <= 4 * kBarWidth + 2 * kBarGap + kPairGap + kScopeGap || bounds.getHeight() <= kLabelHeight) {
+        mBackground = juce::Image();
+        mScope = juce::Image();
+        return;
+    }
+
+    juce::Rectangle<int> labels = bounds.removeFromTop(kLabelHeight);
+
+    // the input pair, then the output pair
+    juce::Rectangle<int> meters = bounds.removeFromLeft(4 * kBarWidth + 2 * kBarGap + kPairGap);
+    juce::Rectangle<int> inputs = meters.removeFromLeft(2 * kBarWidth + kBarGap);
+    juce::Rectangle<int> outputs = meters.removeFromRight(2 * kBarWidth + kBarGap);
+
+    for (int channel = 0; channel < MeterFeed::kMaxNumChannels; channel++) {
+        mBarBounds[channel] = inputs.removeFromLeft(kBarWidth);
+        mBarBounds[MeterFeed::kMaxNumChannels + channel] = outputs.removeFromLeft(kBarWidth);
+        inputs.removeFromLeft(kBarGap);
+        outputs.removeFromLeft(kBarGap);
+    }
+
+    bounds.removeFromLeft(kScopeGap);
+    mScopeBounds = bounds;
+
+    // the panel, the bars' tracks and scale, and the labels never change until the next resize
+    mBackground = juce::Image(juce::Image::RGB, getWidth(), getHeight(), true);
+
+    {
+        juce::Graphics g(mBackground);
+        g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
+
+        for (int bar = 0; bar < kNumBars; bar++)
+        {
+            const juce::Rectangle<int>& track = mBarBounds[bar];
+
+            g.setColour(kTrackColour);
+            g.fillRect(track);
+
+            g.setColour(kScaleColour);
+
+            for (float decibels = -kScaleStepDecibels; decibels > kMinDecibels; decibels -= kScaleStepDecibels) {
+                g.drawHorizontalLine(track.getBottom() - getBarHeight(decibels), (float)track.getX(), (float)track.getRight());
+            }
+        }
+
+        g.setColour(juce::Colours::white);
+        g.setFont(12.0f);
+        g.drawText("in", labels.withX(mBarBounds[0].getX()).withWidth(2 * kBarWidth + kBarGap), juce::Justification::centred);
+        g.drawText("out", labels.withX(mBarBounds[MeterFeed::kMaxNumChannels].getX()).withWidth(2 * kBarWidth + kBarGap), juce::Justification::centred);
+        g.drawText(mModulationName, labels.withX(mScopeBounds.getX()).withWidth(mScopeBounds.getWidth()), juce::Justification::centredLeft);
+    }
+
+    // the trace starts over at the new size
+    mScope = juce::Image(juce::Image::RGB, mScopeBounds.getWidth(), mScopeBounds.getHeight(), true);
+
+    {
+        juce::Graphics g(mScope);
+        g.fillAll(kTrackColour);
+    }
+
+    mPendingColumns = 0;
+
+    for (int bar = 0; bar < kNumBars; bar++) {
+        mPeakHeights[bar] = getBarHeight(mPeakDecibels[bar]);
+        mRmsHeights[bar] = getBarHeight(mRmsDecibels[bar]);
+    }
+}
+
+void MeterView::timerCallback()
+{
+    if (mBackground.isNull()) {
+        mFeed.drain([](const MeterFeed::Frame&) {});
+        return;
+    }
+
+    float peaks[kNumBars] = {};
+    float meanSquares[kNumBars] = {};
+    float seconds = 0;
+
+    // the scope's new points, one per frame that moves it on at least a column; a drain hands over
+    // no more frames than the ring holds
+    int numColumns[MeterFeed::kCapacity];
+    float modulation[MeterFeed::kCapacity];
+    int numPoints = 0;
+
+    const double secondsPerColumn = kScopeSeconds / mScopeBounds.getWidth();
+
+    mFeed.drain([&](const MeterFeed::Frame& frame)
+    {
+        for (int bar = 0; bar < kNumBars; bar++)
+        {
+            // a mono bus shows on both bars of its pair
+            const int channel = juce::jmin(bar % MeterFeed::kMaxNumChannels, juce::jmax(0, frame.numChannels - 1));
+            const bool isOutput = bar >= MeterFeed::kMaxNumChannels;
+
+            peaks[bar] = juce::jmax(peaks[bar], isOutput ? frame.outputPeak[channel] : frame.inputPeak[channel]);
+            meanSquares[bar] += frame.seconds * (isOutput ? frame.outputMeanSquare[channel] : frame.inputMeanSquare[channel]);
+        }
+
+        seconds += frame.seconds;
+        mPendingColumns += frame.seconds / secondsPerColumn;
+
+        const int columns = (int)mPendingColumns;
+
+        if (columns > 0 && numPoints < MeterFeed::kCapacity) {
+            mPendingColumns -= columns;
+            numColumns[numPoints] = columns;
+            modulation[numPoints] = frame.modulation;
+            numPoints++;
+        }
+    });
+
+    // the tick's RMS is over everything it drained, however the frames fell
+    if (seconds > 0) {
+        for (int bar = 0; bar < kNumBars; bar++) {
+            meanSquares[bar] /= seconds;
+        }
+    }
+
+    updateBars(peaks, meanSquares);
+    updateScope(numColumns, modulation, numPoints);
+}
+
+void MeterView::updateBars(const float* peaks, const float* meanSquares)
+{
+    const float falloff = kFalloffDecibelsPerSecond / kRefreshRateHz;
+
+    for (int bar = 0; bar < kNumBars; bar++)
+    {
+        const float peak = juce::Decibels::gainToDecibels(peaks[bar], kMinDecibels);
+        const float rms = juce::Decibels::gainToDecibels(std::sqrt(meanSquares[bar]), kMinDecibels);
+
+        mPeakDecibels[bar] = juce::jmax(peak, mPeakDecibels[bar] - falloff, kMinDecibels);
+        mRmsDecibels[bar] = juce::jmax(rms, mRmsDecibels[bar] - falloff, kMinDecibels);
+
+        const int peakHeight = getBarHeight(mPeakDecibels[bar]);
+        const int rmsHeight = getBarHeight(mRmsDecibels[bar]);
+
+        // only a bar that moved by a pixel is painted again
+        if (peakHeight != mPeakHeights[bar] || rmsHeight != mRmsHeights[bar]) {
+            mPeakHeights[bar] = peakHeight;
+            mRmsHeights[bar] = rmsHeight;
+            repaint(mBarBounds[bar]);
+        }
+    }
+}
+
+void MeterView::updateScope(const int* numColumns, const float* modulation, int numPoints)
+{
+    if (numPoints == 0) {
+        return;
+    }
+
+    int totalNumColumns = 0;
+
+    for (int point = 0; point < numPoints; point++) {
+        totalNumColumns += numColumns[point];
+    }
+
+    const int width = mScope.getWidth();
+    const int height = mScope.getHeight();
+    const int shift = juce::jmin(totalNumColumns, width);
+
+    // what is already drawn only moves, and the trace is drawn on through the columns it frees
+    mScope.moveImageSection(0, 0, shift, 0, width - shift, height);
+
+    juce::Graphics g(mScope);
+    g.setColour(kTrackColour);
+    g.fillRect(width - shift, 0, shift, height);
+
+    g.setColour(kTraceColour);
+
+    float x = (float)(width - 1 - totalNumColumns);
+    float y = getScopeY(mLastModulation);
+
+    for (int point = 0; point < numPoints; point++)
+    {
+        const float nextX = x + numColumns[point];
+        const float nextY = getScopeY(modulation[point]);
+
+        g.drawLine(x, y, nextX, nextY, 1.5f);
+
+        x = nextX;
+        y = nextY;
+    }
+
+    mLastModulation = modulation[numPoints - 1];
+
+    repaint(mScopeBounds);
+}
+
+int MeterView::getBarHeight(float decibels) const
+{
+    const int height = mBarBounds[0].getHeight();
+
+    return juce::jlimit(0, height, juce::roundToInt(juce::jmap(decibels, kMinDecibels, 0.0f, 0.0f, (float)height)));
+}
+
+float MeterView::getScopeY(float modulation) const
+{
+    const float bottom = (float)(mScope.getHeight() - 1);
+
+    return juce::jlimit(0.0f, bottom, juce::jmap(modulation, mMinModulation, mMaxModulation, bottom, 0.0f));
+}
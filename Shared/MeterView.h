@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    MeterView.h
+
+    The editors' input/output meters and modulation scope, fed by a
+    processor's MeterFeed. A timer drains the feed kRefreshRateHz times a
+    second; the audio thread never waits on it. Each bar shows the RMS
+    level with its peak as a line above it, on a dB scale, and both fall
+    back at kFalloffDecibelsPerSecond. The scope scrolls the modulation
+    across the last kScopeSeconds.
+
+    Everything that doesn't move (the panel, scale and labels) is drawn
+    into a cached image when the view is resized. The scope is its own
+    image, scrolled by the columns new frames cover with only those drawn
+    fresh. A tick repaints just the bars whose height changed in pixels and
+    the scope if it moved, so a tick's cost is bounded by the ring's size
+    and nothing at all is painted once the audio stops and the bars have
+    fallen.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MeterFeed.h"
+
+//==============================================================================
+/**
+*/
+class MeterView : public juce::Component, private juce::Timer
+{
+public:
+    static constexpr int kRefreshRateHz = 30;
+    static constexpr float kMinDecibels = -60.0f;
+    static constexpr float kFalloffDecibelsPerSecond = 24.0f;
+    static constexpr double kScopeSeconds = 2.0;
+
+    // turns the feed on for as long as the view lives; the scope spans minModulation at the bottom
+    // to maxModulation at the top, and is labelled modulationName
+    MeterView(MeterFeed& feed, const juce::String& modulationName, float minModulation, float maxModulation);
+    ~MeterView() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+
+    // the input channels, then the output channels
+    static constexpr int kNumBars = 2 * MeterFeed::kMaxNumChannels;
+
+    void timerCallback() override;
+
+    // falls the bars back, raises them to this tick's levels and repaints the ones that moved
+    void updateBars(const float* peaks, const float* meanSquares);
+
+    // scrolls the scope left by the columns the points cover and draws the trace through them
+    void updateScope(const int* numColumns, const float* modulation, int numPoints);
+
+    int getBarHeight(float decibels) const;
+    float getScopeY(float modulation) const;
+
+    MeterFeed& mFeed;
+
+    juce::String mModulationName;
+    float mMinModulation;
+    float mMaxModulation;
+
+    juce::Rectangle<int> mBarBounds[kNumBars];
+    juce::Rectangle<int> mScopeBounds;
+
+    // in dB as last drawn, and as pixel heights, so a tick can tell which bars moved
+    float mPeakDecibels[kNumBars];
+    float mRmsDecibels[kNumBars];
+    int mPeakHeights[kNumBars];
+    int mRmsHeights[kNumBars];
+
+    juce::Image mBackground;
+    juce::Image mScope;
+
+    // scope columns the frames so far cover that haven't been scrolled in yet, and where the trace
+    // last ended
+    double mPendingColumns;
+    float mLastModulation;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeterView)
+};
@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    MultiChannelDelayLine.cpp
+
+  ==============================================================================
+*/
+
+#include "MultiChannelDelayLine.h"
+
+MultiChannelDelayLine::MultiChannelDelayLine()
+{
+    mNumChannels = 0;
+    mCapacity = 0;
+    mMask = 0;
+    mWriteHead = 0;
+    mRowSize = 0;
+}
+
+void MultiChannelDelayLine::prepare(int numChannels, int maxDelayInSamples)
+{
+    // the interpolating reads touch one sample beyond the longest delay
+    const int capacity = juce::nextPowerOfTwo(juce::jmax(maxDelayInSamples + 2, kNumGuardSamples));
+    const int rowSize = (capacity + kNumGuardSamples + 15) & ~15;
+
+    if (capacity != mCapacity || numChannels != mNumChannels) {
+        mBuffer = mPool->allocate((size_t) numChannels * rowSize);
+        mNumChannels = numChannels;
+        mCapacity = capacity;
+        mMask = capacity - 1;
+        mRowSize = rowSize;
+    }
+
+    clearLazily();
+}
+
+void MultiChannelDelayLine::clear()
+{
+    juce::zeromem(mBuffer.getData(), getMemoryFootprint());
+    mWriteHead = 0;
+    mLazyClear.setFull(mCapacity);
+}
+
+void MultiChannelDelayLine::clearLazily()
+{
+    mWriteHead = 0;
+    mLazyClear.reset();
+}
+
+void MultiChannelDelayLine::writeBlock(int channel, const float* samples, int numSamples)
+{
+    jassert(numSamples <= mCapacity);
+
+    float* row = mBuffer + (size_t) channel * mRowSize;
+
+    // up to the end of the row, then on from its start
+    const int numSamplesBeforeWrap = juce::jmin(numSamples, mCapacity - mWriteHead);
+    juce::FloatVectorOperations::copy(row + mWriteHead, samples, numSamplesBeforeWrap);
+    juce::FloatVectorOperations::copy(row, samples + numSamplesBeforeWrap, numSamples - numSamplesBeforeWrap);
+
+    // and mirror the guard again if any of it was written
+    if (mWriteHead < kNumGuardSamples || numSamplesBeforeWrap < numSamples) {
+        juce::FloatVectorOperations::copy(row + mCapacity, row, kNumGuardSamples);
+    }
+}
+
+void MultiChannelDelayLine::readBlock(int channel, int delayInSamples, float* destination, int numSamples) const
+{
+    jassert(numSamples <= mCapacity);
+
+    const float* row = mBuffer + (size_t) channel * mRowSize;
+    const int readHead = (mWriteHead - delayInSamples) & mMask;
+
+    const int numSamplesBeforeWrap = juce::jmin(numSamples, mCapacity - readHead);
+    juce::FloatVectorOperations::copy(destination, row + readHead, numSamplesBeforeWrap);
+    juce::FloatVectorOperations::copy(destination + numSamplesBeforeWrap, row, numSamples - numSamplesBeforeWrap);
+}
+
+void MultiChannelDelayLine::swapWith(MultiChannelDelayLine& other) noexcept
+{
+    mBuffer.swapWith(other.mBuffer);
+    std::swap(mNumChannels, other.mNumChannels);
+    std::swap(mCapacity, other.mCapacity);
+    std::swap(mMask, other.mMask);
+    std::swap(mWriteHead, other.mWriteHead);
+    std::swap(mRowSize, other.mRowSize);
+    std::swap(mLazyClear, other.mLazyClear);
+}
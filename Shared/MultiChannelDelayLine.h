@@ -0,0 +1,188 @@
+/*
+  ==============================================================================
+
+    MultiChannelDelayLine.h
+
+    Power-of-two circular delay buffer for any number of channels, stored as
+    one row per channel (structure of arrays) in a single allocation. All
+    channels share one write head. Channels whose reads are linked can be
+    read as a frame, with the position worked out once for every channel.
+    Channels with their own read positions (modulated delays) use a
+    per-channel view, which runs one channel through a whole block at a time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayMemoryPool.h"
+#include "LazyClear.h"
+#include "Interpolators.h"
+
+//==============================================================================
+/**
+*/
+class MultiChannelDelayLine
+{
+public:
+    // how many samples past the end of each row are mirrored from its start
+    static constexpr int kNumGuardSamples = 8;
+
+    //==============================================================================
+    // one channel's row, with its own copy of the write head, so a kernel can run a channel
+    // through a whole block; the same interface as DelayLine. Call
+    // MultiChannelDelayLine::advance(numSamples) once every channel has been through the block.
+    class Channel
+    {
+    public:
+        inline void write(float sample)
+        {
+            mRow[mWriteHead] = sample;
+            mRow[mWriteHead + (mWriteHead < kNumGuardSamples ? mCapacity : 0)] = sample;
+        }
+
+        inline void advance()
+        {
+            mWriteHead = (mWriteHead + 1) & mMask;
+        }
+
+        inline float read(int delayInSamples) const
+        {
+            return mRow[(mWriteHead - delayInSamples) & mMask];
+        }
+
+        // as DelayLine::readLinear()
+        inline float readLinear(float delayInSamples) const
+        {
+            const int delayWhole = (int)delayInSamples;
+            const float delayFraction = delayInSamples - delayWhole;
+
+            const float* x = mRow + ((mWriteHead - delayWhole - 1) & mMask);
+            const float fraction = 1.0f - delayFraction;
+
+            return x[0] + fraction * (x[1] - x[0]);
+        }
+
+        int getCapacity() const { return mCapacity; }
+        int getMask() const { return mMask; }
+        int getWriteHead() const { return mWriteHead; }
+
+        // the row, valid for getCapacity() + kNumGuardSamples samples
+        const float* getData() const { return mRow; }
+
+        DelayTapRow getTapRow() const { return { mRow, 1, mMask }; }
+
+    private:
+        friend class MultiChannelDelayLine;
+
+        float* mRow;
+        int mCapacity;
+        int mMask;
+        int mWriteHead;
+    };
+
+    //==============================================================================
+    MultiChannelDelayLine();
+
+    // make room for numChannels rows of delays up to maxDelayInSamples, reallocating only if the
+    // size changes; this also clears the rows lazily (see ensureReadable()) and rewinds the write head
+    void prepare(int numChannels, int maxDelayInSamples);
+
+    // zero every row and rewind the write head
+    void clear();
+
+    // rewind the write head and forget what was written, without touching the rows
+    void clearLazily();
+
+    // as DelayLine::ensureReadable(), for every row; channel views are covered by the call on the
+    // line they came from
+    inline void ensureReadable(float minDelayInSamples, float maxDelayInSamples, int numSamples)
+    {
+        mLazyClear.ensureReadable(mCapacity, mWriteHead, minDelayInSamples, maxDelayInSamples, numSamples,
+                                  [this] (int begin, int end) {
+                                      for (int channel = 0; channel < mNumChannels; channel++) {
+                                          juce::zeromem(mBuffer + (size_t) channel * mRowSize + begin, (size_t)(end - begin) * sizeof(float));
+                                      }
+                                  });
+    }
+
+    // exchange rows and heads with another line, without allocating (as DelayLine::swapWith())
+    void swapWith(MultiChannelDelayLine& other) noexcept;
+
+    int getNumChannels() const { return mNumChannels; }
+
+    Channel getChannel(int channel) const
+    {
+        Channel view;
+        view.mRow = mBuffer + (size_t) channel * mRowSize;
+        view.mCapacity = mCapacity;
+        view.mMask = mMask;
+        view.mWriteHead = mWriteHead;
+        return view;
+    }
+
+    // store one sample per channel at the write head
+    inline void write(const float* frame)
+    {
+        const int mirror = mWriteHead + (mWriteHead < kNumGuardSamples ? mCapacity : 0);
+        float* row = mBuffer;
+
+        for (int channel = 0; channel < mNumChannels; channel++, row += mRowSize) {
+            row[mWriteHead] = frame[channel];
+            row[mirror] = frame[channel];
+        }
+    }
+
+    // linearly interpolated read of every channel at the same delay, into frame
+    inline void readLinear(float delayInSamples, float* frame) const
+    {
+        const int delayWhole = (int)delayInSamples;
+        const float delayFraction = delayInSamples - delayWhole;
+
+        const float* x = mBuffer + ((mWriteHead - delayWhole - 1) & mMask);
+        const float fraction = 1.0f - delayFraction;
+
+        for (int channel = 0; channel < mNumChannels; channel++, x += mRowSize) {
+            frame[channel] = x[0] + fraction * (x[1] - x[0]);
+        }
+    }
+
+    // store numSamples samples of one channel from the write head on; advance(numSamples) once
+    // every channel has been written
+    void writeBlock(int channel, const float* samples, int numSamples);
+
+    // copy numSamples samples of one channel, starting delayInSamples before the write head; with
+    // a block just written, delays shorter than the block read into it
+    void readBlock(int channel, int delayInSamples, float* destination, int numSamples) const;
+
+    inline void advance(int numSamples = 1)
+    {
+        mWriteHead = (mWriteHead + numSamples) & mMask;
+        mLazyClear.advance(numSamples);
+    }
+
+    int getCapacity() const { return mCapacity; }
+    int getWriteHead() const { return mWriteHead; }
+
+    // bytes allocated for all the rows, including the guard samples and row padding
+    size_t getMemoryFootprint() const { return mBuffer.getNumBytes(); }
+
+private:
+
+    // the pool goes first, so it outlives the block
+    juce::SharedResourcePointer<DelayMemoryPool> mPool;
+    DelayMemoryPool::Block mBuffer;
+
+    int mNumChannels;
+    int mCapacity;
+    int mMask;
+    int mWriteHead;
+
+    LazyClear mLazyClear;
+
+    // capacity + guard, rounded up so every row starts on a 64-byte boundary
+    int mRowSize;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultiChannelDelayLine)
+};
@@ -0,0 +1,300 @@
+/*
+  ==============================================================================
+
+    Oversampler.cpp
+
+  ==============================================================================
+*/
+
+#include "Oversampler.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#elif JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
+namespace
+{
+    struct StageDesign
+    {
+        int halfLength;
+        int padding;
+    };
+
+    // 63 and 23 taps; the second stage's latency is 11 samples at 2x, the padding makes it 6 at 1x
+    const StageDesign kStageDesigns[Oversampler::kMaxNumStages] = { { 15, 0 }, { 5, 1 } };
+
+    // both stages trade the same 80 dB of stopband for their transition width
+    const double kKaiserBeta = 8.0;
+
+    // the zeroth order modified Bessel function of the first kind, for the Kaiser window
+    double besselI0(double x)
+    {
+        double sum = 1;
+        double term = 1;
+
+        for (int k = 1; k < 50 && term > 1.0e-12 * sum; k++) {
+            term *= (x * x) / (4.0 * k * k);
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    // the nonzero taps either side of the centre of a Kaiser-windowed half-band lowpass with
+    // 4 * halfLength + 3 taps (the even ones), scaled to add up to 0.5 so the centre tap's 0.5
+    // makes the DC gain exactly 1
+    void designBranch(int halfLength, float* branch)
+    {
+        const int numTaps = 4 * halfLength + 3;
+        const int centre = (numTaps - 1) / 2;
+        const int numBranchTaps = 2 * halfLength + 2;
+
+        double sum = 0;
+
+        for (int m = 0; m < numBranchTaps; m++)
+        {
+            const double distance = 2 * m - centre;
+            const double sinc = std::sin(juce::MathConstants<double>::halfPi * distance) / (juce::MathConstants<double>::pi * distance);
+            const double x = distance / centre;
+            const double window = besselI0(kKaiserBeta * std::sqrt(1 - x * x)) / besselI0(kKaiserBeta);
+
+            branch[m] = (float)(sinc * window);
+            sum += branch[m];
+        }
+
+        for (int m = 0; m < numBranchTaps; m++) {
+            branch[m] = (float)(branch[m] * 0.5 / sum);
+        }
+    }
+
+    // output[i] = the sum of coefficients[m] * x[i + numTaps - 1 - m] over the taps; the branch is
+    // symmetric with an even number of taps, so each pair the same distance from its centre shares
+    // one multiply
+    void processBranch(const float* x, const float* coefficients, int numTaps, float* output, int numSamples)
+    {
+        const int numPairs = numTaps / 2;
+        int i = 0;
+
+        // sixteen outputs at a time, in four vector accumulators that stay in registers over the taps
+       #if JUCE_USE_SSE_INTRINSICS
+        for (; i + 16 <= numSamples; i += 16)
+        {
+            __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps(), sum2 = _mm_setzero_ps(), sum3 = _mm_setzero_ps();
+
+            for (int m = 0; m < numPairs; m++)
+            {
+                const float* late = x + i + numTaps - 1 - m;
+                const float* early = x + i + m;
+                const __m128 coefficient = _mm_set1_ps(coefficients[m]);
+
+                sum0 = _mm_add_ps(sum0, _mm_mul_ps(coefficient, _mm_add_ps(_mm_loadu_ps(late), _mm_loadu_ps(early))));
+                sum1 = _mm_add_ps(sum1, _mm_mul_ps(coefficient, _mm_add_ps(_mm_loadu_ps(late + 4), _mm_loadu_ps(early + 4))));
+                sum2 = _mm_add_ps(sum2, _mm_mul_ps(coefficient, _mm_add_ps(_mm_loadu_ps(late + 8), _mm_loadu_ps(early + 8))));
+                sum3 = _mm_add_ps(sum3, _mm_mul_ps(coefficient, _mm_add_ps(_mm_loadu_ps(late + 12), _mm_loadu_ps(early + 12))));
+            }
+
+            _mm_storeu_ps(output + i, sum0);
+            _mm_storeu_ps(output + i + 4, sum1);
+            _mm_storeu_ps(output + i + 8, sum2);
+            _mm_storeu_ps(output + i + 12, sum3);
+        }
+       #elif JUCE_USE_ARM_NEON
+        for (; i + 16 <= numSamples; i += 16)
+        {
+            float32x4_t sum0 = vdupq_n_f32(0), sum1 = vdupq_n_f32(0), sum2 = vdupq_n_f32(0), sum3 = vdupq_n_f32(0);
+
+            for (int m = 0; m < numPairs; m++)
+            {
+                const float* late = x + i + numTaps - 1 - m;
+                const float* early = x + i + m;
+                const float coefficient = coefficients[m];
+
+                sum0 = vaddq_f32(sum0, vmulq_n_f32(vaddq_f32(vld1q_f32(late), vld1q_f32(early)), coefficient));
+                sum1 = vaddq_f32(sum1, vmulq_n_f32(vaddq_f32(vld1q_f32(late + 4), vld1q_f32(early + 4)), coefficient));
+                sum2 = vaddq_f32(sum2, vmulq_n_f32(vaddq_f32(vld1q_f32(late + 8), vld1q_f32(early + 8)), coefficient));
+                sum3 = vaddq_f32(sum3, vmulq_n_f32(vaddq_f32(vld1q_f32(late + 12), vld1q_f32(early + 12)), coefficient));
+            }
+
+            vst1q_f32(output + i, sum0);
+            vst1q_f32(output + i + 4, sum1);
+            vst1q_f32(output + i + 8, sum2);
+            vst1q_f32(output + i + 12, sum3);
+        }
+       #endif
+
+        // the rest, and everything without SIMD, in the same order
+        for (; i < numSamples; i++)
+        {
+            float sum = 0;
+
+            for (int m = 0; m < numPairs; m++) {
+                sum += coefficients[m] * (x[i + numTaps - 1 - m] + x[i + m]);
+            }
+
+            output[i] = sum;
+        }
+    }
+}
+
+Oversampler::Oversampler()
+{
+    for (int s = 0; s < kMaxNumStages; s++)
+    {
+        Stage& stage = mStages[s];
+
+        stage.halfLength = kStageDesigns[s].halfLength;
+        stage.numBranchTaps = 2 * stage.halfLength + 2;
+        stage.padding = kStageDesigns[s].padding;
+        stage.inputStride = 0;
+
+        jassert(stage.numBranchTaps <= kMaxNumBranchTaps);
+        designBranch(stage.halfLength, stage.downCoefficients);
+
+        for (int m = 0; m < stage.numBranchTaps; m++) {
+            stage.upCoefficients[m] = 2 * stage.downCoefficients[m];
+        }
+    }
+
+    mNumChannels = 0;
+    mMaxNumSamples = 0;
+}
+
+void Oversampler::prepare(int numChannels, int maxNumSamples)
+{
+    mNumChannels = numChannels;
+    mMaxNumSamples = maxNumSamples;
+
+    // every stage's lower rate is at most half the oversampled rate
+    const int maxNumInputSamples = (maxNumSamples + 1) / 2;
+
+    for (auto& stage : mStages)
+    {
+        stage.inputStride = stage.numBranchTaps + stage.padding + maxNumInputSamples;
+
+        stage.upInput.allocate(numChannels * stage.inputStride, true);
+        stage.evenInput.allocate(numChannels * stage.inputStride, true);
+        stage.oddInput.allocate(numChannels * stage.inputStride, true);
+        stage.output.setSize(numChannels, maxNumSamples);
+    }
+
+    mBranchOutput.allocate(maxNumInputSamples, true);
+}
+
+void Oversampler::reset()
+{
+    for (auto& stage : mStages)
+    {
+        juce::FloatVectorOperations::clear(stage.upInput, mNumChannels * stage.inputStride);
+        juce::FloatVectorOperations::clear(stage.evenInput, mNumChannels * stage.inputStride);
+        juce::FloatVectorOperations::clear(stage.oddInput, mNumChannels * stage.inputStride);
+    }
+}
+
+int Oversampler::getLatencyInSamples(int numStages)
+{
+    int latency = 0;
+
+    // a stage delays by its filter's centre on the way up and down, the whole filter's length less
+    // one at the higher rate, plus its padding at the lower rate
+    for (int s = 0; s < numStages; s++) {
+        latency += (2 * kStageDesigns[s].halfLength + 1 + kStageDesigns[s].padding) >> s;
+    }
+
+    return latency;
+}
+
+float* const* Oversampler::upsample(const float* const* channels, int offset, int numChannels, int numSamples, int numStages)
+{
+    jassert(numStages > 0 && numStages <= kMaxNumStages);
+    jassert(numChannels <= mNumChannels && (numSamples << numStages) <= mMaxNumSamples);
+
+    for (int s = 0; s < numStages; s++)
+    {
+        Stage& stage = mStages[s];
+
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            const float* input = s == 0 ? channels[channel] + offset : mStages[s - 1].output.getReadPointer(channel);
+            upsampleStage(stage, input, stage.output.getWritePointer(channel), channel, numSamples << s);
+        }
+    }
+
+    return mStages[numStages - 1].output.getArrayOfWritePointers();
+}
+
+void Oversampler::downsample(float* const* channels, int offset, int numChannels, int numSamples, int numStages)
+{
+    jassert(numStages > 0 && numStages <= kMaxNumStages);
+    jassert(numChannels <= mNumChannels && (numSamples << numStages) <= mMaxNumSamples);
+
+    for (int s = numStages - 1; s >= 0; s--)
+    {
+        Stage& stage = mStages[s];
+
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            float* output = s == 0 ? channels[channel] + offset : mStages[s - 1].output.getWritePointer(channel);
+            downsampleStage(stage, stage.output.getReadPointer(channel), output, channel, numSamples << s);
+        }
+    }
+}
+
+size_t Oversampler::getMemoryFootprint() const
+{
+    size_t numFloats = (size_t)(mMaxNumSamples + 1) / 2;
+
+    for (auto& stage : mStages) {
+        numFloats += (size_t)mNumChannels * (3 * stage.inputStride + mMaxNumSamples);
+    }
+
+    return numFloats * sizeof(float);
+}
+
+void Oversampler::upsampleStage(Stage& stage, const float* input, float* output, int channel, int numSamples)
+{
+    const int numBranchTaps = stage.numBranchTaps;
+    const int historyLength = numBranchTaps - 1;
+
+    // the last historyLength input samples, then this call's
+    float* x = stage.upInput + channel * stage.inputStride;
+    juce::FloatVectorOperations::copy(x + historyLength, input, numSamples);
+
+    // the even outputs are the branch FIR
+    processBranch(x, stage.upCoefficients, numBranchTaps, mBranchOutput, numSamples);
+
+    // the odd ones are the centre tap alone, the input halfLength samples back
+    const float* centre = x + historyLength - stage.halfLength;
+
+    for (int i = 0; i < numSamples; i++) {
+        output[2 * i] = mBranchOutput[i];
+        output[2 * i + 1] = centre[i];
+    }
+
+    std::memmove(x, x + numSamples, (size_t)historyLength * sizeof(float));
+}
+
+void Oversampler::downsampleStage(Stage& stage, const float* input, float* output, int channel, int numSamples)
+{
+    const int numBranchTaps = stage.numBranchTaps;
+
+    // the padding delays both branches by the same number of samples
+    const int evenHistoryLength = numBranchTaps - 1 + stage.padding;
+    const int oddHistoryLength = stage.halfLength + 1 + stage.padding;
+
+    float* even = stage.evenInput + channel * stage.inputStride;
+    float* odd = stage.oddInput + channel * stage.inputStride;
+
+    for (int i = 0; i < numSamples; i++) {
+        even[evenHistoryLength + i] = input[2 * i];
+        odd[oddHistoryLength + i] = input[2 * i + 1];
+    }
+
+    // the even inputs meet the branch FIR, the odd ones only the centre tap
+    processBranch(even, stage.downCoefficients, numBranchTaps, output, numSamples);
+    juce::FloatVectorOperations::addWithMultiply(output, odd, 0.5f, numSamples);
+
+    std::memmove(even, even + numSamples, (size_t)evenHistoryLength * sizeof(float));
+    std::memmove(odd, odd + numSamples, (size_t)oddHistoryLength * sizeof(float));
+}
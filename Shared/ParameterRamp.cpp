@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    ParameterRamp.cpp
+
+  ==============================================================================
+*/
+
+#include "ParameterRamp.h"
+
+ParameterRamp::ParameterRamp(Shape shape)
+{
+    mShape = shape;
+    mMaxBlockSize = 0;
+    mCurrentValue = 0;
+    mRamping = false;
+    mNumSamplesFilled = 0;
+}
+
+void ParameterRamp::prepare(int maxBlockSize)
+{
+    if (maxBlockSize != mMaxBlockSize) {
+        mRamp.allocate(maxBlockSize, true);
+        mMaxBlockSize = maxBlockSize;
+    }
+
+    mNumSamplesFilled = 0;
+}
+
+void ParameterRamp::reset(float value)
+{
+    mCurrentValue = value;
+    mRamping = false;
+    mNumSamplesFilled = 0;
+}
+
+const float* ParameterRamp::process(float target, int numSamples)
+{
+    jassert(numSamples <= mMaxBlockSize);
+
+    float* ramp = mRamp.getData();
+
+    if (target == mCurrentValue) {
+        mRamping = false;
+
+        // the buffer still holds this value from an earlier block
+        if (numSamples > mNumSamplesFilled) {
+            juce::FloatVectorOperations::fill(ramp, mCurrentValue, numSamples);
+            mNumSamplesFilled = numSamples;
+        }
+
+        return ramp;
+    }
+
+    const float start = mCurrentValue;
+
+    // a geometric ramp needs both ends on the same side of zero
+    if (mShape == Shape::exponential && start > 0 && target > 0) {
+        const float ratio = std::pow(target / start, 1.0f / numSamples);
+        float value = start;
+
+        for (int sample = 0; sample < numSamples; sample++) {
+            value *= ratio;
+            ramp[sample] = value;
+        }
+    } else {
+        const float step = (target - start) / numSamples;
+
+        for (int sample = 0; sample < numSamples; sample++) {
+            ramp[sample] = start + step * (sample + 1);
+        }
+    }
+
+    // don't let rounding leave us just short of the target
+    ramp[numSamples - 1] = target;
+
+    mCurrentValue = target;
+    mRamping = true;
+    mNumSamplesFilled = 0;
+
+    return ramp;
+}
@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    ParameterRamp.h
+
+    Per-block parameter snapshot. The parameter is read once per block and
+    the change since the previous block is expanded into a per-sample ramp,
+    so the sample loops only ever touch a plain float array.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+*/
+class ParameterRamp
+{
+public:
+    enum class Shape
+    {
+        linear,
+        exponential    // for values that are perceived logarithmically, like rates
+    };
+
+    ParameterRamp(Shape shape = Shape::linear);
+
+    // allocate the ramp for the largest block we will be asked for
+    void prepare(int maxBlockSize);
+
+    // jump straight to a value, with no ramp
+    void reset(float value);
+
+    // returns numSamples values that move from the previous block's end value to target
+    const float* process(float target, int numSamples);
+
+    // true when the last processed block was not constant
+    bool isRamping() const { return mRamping; }
+
+    float getCurrentValue() const { return mCurrentValue; }
+    int getMaxBlockSize() const { return mMaxBlockSize; }
+
+    // bytes allocated for the ramp
+    size_t getMemoryFootprint() const { return (size_t) mMaxBlockSize * sizeof(float); }
+
+private:
+
+    Shape mShape;
+
+    juce::HeapBlock<float> mRamp;
+    int mMaxBlockSize;
+
+    float mCurrentValue;
+    bool mRamping;
+
+    // how much of mRamp already holds mCurrentValue, so constant blocks can skip the fill
+    int mNumSamplesFilled;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterRamp)
+};
@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    ParameterSmoother.cpp
+
+  ==============================================================================
+*/
+
+#include "ParameterSmoother.h"
+
+ParameterSmoother::ParameterSmoother(float timeConstantMs)
+{
+    mTimeConstantMs = timeConstantMs;
+    mSampleRate = 0;
+    mMaxBlockSize = 0;
+    mCurrentValue = 0;
+    mSmoothing = false;
+    mNumSamplesFilled = 0;
+}
+
+void ParameterSmoother::setTimeConstant(float timeConstantMs)
+{
+    mTimeConstantMs = timeConstantMs;
+
+    // the decay table is worked out again on the next prepare()
+    mSampleRate = 0;
+}
+
+void ParameterSmoother::prepare(double sampleRate, int maxBlockSize)
+{
+    if (maxBlockSize != mMaxBlockSize) {
+        mRamp.allocate(maxBlockSize, true);
+        mDecay.allocate(maxBlockSize, true);
+        mMaxBlockSize = maxBlockSize;
+        mSampleRate = 0;
+    }
+
+    if (sampleRate != mSampleRate) {
+        // per-sample decay of the remaining distance, a = 1 - z in the recurrence
+        const double decayPerSample = std::exp(-1000.0 / (mTimeConstantMs * sampleRate));
+
+        for (int sample = 0; sample < maxBlockSize; sample++) {
+            mDecay[sample] = (float) std::pow(decayPerSample, sample + 1);
+        }
+
+        mSampleRate = sampleRate;
+    }
+
+    mNumSamplesFilled = 0;
+}
+
+void ParameterSmoother::reset(float value)
+{
+    mCurrentValue = value;
+    mSmoothing = false;
+    mNumSamplesFilled = 0;
+}
+
+const float* ParameterSmoother::process(float target, int numSamples)
+{
+    jassert(numSamples <= mMaxBlockSize);
+
+    float* ramp = mRamp.getData();
+    const float distance = mCurrentValue - target;
+
+    if (std::abs(distance) <= kSettleTolerance * juce::jmax(1.0f, std::abs(target))) {
+        mSmoothing = false;
+
+        // snap the last hair, and the buffer may still hold the value from an earlier block
+        if (mCurrentValue != target || numSamples > mNumSamplesFilled) {
+            mCurrentValue = target;
+            juce::FloatVectorOperations::fill(ramp, mCurrentValue, numSamples);
+            mNumSamplesFilled = numSamples;
+        }
+
+        return ramp;
+    }
+
+    // x[n] = target + (x[0] - target) * a^(n + 1)
+    juce::FloatVectorOperations::copyWithMultiply(ramp, mDecay, distance, numSamples);
+    juce::FloatVectorOperations::add(ramp, target, numSamples);
+
+    mCurrentValue = ramp[numSamples - 1];
+    mSmoothing = true;
+    mNumSamplesFilled = 0;
+
+    return ramp;
+}
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    ParameterSmoother.h
+
+    One-pole smoothing towards a parameter's target, the x = x - z * (x - y)
+    glide, but configured by a time constant in milliseconds so it sounds
+    the same at every sample rate. The glide has a closed form,
+    x[n] = y + (x[0] - y) * a^n, so a whole block is one multiply-add over
+    a table of a^n instead of a serial recurrence. Once the value is within
+    a hair of the target it snaps to it, and from then on a block costs a
+    compare.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+*/
+class ParameterSmoother
+{
+public:
+    // the value counts as settled once it is this close to the target, relative to the target
+    // (or absolute below 1), a few float steps
+    static constexpr float kSettleTolerance = 1.0e-6f;
+
+    // timeConstantMs is how long the value takes to cover about 63% of a jump
+    ParameterSmoother(float timeConstantMs = 20.0f);
+
+    // change the time constant, call before prepare()
+    void setTimeConstant(float timeConstantMs);
+
+    // work out the decay table for this sample rate and the largest block we will be asked for;
+    // the current value is kept
+    void prepare(double sampleRate, int maxBlockSize);
+
+    // jump straight to a value, with no glide
+    void reset(float value);
+
+    // returns numSamples values gliding from the previous block's end value towards target
+    const float* process(float target, int numSamples);
+
+    // true when the last processed block was not constant
+    bool isSmoothing() const { return mSmoothing; }
+
+    float getCurrentValue() const { return mCurrentValue; }
+    float getTimeConstantMs() const { return mTimeConstantMs; }
+    int getMaxBlockSize() const { return mMaxBlockSize; }
+
+    // bytes allocated for the ramp and the decay table
+    size_t getMemoryFootprint() const { return 2 * (size_t) mMaxBlockSize * sizeof(float); }
+
+private:
+
+    float mTimeConstantMs;
+
+    juce::HeapBlock<float> mRamp;
+
+    // a^(n + 1) for every sample n of a block
+    juce::HeapBlock<float> mDecay;
+
+    double mSampleRate;
+    int mMaxBlockSize;
+
+    float mCurrentValue;
+    bool mSmoothing;
+
+    // how much of mRamp already holds mCurrentValue, so settled blocks can skip the fill
+    int mNumSamplesFilled;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterSmoother)
+};
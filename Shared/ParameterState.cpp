@@ -0,0 +1,184 @@
+/*
+  ==============================================================================
+
+    ParameterState.cpp
+
+  ==============================================================================
+*/
+
+#include "ParameterState.h"
+
+namespace
+{
+    // byte by byte, so the layout is the same whatever the host's byte order and alignment
+    inline void writeUInt32(juce::uint8* dest, juce::uint32 value)
+    {
+        dest[0] = (juce::uint8) value;
+        dest[1] = (juce::uint8) (value >> 8);
+        dest[2] = (juce::uint8) (value >> 16);
+        dest[3] = (juce::uint8) (value >> 24);
+    }
+
+    inline void writeUInt16(juce::uint8* dest, int value)
+    {
+        dest[0] = (juce::uint8) value;
+        dest[1] = (juce::uint8) (value >> 8);
+    }
+
+    inline juce::uint32 readUInt32(const juce::uint8* source)
+    {
+        return (juce::uint32) source[0]
+             | ((juce::uint32) source[1] << 8)
+             | ((juce::uint32) source[2] << 16)
+             | ((juce::uint32) source[3] << 24);
+    }
+
+    inline int readUInt16(const juce::uint8* source)
+    {
+        return (int) source[0] | ((int) source[1] << 8);
+    }
+
+    inline juce::uint32 floatToBits(float value)
+    {
+        juce::uint32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    inline float bitsToFloat(juce::uint32 bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+//==============================================================================
+ParameterState::ParameterState()
+{
+    mTagHash = 0;
+}
+
+void ParameterState::initialise(const juce::String& stateTag, const juce::Array<juce::AudioProcessorParameter*>& parameters)
+{
+    mTagHash = hashID(stateTag);
+    mEntries.clear();
+
+    for (auto* parameter : parameters)
+    {
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+        {
+            const juce::uint32 idHash = hashID(ranged->paramID);
+
+            // two IDs with one hash could not be told apart in a saved state
+            for (auto& entry : mEntries) {
+                jassert(entry.idHash != idHash);
+            }
+
+            mEntries.add({ idHash, ranged });
+        }
+    }
+}
+
+template <typename GetValue>
+void ParameterState::write(juce::MemoryBlock& destData, GetValue getValue) const
+{
+    destData.setSize((size_t) (kHeaderSize + kEntrySize * mEntries.size()), false);
+    auto* dest = static_cast<juce::uint8*>(destData.getData());
+
+    writeUInt32(dest, kMagic);
+    writeUInt16(dest + 4, kVersion);
+    writeUInt16(dest + 6, kEntrySize);
+    writeUInt32(dest + 8, mTagHash);
+    writeUInt32(dest + 12, (juce::uint32) mEntries.size());
+    dest += kHeaderSize;
+
+    for (auto& entry : mEntries)
+    {
+        writeUInt32(dest, entry.idHash);
+        writeUInt32(dest + 4, floatToBits(getValue(entry)));
+        dest += kEntrySize;
+    }
+}
+
+void ParameterState::save(juce::MemoryBlock& destData) const
+{
+    write(destData, [] (const Entry& entry) {
+        return entry.parameter->convertFrom0to1(entry.parameter->getValue());
+    });
+}
+
+void ParameterState::saveValues(juce::MemoryBlock& destData, const std::vector<std::pair<juce::String, float>>& values) const
+{
+    write(destData, [&values] (const Entry& entry) {
+        for (auto& value : values) {
+            if (value.first == entry.parameter->paramID) {
+                return value.second;
+            }
+        }
+
+        return entry.parameter->convertFrom0to1(entry.parameter->getDefaultValue());
+    });
+}
+
+bool ParameterState::restore(const void* data, int sizeInBytes) const
+{
+    auto* source = static_cast<const juce::uint8*>(data);
+
+    if (source == nullptr || sizeInBytes < kHeaderSize || readUInt32(source) != kMagic) {
+        return false;
+    }
+
+    const int entrySize = readUInt16(source + 6);
+
+    if (readUInt32(source + 8) != mTagHash || entrySize < kEntrySize) {
+        return false;
+    }
+
+    // a truncated state still restores every entry it holds in full
+    const int numEntries = (int) juce::jmin((juce::int64) readUInt32(source + 12),
+                                            (juce::int64) (sizeInBytes - kHeaderSize) / entrySize);
+    source += kHeaderSize;
+
+    for (int i = 0; i < numEntries; i++, source += entrySize)
+    {
+        const juce::uint32 idHash = readUInt32(source);
+        const float value = bitsToFloat(readUInt32(source + 4));
+
+        if (! std::isfinite(value)) {
+            continue;
+        }
+
+        // states are saved in parameter order, so the entry at the same position nearly always matches
+        juce::RangedAudioParameter* parameter = nullptr;
+
+        if (i < mEntries.size() && mEntries.getReference(i).idHash == idHash) {
+            parameter = mEntries.getReference(i).parameter;
+        } else {
+            for (auto& entry : mEntries) {
+                if (entry.idHash == idHash) {
+                    parameter = entry.parameter;
+                    break;
+                }
+            }
+        }
+
+        if (parameter != nullptr) {
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        }
+    }
+
+    return true;
+}
+
+juce::uint32 ParameterState::hashID(const juce::String& id)
+{
+    // 32-bit FNV-1a over the UTF-8 bytes
+    juce::uint32 hash = 2166136261u;
+
+    for (auto* c = id.toRawUTF8(); *c != 0; c++) {
+        hash = (hash ^ (juce::uint8) *c) * 16777619u;
+    }
+
+    return hash;
+}
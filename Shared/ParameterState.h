@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    ParameterState.h
+
+    Compact binary state for a processor's parameters, for get/setState-
+    Information. A state is a 16-byte header followed by one 8-byte entry
+    per parameter, all little-endian:
+
+        magic "KDST", version, entry size, hash of the processor's state tag,
+        number of entries, then per entry the FNV-1a hash of the parameter ID
+        and its value in the parameter's own (not normalised) units.
+
+    Entries are matched by ID hash, not position, so parameters can be added,
+    removed or reordered between versions: entries for unknown parameters are
+    skipped, and parameters the state has no entry for keep their value.
+    Readers skip whatever a newer version appends to each entry or after the
+    last one. Values are clamped to the parameter's current range.
+
+    Restoring parses the block in place and allocates nothing. Only call it
+    off the audio thread, as the host does.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+*/
+class ParameterState
+{
+public:
+    static constexpr juce::uint32 kMagic = 0x5453444b; // "KDST"
+    static constexpr int kVersion = 1;
+
+    static constexpr int kHeaderSize = 16;
+    static constexpr int kEntrySize = 8;
+
+    ParameterState();
+
+    // remembers every ranged parameter of the processor; stateTag tells one processor's states
+    // from another's, and must never change once sessions have been saved with it
+    void initialise(const juce::String& stateTag, const juce::Array<juce::AudioProcessorParameter*>& parameters);
+
+    void save(juce::MemoryBlock& destData) const;
+
+    // a state with the given values, in the parameters' own units, and every other parameter at
+    // its default, as a preset holds
+    void saveValues(juce::MemoryBlock& destData, const std::vector<std::pair<juce::String, float>>& values) const;
+
+    // returns false, changing nothing, when the data is not a state of this processor in this
+    // format, so the caller can try an older format
+    bool restore(const void* data, int sizeInBytes) const;
+
+    juce::uint32 getTagHash() const { return mTagHash; }
+
+    static juce::uint32 hashID(const juce::String& id);
+
+private:
+
+    struct Entry
+    {
+        juce::uint32 idHash;
+        juce::RangedAudioParameter* parameter;
+    };
+
+    // writes the header and one entry per parameter, the value coming from getValue(entry)
+    template <typename GetValue>
+    void write(juce::MemoryBlock& destData, GetValue getValue) const;
+
+    juce::uint32 mTagHash;
+    juce::Array<Entry> mEntries;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterState)
+};
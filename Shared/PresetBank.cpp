@@ -0,0 +1,268 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+namespace
+{
+    inline void writeUInt32(juce::uint8* dest, juce::uint32 value)
+    {
+        dest[0] = (juce::uint8) value;
+        dest[1] = (juce::uint8) (value >> 8);
+        dest[2] = (juce::uint8) (value >> 16);
+        dest[3] = (juce::uint8) (value >> 24);
+    }
+
+    inline juce::uint32 readUInt32(const juce::uint8* source)
+    {
+        return (juce::uint32) source[0]
+             | ((juce::uint32) source[1] << 8)
+             | ((juce::uint32) source[2] << 16)
+             | ((juce::uint32) source[3] << 24);
+    }
+
+    // FNV-1a, as ParameterState hashes IDs
+    juce::uint32 hashBytes(const juce::uint8* data, size_t sizeInBytes)
+    {
+        juce::uint32 hash = 2166136261u;
+
+        for (size_t i = 0; i < sizeInBytes; i++) {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+
+        return hash;
+    }
+}
+
+//==============================================================================
+PresetBank::PresetBank()
+{
+    mTagHash = 0;
+    mData = nullptr;
+    mIndexOffset = kHeaderSize;
+    mNumPresets = 0;
+}
+
+void PresetBank::open(const juce::File& file, const ParameterState& state, const std::vector<FactoryPreset>& factoryPresets)
+{
+    mMappedFile.reset();
+    mFallback.reset();
+    mData = nullptr;
+    mNumPresets = 0;
+
+    mFile = file;
+    mTagHash = state.getTagHash();
+
+    // the factory presets, and the hash of the bank they make on their own
+    std::vector<Preset> factory(factoryPresets.size());
+
+    for (size_t i = 0; i < factoryPresets.size(); i++)
+    {
+        factory[i].name = factoryPresets[i].name;
+        state.saveValues(factory[i].state, factoryPresets[i].values);
+    }
+
+    juce::MemoryBlock factoryBank;
+    build(factoryBank, mTagHash, factory);
+    const juce::uint32 factoryHash = hashBytes(static_cast<const juce::uint8*>(factoryBank.getData()), factoryBank.getSize());
+
+    if (! map()) {
+        write(factory, factoryHash);
+        return;
+    }
+
+    // a bank that has seen these factory presets is used as it is, one that hasn't gets those of
+    // names it doesn't have yet, after its own
+    if (mIndexOffset == kHeaderSize && readUInt32(mData + 16) == factoryHash) {
+        return;
+    }
+
+    std::vector<Preset> presets = getPresets();
+    const size_t numOwnPresets = presets.size();
+
+    for (auto& preset : factory)
+    {
+        const auto own = std::find_if(presets.begin(), presets.begin() + (std::ptrdiff_t) numOwnPresets,
+                                      [&preset] (const Preset& other) { return other.name == preset.name; });
+
+        if (own == presets.begin() + (std::ptrdiff_t) numOwnPresets) {
+            presets.push_back(std::move(preset));
+        }
+    }
+
+    write(presets, factoryHash);
+}
+
+juce::String PresetBank::getPresetName(int index) const
+{
+    if (! juce::isPositiveAndBelow(index, mNumPresets)) {
+        return {};
+    }
+
+    auto* name = reinterpret_cast<const char*>(mData + readUInt32(mData + mIndexOffset + kIndexEntrySize * index));
+
+    return juce::String::fromUTF8(name, (int) strnlen(name, kNameSize));
+}
+
+const void* PresetBank::getPresetState(int index, int& sizeInBytes) const
+{
+    if (! juce::isPositiveAndBelow(index, mNumPresets)) {
+        sizeInBytes = 0;
+        return nullptr;
+    }
+
+    auto* indexEntry = mData + mIndexOffset + kIndexEntrySize * index;
+
+    sizeInBytes = (int) readUInt32(indexEntry + 4) - kNameSize;
+    return mData + readUInt32(indexEntry) + kNameSize;
+}
+
+void PresetBank::setPresetName(int index, const juce::String& name)
+{
+    if (! juce::isPositiveAndBelow(index, mNumPresets)) {
+        return;
+    }
+
+    std::vector<Preset> presets = getPresets();
+    presets[(size_t) index].name = name;
+
+    write(presets, mIndexOffset == kHeaderSize ? readUInt32(mData + 16) : 0);
+}
+
+juce::File PresetBank::getDefaultFile(const juce::String& bankName)
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+               .getChildFile("Kadenze")
+               .getChildFile(bankName + ".kadenzepresets");
+}
+
+bool PresetBank::use(const void* data, size_t sizeInBytes)
+{
+    auto* source = static_cast<const juce::uint8*>(data);
+
+    if (source == nullptr || sizeInBytes < 16 || readUInt32(source) != kMagic
+        || (source[4] != 1 && source[4] != kVersion) || readUInt32(source + 8) != mTagHash) {
+        return false;
+    }
+
+    // version 1 has no factory hash
+    const int indexOffset = source[4] == 1 ? 16 : kHeaderSize;
+    const juce::uint32 numPresets = readUInt32(source + 12);
+
+    if (sizeInBytes < (size_t) indexOffset || numPresets > (sizeInBytes - indexOffset) / kIndexEntrySize) {
+        return false;
+    }
+
+    // checked once here, so the lookups can trust the index
+    for (juce::uint32 i = 0; i < numPresets; i++)
+    {
+        const juce::uint8* indexEntry = source + indexOffset + kIndexEntrySize * i;
+        const juce::uint64 offset = readUInt32(indexEntry);
+        const juce::uint64 size = readUInt32(indexEntry + 4);
+
+        if (size < (juce::uint64) kNameSize || offset + size > sizeInBytes) {
+            return false;
+        }
+    }
+
+    mData = source;
+    mIndexOffset = indexOffset;
+    mNumPresets = (int) numPresets;
+
+    return true;
+}
+
+bool PresetBank::map()
+{
+    if (! mFile.existsAsFile()) {
+        return false;
+    }
+
+    mMappedFile.reset(new juce::MemoryMappedFile(mFile, juce::MemoryMappedFile::readOnly));
+
+    if (use(mMappedFile->getData(), mMappedFile->getSize())) {
+        return true;
+    }
+
+    mMappedFile.reset();
+    return false;
+}
+
+void PresetBank::write(const std::vector<Preset>& presets, juce::uint32 factoryHash)
+{
+    juce::MemoryBlock bank;
+    build(bank, mTagHash, presets);
+    writeUInt32(static_cast<juce::uint8*>(bank.getData()) + 16, factoryHash);
+
+    // the presets may point into what is mapped or held now, they are all in the new bank by here
+    mMappedFile.reset();
+    mFallback.reset();
+    mData = nullptr;
+    mNumPresets = 0;
+
+    // written next to the bank and moved over it, so other instances never map half a file
+    mFile.getParentDirectory().createDirectory();
+    juce::TemporaryFile temporaryFile(mFile);
+
+    if (temporaryFile.getFile().replaceWithData(bank.getData(), bank.getSize())
+        && temporaryFile.overwriteTargetFileWithTemporary()
+        && map())
+    {
+        return;
+    }
+
+    mFallback.swapWith(bank);
+    use(mFallback.getData(), mFallback.getSize());
+}
+
+std::vector<PresetBank::Preset> PresetBank::getPresets() const
+{
+    std::vector<Preset> presets((size_t) mNumPresets);
+
+    for (int i = 0; i < mNumPresets; i++)
+    {
+        int sizeInBytes = 0;
+        const void* state = getPresetState(i, sizeInBytes);
+
+        presets[(size_t) i].name = getPresetName(i);
+        presets[(size_t) i].state.replaceAll(state, (size_t) sizeInBytes);
+    }
+
+    return presets;
+}
+
+void PresetBank::build(juce::MemoryBlock& destData, juce::uint32 tagHash, const std::vector<Preset>& presets)
+{
+    const int numPresets = (int) presets.size();
+    const size_t indexSize = (size_t) (kHeaderSize + kIndexEntrySize * numPresets);
+
+    destData.setSize(indexSize, true);
+    auto* header = static_cast<juce::uint8*>(destData.getData());
+
+    writeUInt32(header, kMagic);
+    header[4] = (juce::uint8) kVersion;    // and a zero high byte, then two reserved bytes
+    writeUInt32(header + 8, tagHash);
+    writeUInt32(header + 12, (juce::uint32) numPresets);
+
+    for (int i = 0; i < numPresets; i++)
+    {
+        const Preset& preset = presets[(size_t) i];
+
+        char name[kNameSize] = {};
+        preset.name.copyToUTF8(name, kNameSize);
+
+        const size_t offset = destData.getSize();
+        destData.append(name, kNameSize);
+        destData.append(preset.state.getData(), preset.state.getSize());
+
+        // appending may have moved the block
+        auto* indexEntry = static_cast<juce::uint8*>(destData.getData()) + kHeaderSize + kIndexEntrySize * i;
+        writeUInt32(indexEntry, (juce::uint32) offset);
+        writeUInt32(indexEntry + 4, (juce::uint32) (kNameSize + preset.state.getSize()));
+    }
+}
@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+
+    A processor's presets, memory-mapped from a bank file. The file is a
+    20-byte header (magic "KDPB", version, the processor's state tag hash,
+    number of presets, factory hash), an index of one (offset, size) pair
+    per preset, and the presets themselves: a 32-byte, zero-padded UTF-8
+    name followed by a ParameterState. All of it is little-endian. Version
+    1 banks have the same layout with a 16-byte header, and no factory hash.
+
+    The file is the bank: whatever valid bank for the processor it holds is
+    used, factory presets, renamed ones, or a studio's own. Opening checks
+    the header and that every index entry lies inside the file; after that
+    a preset is found from its index alone, with nothing parsed. Only a
+    file that is missing or isn't a bank for the processor is written from
+    the factory presets.
+
+    The factory hash identifies the factory presets the file last took in:
+    it is the FNV-1a hash of the bank those presets make on their own. A
+    build that ships other factory presets adds the ones whose names the
+    bank doesn't have yet after the bank's own presets, which stay as they
+    are, and writes the file again. If the file can't be written or mapped
+    the bank is served from memory instead.
+
+    Only open it off the audio thread; it touches the file system.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterState.h"
+
+//==============================================================================
+/**
+*/
+class PresetBank
+{
+public:
+    static constexpr juce::uint32 kMagic = 0x42504b44; // "KDPB"
+    static constexpr int kVersion = 2;
+
+    static constexpr int kHeaderSize = 20;
+    static constexpr int kIndexEntrySize = 8;
+    static constexpr int kNameSize = 32;
+
+    // a preset as the processor ships it, with values in the parameters' own units; parameters
+    // it leaves out are at their defaults
+    struct FactoryPreset
+    {
+        juce::String name;
+        std::vector<std::pair<juce::String, float>> values;
+    };
+
+    PresetBank();
+
+    // maps the bank file, writing it from the factory presets first when it is missing or isn't a
+    // bank for the processor state describes, and merging in factory presets it hasn't seen
+    void open(const juce::File& file, const ParameterState& state, const std::vector<FactoryPreset>& factoryPresets);
+
+    int getNumPresets() const { return mNumPresets; }
+
+    juce::String getPresetName(int index) const;
+
+    // writes the bank again with the preset renamed; other instances see it once they open the bank
+    void setPresetName(int index, const juce::String& name);
+
+    // the preset's ParameterState, inside the mapped file
+    const void* getPresetState(int index, int& sizeInBytes) const;
+
+    // where a bank of the given name lives, in the user's application data
+    static juce::File getDefaultFile(const juce::String& bankName);
+
+private:
+
+    // a preset as the bank holds it
+    struct Preset
+    {
+        juce::String name;
+        juce::MemoryBlock state;
+    };
+
+    // points the bank at data if it is a valid bank for mTagHash, of any version
+    bool use(const void* data, size_t sizeInBytes);
+
+    // maps the file, if it holds a valid bank
+    bool map();
+
+    // replaces the file with a bank of the presets, and maps it; serves it from memory if it can't
+    void write(const std::vector<Preset>& presets, juce::uint32 factoryHash);
+
+    // the presets the bank holds now, copied out of it
+    std::vector<Preset> getPresets() const;
+
+    // with the factory hash left zero
+    static void build(juce::MemoryBlock& destData, juce::uint32 tagHash, const std::vector<Preset>& presets);
+
+    juce::File mFile;
+    juce::uint32 mTagHash;
+
+    std::unique_ptr<juce::MemoryMappedFile> mMappedFile;
+    juce::MemoryBlock mFallback;
+
+    const juce::uint8* mData;
+    int mIndexOffset;
+    int mNumPresets;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetBank)
+};
@@ -0,0 +1,231 @@
+/*
+  ==============================================================================
+
+    PresetFader.cpp
+
+  ==============================================================================
+*/
+
+#include "PresetFader.h"
+
+PresetFader::PresetFader()
+{
+    mSwitch = kNoSwitch;
+    mSwitchRequested = false;
+    mRestartRequested = false;
+
+    mState = State::idle;
+    mFadesDry = false;
+    mSwitchesNow = false;
+    mFadeLengthInSamples = 1;
+    mNumSamplesRemaining = 0;
+    mStartGain = 1;
+    mEndGain = 1;
+}
+
+void PresetFader::prepare(double sampleRate, int numChannels, int maxBlockSize)
+{
+    mFadeLengthInSamples = juce::jmax(1, (int)std::round(sampleRate * kFadeTimeMs * 0.001));
+    mDry.setSize(numChannels, maxBlockSize);
+    mFeedback.allocate(maxBlockSize, true);
+
+    // the processor starts from the parameters as they are, whatever was written before
+    mSwitch = kNoSwitch;
+    mSwitchRequested = false;
+    mRestartRequested = false;
+
+    mState = State::idle;
+    mFadesDry = false;
+    mSwitchesNow = false;
+    mNumSamplesRemaining = 0;
+    mStartGain = 1;
+    mEndGain = 1;
+}
+
+void PresetFader::beginSwitch()
+{
+    mSwitch.store(kWriting);
+}
+
+void PresetFader::endSwitch()
+{
+    mSwitch.store(kWritten);
+}
+
+void PresetFader::requestSwitch()
+{
+    mSwitchRequested = true;
+}
+
+void PresetFader::requestRestart()
+{
+    mRestartRequested = true;
+}
+
+void PresetFader::startBlock()
+{
+    if (mState != State::idle || (mSwitch.load() == kNoSwitch && ! mSwitchRequested && ! mRestartRequested)) {
+        return;
+    }
+
+    mState = State::fadingOut;
+    mFadesDry = mRestartRequested;
+    mRestartRequested = false;
+    mNumSamplesRemaining = mFadeLengthInSamples;
+}
+
+bool PresetFader::isHolding() const
+{
+    return mState == State::fadingOut || mState == State::silent || mSwitch.load() != kNoSwitch;
+}
+
+int PresetFader::getChunkLength(int numSamples)
+{
+    mSwitchesNow = false;
+    mStartGain = mEndGain;
+
+    if (mState == State::silent) {
+        // a restart or the processor's own switch needs no parameters, but waits for any that are
+        // still being written, and takes them along
+        int written = kWritten;
+        const bool switched = mSwitch.compare_exchange_strong(written, kNoSwitch);
+
+        if (! switched && ! ((mFadesDry || mSwitchRequested) && written == kNoSwitch)) {
+            return numSamples;
+        }
+
+        mState = State::fadingIn;
+        mSwitchesNow = true;
+        mSwitchRequested = false;
+        mNumSamplesRemaining = mFadeLengthInSamples;
+
+        // the processor asks again every block until the restart lands, this one answers them all
+        if (mFadesDry) {
+            mRestartRequested = false;
+        }
+    }
+
+    if (mState == State::idle) {
+        return numSamples;
+    }
+
+    const int length = juce::jmin(numSamples, mNumSamplesRemaining);
+    mNumSamplesRemaining -= length;
+
+    const float remaining = (float)mNumSamplesRemaining / mFadeLengthInSamples;
+
+    if (mState == State::fadingOut) {
+        mEndGain = remaining;
+
+        if (mNumSamplesRemaining == 0) {
+            mState = State::silent;
+        }
+    } else {
+        mEndGain = 1 - remaining;
+
+        if (mNumSamplesRemaining == 0) {
+            mState = State::idle;
+        }
+    }
+
+    return length;
+}
+
+const float* PresetFader::processFeedback(const float* feedback, int numSamples)
+{
+    if (mStartGain == 1 && mEndGain == 1) {
+        return feedback;
+    }
+
+    jassert(numSamples <= mDry.getNumSamples());
+
+    const float step = (mEndGain - mStartGain) / numSamples;
+
+    for (int sample = 0; sample < numSamples; sample++) {
+        mFeedback[sample] = feedback[sample] * (mStartGain + step * (sample + 1));
+    }
+
+    return mFeedback;
+}
+
+void PresetFader::processInput(float* const* channels, int offset, int numChannels, int numSamples)
+{
+    if (mStartGain == 1 && mEndGain == 1) {
+        return;
+    }
+
+    if (mFadesDry) {
+        if (mEndGain > mStartGain) {
+            process(channels, offset, numChannels, numSamples, nullptr, false);
+        }
+
+        return;
+    }
+
+    jassert(numChannels <= mDry.getNumChannels() && numSamples <= mDry.getNumSamples());
+
+    for (int channel = 0; channel < numChannels; channel++) {
+        mDry.copyFrom(channel, 0, channels[channel] + offset, numSamples);
+    }
+}
+
+void PresetFader::processWet(float* const* channels, int offset, int numChannels, int numSamples, const float* dryGains)
+{
+    if (mFadesDry && mEndGain > mStartGain) {
+        return;
+    }
+
+    process(channels, offset, numChannels, numSamples, dryGains, false);
+}
+
+void PresetFader::processDryWet(float* const* channels, int offset, int numChannels, int numSamples, const float* dryWet)
+{
+    if (mFadesDry && mEndGain > mStartGain) {
+        return;
+    }
+
+    process(channels, offset, numChannels, numSamples, dryWet, true);
+}
+
+void PresetFader::processDry(float* const* channels, int offset, int numChannels, int numSamples)
+{
+    if (mFadesDry) {
+        process(channels, offset, numChannels, numSamples, nullptr, false);
+    }
+}
+
+size_t PresetFader::getMemoryFootprint() const
+{
+    return (size_t)(mDry.getNumChannels() + 1) * (size_t)mDry.getNumSamples() * sizeof(float);
+}
+
+void PresetFader::process(float* const* channels, int offset, int numChannels, int numSamples, const float* dryGains, bool dryWet)
+{
+    if (mStartGain == 1 && mEndGain == 1) {
+        return;
+    }
+
+    // the chunk's part of the fade, spread over however many samples the wet path ran
+    const float step = (mEndGain - mStartGain) / numSamples;
+
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        const float* dry = mDry.getReadPointer(channel);
+        float* out = channels[channel] + offset;
+
+        for (int sample = 0; sample < numSamples; sample++)
+        {
+            const float gain = mStartGain + step * (sample + 1);
+
+            if (mFadesDry) {
+                out[sample] *= gain;
+                continue;
+            }
+
+            const float dryGain = dryWet ? 1 - dryGains[sample] : dryGains[sample];
+            const float drySample = dryGain * dry[sample];
+
+            out[sample] = drySample + gain * (out[sample] - drySample);
+        }
+    }
+}
@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+
+    PresetFader.h
+
+    Hides preset switches behind a short fade of the wet path, without
+    locks. The message thread writes the preset's parameters itself,
+    between beginSwitch() and endSwitch(). The audio thread holds its
+    ramps where they are while a switch is pending, fades the wet signal
+    out over kFadeTimeMs, jumps the ramps to the new values at the chunk
+    where the wet signal reached silence, and fades it back in. The dry
+    signal passes straight through, and the delay lines keep running, so
+    the tails of what was playing carry on into the new preset.
+
+    The fade runs in samples, not blocks: the processor cuts its chunks at
+    the fade's ends, whatever the block size.
+
+    A processor change that restarts the lines (the chorus' oversampling)
+    asks for a restart instead, which fades the whole output out, dry
+    included, since the dry signal runs through what restarts too, and the
+    input back in.
+
+    A processor change that only the wet path hears (the render profile)
+    asks for a switch of its own, which fades like a preset's and lands the
+    same way, with no parameters to wait for.
+
+    A switch asked for mid-fade replaces the pending one; one asked for
+    while fading back in waits for the fade to finish.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+*/
+class PresetFader
+{
+public:
+    // each way
+    static constexpr double kFadeTimeMs = 10.0;
+
+    PresetFader();
+
+    // numChannels and maxBlockSize are the most processInput() and processFeedback() are handed, at whatever rate the wet path
+    // runs; the fade itself runs at sampleRate
+    void prepare(double sampleRate, int numChannels, int maxBlockSize);
+
+    // message thread, around writing a preset's parameters
+    void beginSwitch();
+    void endSwitch();
+
+    // audio thread: fades the whole output out and back in, for a change of the processor's own
+    void requestRestart();
+
+    // audio thread: fades the wet path out and back in, like a preset switch, for a change of the
+    // processor's own that only the wet path hears
+    void requestSwitch();
+
+    // audio thread, at the start of a block: starts the fade out when a switch is waiting
+    void startBlock();
+
+    // true while the ramps should stay where they are rather than follow the parameters
+    bool isHolding() const;
+
+    // the first up to numSamples samples (at sampleRate) of what is left of the block, cut where the
+    // fade starts or ends; moves the fade along them
+    int getChunkLength(int numSamples);
+
+    // true for the chunk the switch lands on: the parameters jump to their new values here
+    bool switchesNow() const { return mSwitchesNow; }
+
+    // and whether it is a restart, which the processor only applies here
+    bool restartsNow() const { return mSwitchesNow && mFadesDry; }
+
+    // the chunk's feedback gains, faded along with the wet signal, so what the line takes in
+    // around the switch carries no step of its own that the new delay time would read back later
+    const float* processFeedback(const float* feedback, int numSamples);
+
+    // before the chunk is processed: copies its input, when the wet fade needs it, or fades it back
+    // in after a restart, so the restarted lines take it in smoothly too
+    void processInput(float* const* channels, int offset, int numChannels, int numSamples);
+
+    // after the chunk is processed: fades all but the dry part of the output, dryGains per sample,
+    // or 1 - dryWet for processDryWet(); numSamples may be more than getChunkLength() returned,
+    // for wet paths that run oversampled
+    void processWet(float* const* channels, int offset, int numChannels, int numSamples, const float* dryGains);
+    void processDryWet(float* const* channels, int offset, int numChannels, int numSamples, const float* dryWet);
+
+    // instead, for a chunk with no wet signal at all, which only a restart fades
+    void processDry(float* const* channels, int offset, int numChannels, int numSamples);
+
+    // true while the output is anything but straight through
+    bool isFading() const { return mState != State::idle; }
+
+    // bytes allocated for the dry copy and the feedback gains
+    size_t getMemoryFootprint() const;
+
+private:
+
+    enum class State
+    {
+        idle,
+        fadingOut,
+        silent,
+        fadingIn
+    };
+
+    // what mSwitch holds
+    enum
+    {
+        kNoSwitch,
+        kWriting,
+        kWritten
+    };
+
+    void process(float* const* channels, int offset, int numChannels, int numSamples, const float* dryGains, bool dryWet);
+
+    std::atomic<int> mSwitch;
+    bool mSwitchRequested;
+    bool mRestartRequested;
+
+    State mState;
+    bool mFadesDry;
+    bool mSwitchesNow;
+    int mFadeLengthInSamples;
+    int mNumSamplesRemaining;
+
+    // the wet gain at the start and end of the last chunk
+    float mStartGain;
+    float mEndGain;
+
+    juce::AudioBuffer<float> mDry;
+    juce::HeapBlock<float> mFeedback;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetFader)
+};
@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+
+    PresetPrograms.cpp
+
+  ==============================================================================
+*/
+
+#include "PresetPrograms.h"
+
+PresetPrograms::PresetPrograms()
+{
+    mState = nullptr;
+    mFader = nullptr;
+    mCurrentProgram = 0;
+}
+
+void PresetPrograms::open(const juce::String& bankName, const ParameterState& state, PresetFader& fader,
+                          const std::vector<PresetBank::FactoryPreset>& factoryPresets)
+{
+    mBank.open(PresetBank::getDefaultFile(bankName), state, factoryPresets);
+
+    mState = &state;
+    mFader = &fader;
+    mCurrentProgram = 0;
+}
+
+int PresetPrograms::getNumPrograms() const
+{
+    return juce::jmax(1, mBank.getNumPresets());
+}
+
+void PresetPrograms::setCurrentProgram(int index)
+{
+    if (mState == nullptr || ! juce::isPositiveAndBelow(index, mBank.getNumPresets())) {
+        return;
+    }
+
+    mCurrentProgram = index;
+
+    int sizeInBytes = 0;
+    const void* state = mBank.getPresetState(index, sizeInBytes);
+
+    // the audio thread holds its ramps from beginSwitch() on, and only jumps them to what was
+    // written once endSwitch() has been called and the wet signal has faded out
+    mFader->beginSwitch();
+    mState->restore(state, sizeInBytes);
+    mFader->endSwitch();
+}
+
+juce::String PresetPrograms::getProgramName(int index) const
+{
+    return mBank.getPresetName(index);
+}
+
+void PresetPrograms::changeProgramName(int index, const juce::String& newName)
+{
+    mBank.setPresetName(index, newName);
+}
@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    PresetPrograms.h
+
+    A processor's programs, as the host sees them: the presets of a
+    PresetBank, with setCurrentProgram() writing the chosen preset's
+    parameters on the message thread and handing the switch to a
+    PresetFader, so the audio thread never writes a parameter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterState.h"
+#include "PresetBank.h"
+#include "PresetFader.h"
+
+//==============================================================================
+/**
+*/
+class PresetPrograms
+{
+public:
+    PresetPrograms();
+
+    // opens the bank of the given name in the user's application data; state and fader must
+    // outlive this
+    void open(const juce::String& bankName, const ParameterState& state, PresetFader& fader,
+              const std::vector<PresetBank::FactoryPreset>& factoryPresets);
+
+    // never 0, even if the bank couldn't be read: some hosts don't cope with that
+    int getNumPrograms() const;
+    int getCurrentProgram() const { return mCurrentProgram; }
+
+    // message thread: ignores indices outside the bank
+    void setCurrentProgram(int index);
+
+    juce::String getProgramName(int index) const;
+
+    // message thread: renames the preset in the bank file, which every instance shares
+    void changeProgramName(int index, const juce::String& newName);
+
+private:
+
+    PresetBank mBank;
+
+    const ParameterState* mState;
+    PresetFader* mFader;
+    int mCurrentProgram;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetPrograms)
+};
@@ -0,0 +1,40 @@
+/*
+  ==============================================================================
+
+    RenderProfile.cpp
+
+  ==============================================================================
+*/
+
+#include "RenderProfile.h"
+
+RenderProfile::RenderProfile()
+{
+    mOffline = false;
+    mNonRealtime = false;
+}
+
+int RenderProfile::getBlockSize(bool nonRealtime, int samplesPerBlock)
+{
+    return nonRealtime ? juce::jmax(samplesPerBlock, kOfflineBlockSize) : samplesPerBlock;
+}
+
+void RenderProfile::update(bool nonRealtime, bool idle, PresetFader& fader)
+{
+    mNonRealtime = nonRealtime;
+
+    if (idle) {
+        mOffline = nonRealtime;
+    } else if (nonRealtime != mOffline) {
+        fader.requestSwitch();
+    }
+}
+
+InterpolationType RenderProfile::getInterpolation(InterpolationType chosen) const
+{
+    if (! mOffline || chosen == InterpolationType::allpass) {
+        return chosen;
+    }
+
+    return InterpolationType::lagrange6;
+}
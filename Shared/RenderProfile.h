@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    RenderProfile.h
+
+    Whether a processor runs its realtime or its offline profile. Realtime
+    uses the interpolation and modulation rate the parameters ask for, at
+    the block size the host announced. Offline renders trade speed for
+    quality: every FIR read is raised to Lagrange 6, modulation runs at
+    audio rate, and the internal chunks are at least kOfflineBlockSize long
+    so hosts that bounce in big blocks aren't cut into small ones. Allpass
+    interpolation is kept, it is chosen for its sound rather than its cost.
+
+    The profile follows the host's isNonRealtime() in prepareToPlay, and
+    mid-stream straight away at the start of a block where the processor is
+    idle: nothing audible is left in its lines then, so swapping the
+    interpolator can't step the output. A host that flips the mode while
+    audio keeps ringing gets the new profile behind the preset fader
+    instead: the wet path fades out, the profile swaps where it is silent,
+    and it fades back in, so the switch lands within a couple of fades
+    whatever the input.
+
+    The chunk size is fixed at prepareToPlay, a host has to say it renders
+    offline before preparing to get the longer chunks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Interpolators.h"
+#include "PresetFader.h"
+
+//==============================================================================
+/**
+*/
+class RenderProfile
+{
+public:
+    // the shortest internal chunk offline renders prepare for
+    static constexpr int kOfflineBlockSize = 4096;
+
+    RenderProfile();
+
+    // the chunk size to prepare for
+    static int getBlockSize(bool nonRealtime, int samplesPerBlock);
+
+    // follows the host's mode straight away
+    void prepare(bool nonRealtime) { mOffline = mNonRealtime = nonRealtime; }
+
+    // audio thread, at the start of every block and before the fader's startBlock(): follows the
+    // host's mode if the processor is idle, and otherwise asks the fader for a switch
+    void update(bool nonRealtime, bool idle, PresetFader& fader);
+
+    // audio thread, on the chunk the fader's switch lands on: takes the mode update() last saw
+    void switchNow() { mOffline = mNonRealtime; }
+
+    bool isOffline() const { return mOffline; }
+
+    InterpolationType getInterpolation(InterpolationType chosen) const;
+
+    int getModulationInterval(int chosen) const { return mOffline ? 1 : chosen; }
+
+private:
+
+    bool mOffline;
+
+    // the host's mode, as of the last update()
+    bool mNonRealtime;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderProfile)
+};
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    SilenceDetector.cpp
+
+  ==============================================================================
+*/
+
+#include "SilenceDetector.h"
+
+SilenceDetector::SilenceDetector()
+{
+    reset();
+}
+
+void SilenceDetector::reset()
+{
+    mLineLevel = 0;
+    mPendingLevel = 0;
+    mNumSamplesHeld = 0;
+    mSilent = true;
+}
+
+bool SilenceDetector::process(float inputPeak, float feedback, int reachInSamples, int numSamples)
+{
+    // whatever the chunk writes; the feedback only ever re-reads what the line holds
+    const float writtenLevel = inputPeak + std::abs(feedback) * mLineLevel;
+
+    if (writtenLevel >= mLineLevel) {
+        mLineLevel = writtenLevel;
+        mPendingLevel = 0;
+        mNumSamplesHeld = 0;
+    } else {
+        mPendingLevel = juce::jmax(mPendingLevel, writtenLevel);
+        mNumSamplesHeld += numSamples;
+
+        // a whole reach written below the held level, the reads can only find the quieter writes
+        if (mNumSamplesHeld >= reachInSamples) {
+            mLineLevel = mPendingLevel;
+            mPendingLevel = 0;
+            mNumSamplesHeld = 0;
+        }
+    }
+
+    mSilent = inputPeak < kThreshold && mLineLevel < kThreshold;
+    return mSilent;
+}
+
+float SilenceDetector::getPeak(const float* const* channels, int numChannels, int offset, int numSamples)
+{
+    float peak = 0;
+
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        const juce::Range<float> range = juce::FloatVectorOperations::findMinAndMax(channels[channel] + offset, numSamples);
+        peak = juce::jmax(peak, -range.getStart(), range.getEnd());
+    }
+
+    return peak;
+}
+
+double SilenceDetector::getTailLengthSeconds(double delayTime, float feedback)
+{
+    feedback = std::abs(feedback);
+
+    if (feedback >= 1.0f) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    // the first echo, then one more trip round the delay per repeat that is still above the threshold
+    const double numRepeats = feedback > 0 ? std::ceil(std::log(kThreshold) / std::log(feedback)) : 0;
+
+    return delayTime * (1.0 + numRepeats);
+}
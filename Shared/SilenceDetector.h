@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    SilenceDetector.h
+
+    Tracks whether a delay effect is idle: its input is silent and nothing
+    left in its delay line is loud enough to hear. The input is measured by
+    its block peak. The line is never measured, it is bounded instead: every
+    chunk writes at most the input peak plus the feedback times what the
+    line held, and once a whole reach of the line has been written below
+    the held level, that level has left the line. With feedback f the bound
+    falls by about f per trip round the delay, as the echoes do.
+
+    While idle a processor can skip its line entirely, leaving the line as
+    it is; anything it still holds is below the threshold.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+*/
+class SilenceDetector
+{
+public:
+    // anything below this counts as silence, about -90 dBFS
+    static constexpr float kThreshold = 3.0e-5f;
+
+    SilenceDetector();
+
+    // the line is empty (just cleared)
+    void reset();
+
+    // account for one chunk about to be processed: inputPeak is the peak of what goes into the line
+    // besides the feedback, feedback the largest feedback gain in the chunk, and reachInSamples how
+    // far back the line can be read. Returns true when the input and everything the chunk could
+    // read are below kThreshold, so the chunk need not touch the line at all.
+    bool process(float inputPeak, float feedback, int reachInSamples, int numSamples);
+
+    // true when the last processed chunk was idle
+    bool isSilent() const { return mSilent; }
+
+    // an upper bound on the level of anything the line holds
+    float getLineLevel() const { return mLineLevel; }
+
+    // the peak level of numSamples samples from offset on, across numChannels channels
+    static float getPeak(const float* const* channels, int numChannels, int offset, int numSamples);
+
+    // how long a full-scale signal through a delay of delayTime seconds, fed back with feedback,
+    // takes to die away below kThreshold
+    static double getTailLengthSeconds(double delayTime, float feedback);
+
+private:
+
+    float mLineLevel;
+
+    // the most written since mLineLevel was last raised, and how many samples ago that was
+    float mPendingLevel;
+    juce::int64 mNumSamplesHeld;
+
+    bool mSilent;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SilenceDetector)
+};
@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    StereoDelayLine.cpp
+
+  ==============================================================================
+*/
+
+#include "StereoDelayLine.h"
+
+StereoDelayLine::StereoDelayLine()
+{
+    mCapacity = 0;
+    mMask = 0;
+    mWriteHead = 0;
+}
+
+void StereoDelayLine::swapWith(StereoDelayLine& other) noexcept
+{
+    mBuffer.swapWith(other.mBuffer);
+    std::swap(mCapacity, other.mCapacity);
+    std::swap(mMask, other.mMask);
+    std::swap(mWriteHead, other.mWriteHead);
+    std::swap(mLazyClear, other.mLazyClear);
+}
+
+void StereoDelayLine::prepare(int maxDelayInSamples)
+{
+    // the interpolating reads touch one frame beyond the longest delay
+    const int capacity = juce::nextPowerOfTwo(juce::jmax(maxDelayInSamples + 2, kNumGuardFrames));
+
+    if (capacity != mCapacity) {
+        mBuffer = mPool->allocate(2 * (capacity + kNumGuardFrames));
+        mCapacity = capacity;
+        mMask = capacity - 1;
+    }
+
+    clearLazily();
+}
+
+void StereoDelayLine::clear()
+{
+    juce::zeromem(mBuffer.getData(), (size_t)(mCapacity + kNumGuardFrames) * 2 * sizeof(float));
+    mWriteHead = 0;
+    mLazyClear.setFull(mCapacity);
+}
+
+void StereoDelayLine::writeBlock(const float* left, const float* right, int numSamples)
+{
+    jassert(numSamples <= mCapacity);
+
+    // up to the end of the buffer, then on from its start
+    const int numSamplesBeforeWrap = juce::jmin(numSamples, mCapacity - mWriteHead);
+
+    float* frame = mBuffer + 2 * mWriteHead;
+
+    for (int sample = 0; sample < numSamplesBeforeWrap; sample++, frame += 2) {
+        frame[0] = left[sample];
+        frame[1] = right[sample];
+    }
+
+    frame = mBuffer;
+
+    for (int sample = numSamplesBeforeWrap; sample < numSamples; sample++, frame += 2) {
+        frame[0] = left[sample];
+        frame[1] = right[sample];
+    }
+
+    // and mirror the guard again if any of it was written
+    if (mWriteHead < kNumGuardFrames || numSamplesBeforeWrap < numSamples) {
+        juce::FloatVectorOperations::copy(mBuffer + 2 * mCapacity, mBuffer, 2 * kNumGuardFrames);
+    }
+}
+
+void StereoDelayLine::clearLazily()
+{
+    mWriteHead = 0;
+    mLazyClear.reset();
+}
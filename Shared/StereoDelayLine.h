@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    StereoDelayLine.h
+
+    Power-of-two circular delay buffer for two linked channels, stored as
+    interleaved (left, right) frames. Both channels are always read at the
+    same delay, so a stereo read touches one cache line instead of two, and
+    the two-sample interpolation runs on both channels with one vector load.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayMemoryPool.h"
+#include "LazyClear.h"
+#include "Interpolators.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#elif JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
+//==============================================================================
+/**
+*/
+class StereoDelayLine
+{
+public:
+    // how many frames past the end are mirrored from the start of the buffer
+    static constexpr int kNumGuardFrames = 8;
+
+    StereoDelayLine();
+
+    // make room for delays of up to maxDelayInSamples, reallocating only if the capacity changes;
+    // this clears the line lazily, see ensureReadable()
+    void prepare(int maxDelayInSamples);
+
+    // zero the whole buffer and rewind the write head
+    void clear();
+
+    // rewind the write head and forget what was written, without touching the buffer
+    void clearLazily();
+
+    // as DelayLine::ensureReadable()
+    inline void ensureReadable(float minDelayInSamples, float maxDelayInSamples, int numSamples)
+    {
+        mLazyClear.ensureReadable(mCapacity, mWriteHead, minDelayInSamples, maxDelayInSamples, numSamples,
+                                  [this] (int begin, int end) { juce::zeromem(mBuffer + 2 * begin, (size_t)(end - begin) * 2 * sizeof(float)); });
+    }
+
+    // exchange buffers and heads with another line, without allocating (as DelayLine::swapWith())
+    void swapWith(StereoDelayLine& other) noexcept;
+
+    // store a frame at the write head (call advance() once the frame's reads are done)
+    inline void write(float left, float right)
+    {
+        float* frame = mBuffer + 2 * mWriteHead;
+        frame[0] = left;
+        frame[1] = right;
+
+        // the mirror is the frame itself except inside the guard region, as in DelayLine
+        float* mirror = mBuffer + 2 * (mWriteHead + (mWriteHead < kNumGuardFrames ? mCapacity : 0));
+        mirror[0] = left;
+        mirror[1] = right;
+    }
+
+    // store numSamples frames from the write head on, then call advance(numSamples)
+    void writeBlock(const float* left, const float* right, int numSamples);
+
+    inline void advance()
+    {
+        mWriteHead = (mWriteHead + 1) & mMask;
+        mLazyClear.advance(1);
+    }
+
+    inline void advance(int numSamples)
+    {
+        mWriteHead = (mWriteHead + numSamples) & mMask;
+        mLazyClear.advance(numSamples);
+    }
+
+    // the frame written delayInSamples frames before the current write head
+    inline void read(int delayInSamples, float& left, float& right) const
+    {
+        const float* frame = mBuffer + 2 * ((mWriteHead - delayInSamples) & mMask);
+        left = frame[0];
+        right = frame[1];
+    }
+
+    // linearly interpolated read of both channels, delayInSamples may be anywhere in [0, capacity - 2]
+    inline void readLinear(float delayInSamples, float& left, float& right) const
+    {
+        const int delayWhole = (int)delayInSamples;
+        const float delayFraction = delayInSamples - delayWhole;
+
+        // x[0, 1] is the frame one sample further back than the whole delay, x[2, 3] the next one
+        const float* x = mBuffer + 2 * ((mWriteHead - delayWhole - 1) & mMask);
+        const float fraction = 1.0f - delayFraction;
+
+       #if JUCE_USE_SSE_INTRINSICS
+        const __m128 frames = _mm_loadu_ps(x);
+        const __m128 nextFrame = _mm_movehl_ps(frames, frames);
+        const __m128 out = _mm_add_ps(frames, _mm_mul_ps(_mm_set1_ps(fraction), _mm_sub_ps(nextFrame, frames)));
+
+        left = _mm_cvtss_f32(out);
+        right = _mm_cvtss_f32(_mm_shuffle_ps(out, out, _MM_SHUFFLE(1, 1, 1, 1)));
+       #elif JUCE_USE_ARM_NEON
+        const float32x2_t frame = vld1_f32(x);
+        const float32x2_t nextFrame = vld1_f32(x + 2);
+        const float32x2_t out = vadd_f32(frame, vmul_n_f32(vsub_f32(nextFrame, frame), fraction));
+
+        left = vget_lane_f32(out, 0);
+        right = vget_lane_f32(out, 1);
+       #else
+        left = x[0] + fraction * (x[2] - x[0]);
+        right = x[1] + fraction * (x[3] - x[1]);
+       #endif
+    }
+
+    int getCapacity() const { return mCapacity; }
+    int getMask() const { return mMask; }
+    int getWriteHead() const { return mWriteHead; }
+
+    // raw storage, valid for 2 * (getCapacity() + kNumGuardFrames) samples
+    const float* getData() const { return mBuffer; }
+
+    // one channel of the frames, for the block interpolators
+    DelayTapRow getTapRow(int channel) const { return { mBuffer + channel, 2, mMask }; }
+
+    // bytes allocated for the buffer, including the guard frames
+    size_t getMemoryFootprint() const { return mBuffer.getNumBytes(); }
+
+private:
+
+    // the pool goes first, so it outlives the block
+    juce::SharedResourcePointer<DelayMemoryPool> mPool;
+    DelayMemoryPool::Block mBuffer;
+
+    // in frames
+    int mCapacity;
+    int mMask;
+    int mWriteHead;
+
+    LazyClear mLazyClear;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StereoDelayLine)
+};
@@ -0,0 +1,333 @@
+/*
+  ==============================================================================
+
+    VoiceLanes.h
+
+    Four voices' worth of floats in one vector register, for effects that
+    run several modulated read heads over the same delay line. Voices are
+    laid out one per lane (structure of arrays), so the lfo, read position
+    and interpolation arithmetic of four voices is one instruction each:
+    SSE2 on Intel, NEON on ARM, and a plain four-float loop elsewhere. Only
+    the addresses of the taps are worked out one lane at a time, since every
+    voice reads from its own position.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Interpolators.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#elif JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
+//==============================================================================
+/**
+*/
+struct VoiceLanes
+{
+    static constexpr int kNumLanes = 4;
+
+   #if JUCE_USE_SSE_INTRINSICS
+    __m128 value;
+
+    static inline VoiceLanes load(const float* source) { return { _mm_loadu_ps(source) }; }
+    static inline VoiceLanes broadcast(float x) { return { _mm_set1_ps(x) }; }
+    static inline VoiceLanes set(float a, float b, float c, float d) { return { _mm_setr_ps(a, b, c, d) }; }
+    inline void store(float* destination) const { _mm_storeu_ps(destination, value); }
+
+    inline VoiceLanes operator+(VoiceLanes other) const { return { _mm_add_ps(value, other.value) }; }
+    inline VoiceLanes operator-(VoiceLanes other) const { return { _mm_sub_ps(value, other.value) }; }
+    inline VoiceLanes operator*(VoiceLanes other) const { return { _mm_mul_ps(value, other.value) }; }
+    inline VoiceLanes operator/(VoiceLanes other) const { return { _mm_div_ps(value, other.value) }; }
+
+    static inline VoiceLanes min(VoiceLanes a, VoiceLanes b) { return { _mm_min_ps(a.value, b.value) }; }
+    static inline VoiceLanes max(VoiceLanes a, VoiceLanes b) { return { _mm_max_ps(a.value, b.value) }; }
+
+    // rounds towards zero, which is down for the non-negative values it is used on
+    static inline VoiceLanes truncate(VoiceLanes a) { return { _mm_cvtepi32_ps(_mm_cvttps_epi32(a.value)) }; }
+
+    inline float sum() const
+    {
+        const __m128 pairs = _mm_add_ps(value, _mm_movehl_ps(value, value));
+        return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+    }
+
+    // four rows of four in, the four columns out
+    static inline void transpose(VoiceLanes& a, VoiceLanes& b, VoiceLanes& c, VoiceLanes& d)
+    {
+        _MM_TRANSPOSE4_PS(a.value, b.value, c.value, d.value);
+    }
+   #elif JUCE_USE_ARM_NEON
+    float32x4_t value;
+
+    static inline VoiceLanes load(const float* source) { return { vld1q_f32(source) }; }
+    static inline VoiceLanes broadcast(float x) { return { vdupq_n_f32(x) }; }
+
+    static inline VoiceLanes set(float a, float b, float c, float d)
+    {
+        const float values[] = { a, b, c, d };
+        return { vld1q_f32(values) };
+    }
+    inline void store(float* destination) const { vst1q_f32(destination, value); }
+
+    inline VoiceLanes operator+(VoiceLanes other) const { return { vaddq_f32(value, other.value) }; }
+    inline VoiceLanes operator-(VoiceLanes other) const { return { vsubq_f32(value, other.value) }; }
+    inline VoiceLanes operator*(VoiceLanes other) const { return { vmulq_f32(value, other.value) }; }
+
+    // a reciprocal estimate and two Newton steps, as accurate as a divide for what it is used on
+    inline VoiceLanes operator/(VoiceLanes other) const
+    {
+        float32x4_t reciprocal = vrecpeq_f32(other.value);
+        reciprocal = vmulq_f32(vrecpsq_f32(other.value, reciprocal), reciprocal);
+        reciprocal = vmulq_f32(vrecpsq_f32(other.value, reciprocal), reciprocal);
+        return { vmulq_f32(value, reciprocal) };
+    }
+
+    static inline VoiceLanes min(VoiceLanes a, VoiceLanes b) { return { vminq_f32(a.value, b.value) }; }
+    static inline VoiceLanes max(VoiceLanes a, VoiceLanes b) { return { vmaxq_f32(a.value, b.value) }; }
+
+    static inline VoiceLanes truncate(VoiceLanes a) { return { vcvtq_f32_s32(vcvtq_s32_f32(a.value)) }; }
+
+    inline float sum() const
+    {
+        const float32x2_t pairs = vadd_f32(vget_low_f32(value), vget_high_f32(value));
+        return vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+    }
+
+    // four rows of four in, the four columns out
+    static inline void transpose(VoiceLanes& a, VoiceLanes& b, VoiceLanes& c, VoiceLanes& d)
+    {
+        const float32x4x2_t ab = vtrnq_f32(a.value, b.value);
+        const float32x4x2_t cd = vtrnq_f32(c.value, d.value);
+
+        a.value = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+        b.value = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+        c.value = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+        d.value = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+    }
+   #else
+    float value[kNumLanes];
+
+    static inline VoiceLanes load(const float* source)
+    {
+        VoiceLanes lanes;
+
+        for (int lane = 0; lane < kNumLanes; lane++) {
+            lanes.value[lane] = source[lane];
+        }
+
+        return lanes;
+    }
+
+    static inline VoiceLanes broadcast(float x) { return { { x, x, x, x } }; }
+    static inline VoiceLanes set(float a, float b, float c, float d) { return { { a, b, c, d } }; }
+
+    inline void store(float* destination) const
+    {
+        for (int lane = 0; lane < kNumLanes; lane++) {
+            destination[lane] = value[lane];
+        }
+    }
+
+    template <typename Operation>
+    static inline VoiceLanes apply(VoiceLanes a, VoiceLanes b, Operation&& operation)
+    {
+        VoiceLanes lanes;
+
+        for (int lane = 0; lane < kNumLanes; lane++) {
+            lanes.value[lane] = operation(a.value[lane], b.value[lane]);
+        }
+
+        return lanes;
+    }
+
+    inline VoiceLanes operator+(VoiceLanes other) const { return apply(*this, other, [] (float a, float b) { return a + b; }); }
+    inline VoiceLanes operator-(VoiceLanes other) const { return apply(*this, other, [] (float a, float b) { return a - b; }); }
+    inline VoiceLanes operator*(VoiceLanes other) const { return apply(*this, other, [] (float a, float b) { return a * b; }); }
+    inline VoiceLanes operator/(VoiceLanes other) const { return apply(*this, other, [] (float a, float b) { return a / b; }); }
+
+    static inline VoiceLanes min(VoiceLanes a, VoiceLanes b) { return apply(a, b, [] (float x, float y) { return x < y ? x : y; }); }
+    static inline VoiceLanes max(VoiceLanes a, VoiceLanes b) { return apply(a, b, [] (float x, float y) { return x > y ? x : y; }); }
+
+    static inline VoiceLanes truncate(VoiceLanes a) { return apply(a, a, [] (float x, float) { return (float)(int)x; }); }
+
+    inline float sum() const { return (value[0] + value[2]) + (value[1] + value[3]); }
+
+    // four rows of four in, the four columns out
+    static inline void transpose(VoiceLanes& a, VoiceLanes& b, VoiceLanes& c, VoiceLanes& d)
+    {
+        VoiceLanes* rows[] = { &a, &b, &c, &d };
+
+        for (int row = 0; row < kNumLanes; row++) {
+            for (int column = row + 1; column < kNumLanes; column++) {
+                std::swap(rows[row]->value[column], rows[column]->value[row]);
+            }
+        }
+    }
+   #endif
+
+    // sin(2 pi phase) in every lane, for non-negative phases (in cycles) below 2^22: the phase
+    // is brought to the nearest whole cycle, the outer quarters are folded in with
+    // sin(pi - x) = sin(x), and a 9th-order Taylor series covers the [-1/4, 1/4] left, to within 4e-6
+    static inline VoiceLanes sine(VoiceLanes phase)
+    {
+        const VoiceLanes half = broadcast(0.5f);
+
+        VoiceLanes x = phase - truncate(phase + half);
+        x = min(x, half - x);
+        x = max(x, broadcast(-0.5f) - x);
+
+        const VoiceLanes angle = x * broadcast(juce::MathConstants<float>::twoPi);
+        const VoiceLanes angleSquared = angle * angle;
+
+        VoiceLanes series = broadcast(1.0f / 362880.0f);
+        series = broadcast(-1.0f / 5040.0f) + angleSquared * series;
+        series = broadcast(1.0f / 120.0f) + angleSquared * series;
+        series = broadcast(-1.0f / 6.0f) + angleSquared * series;
+        series = broadcast(1.0f) + angleSquared * series;
+
+        return angle * series;
+    }
+};
+
+//==============================================================================
+namespace VoiceLanesInterpolators
+{
+    // gathers NumTaps consecutive samples per lane from NumTapsBehind before x0, at delays behind
+    // writeHead, and returns t (as Interpolators::gather(), only across lanes instead of time); the
+    // row has to be one channel's (stride 1), so each lane's taps are one load, and a transpose
+    // turns the four lanes' loads into one vector per tap. The rows' guard samples cover the
+    // loads reaching past the last tap.
+    template <int NumTapsBehind, int NumTaps>
+    inline VoiceLanes gather(const DelayTapRow& row, int writeHead, VoiceLanes delays, VoiceLanes (&taps)[NumTaps])
+    {
+        jassert(row.stride == 1);
+
+        float delay[VoiceLanes::kNumLanes];
+        delays.store(delay);
+
+        const float* x[VoiceLanes::kNumLanes];
+
+        for (int lane = 0; lane < VoiceLanes::kNumLanes; lane++) {
+            x[lane] = row.data + ((writeHead - (int)delay[lane] - 1 - NumTapsBehind) & row.mask);
+        }
+
+        for (int first = 0; first < NumTaps; first += VoiceLanes::kNumLanes)
+        {
+            VoiceLanes columns[VoiceLanes::kNumLanes];
+
+            for (int lane = 0; lane < VoiceLanes::kNumLanes; lane++) {
+                columns[lane] = VoiceLanes::load(x[lane] + first);
+            }
+
+            VoiceLanes::transpose(columns[0], columns[1], columns[2], columns[3]);
+
+            for (int tap = first; tap < NumTaps && tap < first + VoiceLanes::kNumLanes; tap++) {
+                taps[tap] = columns[tap - first];
+            }
+        }
+
+        const VoiceLanes one = VoiceLanes::broadcast(1.0f);
+        return one - (delays - VoiceLanes::truncate(delays));
+    }
+
+    // the lane version of each block interpolator in Interpolators: one read per lane, every lane at
+    // its own delay behind the same write head; state holds the allpass' previous output per lane
+    template <typename Interpolator>
+    struct Reader;
+
+    template <>
+    struct Reader<Interpolators::Linear>
+    {
+        static inline VoiceLanes read(const DelayTapRow& row, int writeHead, VoiceLanes delays, VoiceLanes& /*state*/)
+        {
+            VoiceLanes taps[2];
+            const VoiceLanes t = gather<0>(row, writeHead, delays, taps);
+
+            return taps[0] + t * (taps[1] - taps[0]);
+        }
+    };
+
+    template <>
+    struct Reader<Interpolators::Hermite>
+    {
+        static inline VoiceLanes read(const DelayTapRow& row, int writeHead, VoiceLanes delays, VoiceLanes& /*state*/)
+        {
+            VoiceLanes taps[4];
+            const VoiceLanes t = gather<1>(row, writeHead, delays, taps);
+
+            const VoiceLanes half = VoiceLanes::broadcast(0.5f);
+            const VoiceLanes c1 = half * (taps[2] - taps[0]);
+            const VoiceLanes c2 = taps[0] - VoiceLanes::broadcast(2.5f) * taps[1] + VoiceLanes::broadcast(2.0f) * taps[2] - half * taps[3];
+            const VoiceLanes c3 = half * (taps[3] - taps[0]) + VoiceLanes::broadcast(1.5f) * (taps[1] - taps[2]);
+
+            return ((c3 * t + c2) * t + c1) * t + taps[1];
+        }
+    };
+
+    template <int NumPoints>
+    struct Reader<Interpolators::Lagrange<NumPoints>>
+    {
+        static inline VoiceLanes read(const DelayTapRow& row, int writeHead, VoiceLanes delays, VoiceLanes& /*state*/)
+        {
+            static constexpr int kNumTapsBehind = Interpolators::Lagrange<NumPoints>::kNumTapsBehind;
+
+            VoiceLanes taps[NumPoints];
+            const VoiceLanes t = gather<kNumTapsBehind>(row, writeHead, delays, taps);
+
+            // with x the position relative to the first tap, tap k sits at k
+            const VoiceLanes x = t + VoiceLanes::broadcast((float)kNumTapsBehind);
+            VoiceLanes sum = VoiceLanes::broadcast(0.0f);
+
+            for (int k = 0; k < NumPoints; k++)
+            {
+                float denominator = 1;
+
+                for (int j = 0; j < NumPoints; j++) {
+                    if (j != k) {
+                        denominator *= (float)(k - j);
+                    }
+                }
+
+                VoiceLanes weight = VoiceLanes::broadcast(1.0f / denominator);
+
+                for (int j = 0; j < NumPoints; j++) {
+                    if (j != k) {
+                        weight = weight * (x - VoiceLanes::broadcast((float)j));
+                    }
+                }
+
+                sum = sum + weight * taps[k];
+            }
+
+            return sum;
+        }
+    };
+
+    template <>
+    struct Reader<Interpolators::Allpass>
+    {
+        static inline VoiceLanes read(const DelayTapRow& row, int writeHead, VoiceLanes delays, VoiceLanes& state)
+        {
+            // the fractional part in [0.5, 1.5), as Interpolators::Allpass, so older is x0 and newer x1
+            VoiceLanes taps[2];
+            const VoiceLanes half = VoiceLanes::broadcast(0.5f);
+            const VoiceLanes one = VoiceLanes::broadcast(1.0f);
+
+            const VoiceLanes shiftedDelays = delays - half;
+            const VoiceLanes t = gather<0>(row, writeHead, shiftedDelays, taps);
+
+            // gather's t is 1 - (d - 0.5 - whole), the allpass wants d - whole = 1.5 - t
+            const VoiceLanes delayFraction = VoiceLanes::broadcast(1.5f) - t;
+            const VoiceLanes coefficient = (one - delayFraction) / (one + delayFraction);
+
+            state = coefficient * (taps[1] - state) + taps[0];
+            return state;
+        }
+    };
+}